@@ -0,0 +1,703 @@
+
+#ifndef LIBAXL_ASYNC_READER_GUARD
+#define LIBAXL_ASYNC_READER_GUARD
+
+#include <atomic>
+#include <new>
+#include <thread>
+
+#include "util.h"
+#include "arena.h"
+#include "vectors.h"
+#include "vector_pair.h"
+#include "circular_buffer.h"
+#include "mpmc_queue.h"
+#include "io_segments.h"
+
+#if defined(_WIN32)
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#if defined(__linux__) && !defined(LIBAXL_NO_IO_URING)
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#define LIBAXL_HAS_IO_URING
+#endif
+#endif
+
+namespace libaxl {
+
+/**
+ *  async_auto:     io_uring where the kernel allows it, else threads
+ *  async_io_uring: io_uring only, opening fails without it
+ *  async_threads:  a pool of threads doing blocking positional reads
+ */
+enum async_backend {
+	async_auto,
+	async_io_uring,
+	async_threads
+};
+
+namespace detail {
+	/**
+	 *  A read of one slot: bytes at offset into target.
+	 *  slot < 0 tells a worker thread to exit.
+	 */
+	struct async_request {
+		index_type slot;
+		uint64_t offset;
+		size_type bytes;
+		unsigned char* target;
+	};
+
+	/**
+	 *  bytes read, negative on error.
+	 */
+	struct async_completion {
+		index_type slot;
+		int64_t bytes;
+	};
+
+#if defined(LIBAXL_HAS_IO_URING)
+	/**
+	 *  The shared submission/completion rings of an io_uring instance,
+	 *  set up through the raw system calls.
+	 */
+	struct io_uring_state {
+		int ring_fd;
+
+		unsigned char* sq_memory;
+		size_type sq_memory_size;
+		unsigned* sq_head;
+		unsigned* sq_tail;
+		unsigned* sq_mask;
+		unsigned* sq_array;
+		io_uring_sqe* sqes;
+		size_type sqes_size;
+
+		unsigned char* cq_memory;
+		size_type cq_memory_size;
+		unsigned* cq_head;
+		unsigned* cq_tail;
+		unsigned* cq_mask;
+		io_uring_cqe* cqes;
+
+		iovec* iovecs;
+		unsigned pending;
+	};
+#endif
+}
+
+/**
+ *  Streams a file through a ring of depth slots of chunk elements,
+ *  keeping up to depth reads in flight.
+ *
+ *  Reads land directly in the ring storage, a circular_buffer<T>: each
+ *  read targets the write() window of its slot. Completed slots are
+ *  handed out in file order by peek_read as vector_pair<T> views of
+ *  the ring, and release_read gives them back to be refilled, so the
+ *  next reads overlap whatever the consumer does with the data.
+ *
+ *  All calls are made from the consumer thread. With io_uring the
+ *  kernel does the reads asynchronously; with the thread backend the
+ *  requests go to worker threads through an mpmc_queue and come back
+ *  through another one.
+ */
+template <typename T>
+struct async_reader {
+	circular_buffer<T> storage;
+	index_type chunk;
+	index_type depth;
+
+	file_handle file;
+	uint64_t file_size;
+	uint64_t next_offset;
+	async_backend backend;
+	bool failed;
+
+	//Slot sequence numbers: released <= completed <= submitted
+	size_type submitted;
+	size_type completed;
+	size_type released;
+	index_type in_flight;
+	bool* slot_done;
+	index_type* slot_count;
+	uint64_t* slot_offset;
+	size_type* slot_remaining;
+
+#if defined(LIBAXL_HAS_IO_URING)
+	detail::io_uring_state uring;
+#endif
+
+	mpmc_queue<detail::async_request>* requests;
+	mpmc_queue<detail::async_completion>* completions;
+	std::thread* workers;
+	index_type worker_count;
+};
+
+namespace detail {
+	inline
+	bool open_for_reading(const char* path, file_handle* file, uint64_t* size) {
+#if defined(_WIN32)
+		HANDLE handle = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+			FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+		if(handle == INVALID_HANDLE_VALUE)
+			return false;
+
+		LARGE_INTEGER file_size;
+		if(!GetFileSizeEx(handle, &file_size)) {
+			CloseHandle(handle);
+			return false;
+		}
+
+		*file = handle;
+		*size = (uint64_t)file_size.QuadPart;
+		return true;
+#else
+		int fd = open(path, O_RDONLY);
+		if(fd < 0)
+			return false;
+
+		struct stat info;
+		if(fstat(fd, &info) != 0) {
+			::close(fd);
+			return false;
+		}
+
+		*file = fd;
+		*size = (uint64_t)info.st_size;
+		return true;
+#endif
+	}
+
+	inline
+	void close_file(file_handle file) {
+#if defined(_WIN32)
+		CloseHandle(file);
+#else
+		::close(file);
+#endif
+	}
+
+	/**
+	 *  Blocking positional read of exactly bytes, unless the file ends.
+	 *  Returns the bytes read, -1 on error.
+	 */
+	inline
+	int64_t read_at(file_handle file, unsigned char* target, size_type bytes, uint64_t offset) {
+		int64_t total = 0;
+
+		while((size_type)total < bytes) {
+#if defined(_WIN32)
+			OVERLAPPED position = {};
+			position.Offset = (DWORD)offset;
+			position.OffsetHigh = (DWORD)(offset >> 32);
+
+			DWORD request = (DWORD)minimum(bytes - (size_type)total, (size_type)(1U << 30));
+			DWORD got = 0;
+			if(!ReadFile(file, target, request, &got, &position))
+				return (GetLastError() == ERROR_HANDLE_EOF) ? total : -1;
+#else
+			ssize_t got = pread(file, target, bytes - (size_type)total, (off_t)offset);
+			if(got < 0)
+				return -1;
+#endif
+			if(got == 0)
+				break;
+
+			total += (int64_t)got;
+			target += got;
+			offset += (uint64_t)got;
+		}
+
+		return total;
+	}
+
+	inline
+	void async_worker(mpmc_queue<async_request>* requests, mpmc_queue<async_completion>* completions,
+		file_handle file)
+	{
+		for(;;) {
+			async_request request;
+			vector<async_request> item{ &request, 1, 1 };
+			dequeue_wait(*requests, item);
+
+			if(request.slot < 0)
+				return;
+
+			async_completion completion;
+			completion.slot = request.slot;
+			completion.bytes = read_at(file, request.target, request.bytes, request.offset);
+
+			vector<async_completion> done{ &completion, 1, 1 };
+			enqueue_wait(*completions, done);
+		}
+	}
+
+#if defined(LIBAXL_HAS_IO_URING)
+	inline
+	bool io_uring_open(io_uring_state& s, unsigned entries, arena* arena, index_type depth) {
+		io_uring_params params;
+		memset(&params, 0, sizeof(params));
+
+		int fd = (int)syscall(__NR_io_uring_setup, entries, &params);
+		if(fd < 0)
+			return false;
+
+		s.ring_fd = fd;
+		s.pending = 0;
+
+		s.sq_memory_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+		s.cq_memory_size = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+
+		bool single_mmap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+		if(single_mmap)
+			s.sq_memory_size = s.cq_memory_size = maximum(s.sq_memory_size, s.cq_memory_size);
+
+		void* sq = mmap(nullptr, s.sq_memory_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+			fd, IORING_OFF_SQ_RING);
+		if(sq == MAP_FAILED) {
+			::close(fd);
+			return false;
+		}
+		s.sq_memory = (unsigned char*)sq;
+
+		if(single_mmap) {
+			s.cq_memory = s.sq_memory;
+		} else {
+			void* cq = mmap(nullptr, s.cq_memory_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+				fd, IORING_OFF_CQ_RING);
+			if(cq == MAP_FAILED) {
+				munmap(sq, s.sq_memory_size);
+				::close(fd);
+				return false;
+			}
+			s.cq_memory = (unsigned char*)cq;
+		}
+
+		s.sqes_size = params.sq_entries * sizeof(io_uring_sqe);
+		void* sqes = mmap(nullptr, s.sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+			fd, IORING_OFF_SQES);
+		if(sqes == MAP_FAILED) {
+			if(!single_mmap)
+				munmap(s.cq_memory, s.cq_memory_size);
+			munmap(sq, s.sq_memory_size);
+			::close(fd);
+			return false;
+		}
+		s.sqes = (io_uring_sqe*)sqes;
+
+		s.sq_head = (unsigned*)(s.sq_memory + params.sq_off.head);
+		s.sq_tail = (unsigned*)(s.sq_memory + params.sq_off.tail);
+		s.sq_mask = (unsigned*)(s.sq_memory + params.sq_off.ring_mask);
+		s.sq_array = (unsigned*)(s.sq_memory + params.sq_off.array);
+
+		s.cq_head = (unsigned*)(s.cq_memory + params.cq_off.head);
+		s.cq_tail = (unsigned*)(s.cq_memory + params.cq_off.tail);
+		s.cq_mask = (unsigned*)(s.cq_memory + params.cq_off.ring_mask);
+		s.cqes = (io_uring_cqe*)(s.cq_memory + params.cq_off.cqes);
+
+		s.iovecs = allocate<iovec>(arena, depth);
+
+		return true;
+	}
+
+	inline
+	void io_uring_close(io_uring_state& s) {
+		munmap(s.sqes, s.sqes_size);
+		if(s.cq_memory != s.sq_memory)
+			munmap(s.cq_memory, s.cq_memory_size);
+		munmap(s.sq_memory, s.sq_memory_size);
+		::close(s.ring_fd);
+	}
+
+	/**
+	 *  Queues a readv of one slot, submitted with the next io_uring_enter.
+	 */
+	inline
+	void io_uring_queue_read(io_uring_state& s, int fd, const async_request& request) {
+		iovec& target = s.iovecs[request.slot];
+		target.iov_base = request.target;
+		target.iov_len = request.bytes;
+
+		unsigned tail = *s.sq_tail;
+		unsigned index = tail & *s.sq_mask;
+
+		io_uring_sqe* sqe = &s.sqes[index];
+		memset(sqe, 0, sizeof(*sqe));
+		sqe->opcode = IORING_OP_READV;
+		sqe->fd = fd;
+		sqe->addr = (uint64_t)(size_type)&target;
+		sqe->len = 1;
+		sqe->off = request.offset;
+		sqe->user_data = (uint64_t)request.slot;
+
+		s.sq_array[index] = index;
+		__atomic_store_n(s.sq_tail, tail + 1, __ATOMIC_RELEASE);
+		++s.pending;
+	}
+
+	/**
+	 *  Submits the queued reads and, if wait, blocks for at least one
+	 *  completion. Returns false on error.
+	 */
+	inline
+	bool io_uring_submit(io_uring_state& s, bool wait) {
+		unsigned flags = wait ? IORING_ENTER_GETEVENTS : 0;
+
+		for(;;) {
+			long result = syscall(__NR_io_uring_enter, s.ring_fd, s.pending, wait ? 1 : 0, flags, nullptr, 0);
+			if(result >= 0) {
+				s.pending -= (unsigned)result;
+				return true;
+			}
+			if(errno != EINTR)
+				return false;
+		}
+	}
+
+	/**
+	 *  Pops one completion if there is one.
+	 */
+	inline
+	bool io_uring_pop(io_uring_state& s, async_completion* completion) {
+		unsigned head = *s.cq_head;
+		if(head == __atomic_load_n(s.cq_tail, __ATOMIC_ACQUIRE))
+			return false;
+
+		io_uring_cqe* cqe = &s.cqes[head & *s.cq_mask];
+		completion->slot = (index_type)cqe->user_data;
+		completion->bytes = (int64_t)cqe->res;
+
+		__atomic_store_n(s.cq_head, head + 1, __ATOMIC_RELEASE);
+		return true;
+	}
+#endif
+}
+
+/**
+ *  Opens path for streaming through a ring of depth * chunk elements
+ *  allocated from arena, and starts the first depth reads.
+ *
+ *  Preconditions:
+ *  (1) chunk >= 1, depth >= 1
+ *  (2) worker_count >= 1 (only used by the thread backend)
+ *
+ *  Returns nullptr if the file cannot be opened, does not hold a whole
+ *  number of elements, or the requested backend is not available.
+ */
+template <typename T>
+inline
+async_reader<T>* make_async_reader(arena* arena, const char* path, index_type chunk, index_type depth,
+	async_backend backend = async_auto, index_type worker_count = 4)
+{
+	assert(arena != nullptr);
+	assert(path != nullptr);
+	assert(chunk >= 1 && depth >= 1);
+	assert(worker_count >= 1);
+
+	file_handle file;
+	uint64_t file_size;
+	if(!detail::open_for_reading(path, &file, &file_size))
+		return nullptr;
+
+	//The slots hold whole elements, trailing bytes would be dropped
+	if(file_size % sizeof(T) != 0) {
+		detail::close_file(file);
+		return nullptr;
+	}
+
+	auto memory = arena->alloc(sizeof(async_reader<T>), detail::cache_line_size);
+	auto result = new (memory) async_reader<T>();
+
+	result->storage = make_circular_buffer<T>(arena, chunk * depth);
+	result->chunk = chunk;
+	result->depth = depth;
+	result->file = file;
+	result->file_size = file_size;
+	result->next_offset = 0;
+	result->failed = false;
+
+	result->submitted = 0;
+	result->completed = 0;
+	result->released = 0;
+	result->slot_done = allocate<bool>(arena, depth);
+	result->in_flight = 0;
+	result->slot_count = allocate<index_type>(arena, depth);
+	result->slot_offset = allocate<uint64_t>(arena, depth);
+	result->slot_remaining = allocate<size_type>(arena, depth);
+
+	result->requests = nullptr;
+	result->completions = nullptr;
+	result->workers = nullptr;
+	result->worker_count = 0;
+
+	bool uring_ready = false;
+#if defined(LIBAXL_HAS_IO_URING)
+	if(backend != async_threads)
+		uring_ready = detail::io_uring_open(result->uring, (unsigned)depth, arena, depth);
+#endif
+
+	if(uring_ready) {
+		result->backend = async_io_uring;
+	} else if(backend == async_io_uring) {
+		detail::close_file(file);
+		return nullptr;
+	} else {
+		result->backend = async_threads;
+		result->requests = make_mpmc_queue<detail::async_request>(arena, depth + worker_count);
+		result->completions = make_mpmc_queue<detail::async_completion>(arena, depth);
+
+		result->workers = allocate<std::thread>(arena, worker_count);
+		result->worker_count = worker_count;
+		for(index_type i = 0; i < worker_count; ++i) {
+			new (&result->workers[i]) std::thread(detail::async_worker,
+				result->requests, result->completions, file);
+		}
+	}
+
+	return result;
+}
+
+/**
+ *  Stops the reads in flight, joins the workers and closes the file.
+ *  The ring storage stays in the arena.
+ */
+template <typename T>
+inline
+void destroy_async_reader(async_reader<T>* r) {
+	assert(r != nullptr);
+
+	if(r->backend == async_threads) {
+		//Queued reads are finished first, there is always room for
+		//their completions
+		for(index_type i = 0; i < r->worker_count; ++i) {
+			detail::async_request stop = { -1, 0, 0, nullptr };
+			vector<detail::async_request> item{ &stop, 1, 1 };
+			enqueue_wait(*r->requests, item);
+		}
+
+		for(index_type i = 0; i < r->worker_count; ++i) {
+			r->workers[i].join();
+			r->workers[i].~thread();
+		}
+	}
+
+#if defined(LIBAXL_HAS_IO_URING)
+	if(r->backend == async_io_uring) {
+		//The kernel may still write into the ring storage until the
+		//reads in flight have completed
+		detail::async_completion completion;
+		while(r->in_flight > 0) {
+			if(detail::io_uring_pop(r->uring, &completion))
+				--r->in_flight;
+			else if(!detail::io_uring_submit(r->uring, true))
+				break;
+		}
+		detail::io_uring_close(r->uring);
+	}
+#endif
+
+	detail::close_file(r->file);
+	r->~async_reader<T>();
+}
+
+namespace detail {
+	template <typename T>
+	inline
+	unsigned char* async_slot_memory(async_reader<T>& r, index_type slot) {
+		return (unsigned char*)r.storage.buf_vector.array + (size_type)slot * r.chunk * sizeof(T);
+	}
+
+	template <typename T>
+	inline
+	void async_issue(async_reader<T>& r, const async_request& request) {
+		++r.in_flight;
+
+#if defined(LIBAXL_HAS_IO_URING)
+		if(r.backend == async_io_uring) {
+			io_uring_queue_read(r.uring, r.file, request);
+			return;
+		}
+#endif
+		vector<async_request> item{ (async_request*)&request, 1, 1 };
+		enqueue_wait(*r.requests, item);
+	}
+
+	/**
+	 *  Starts reads into every free slot, each into the write() window
+	 *  of the slot.
+	 */
+	template <typename T>
+	inline
+	void async_submit(async_reader<T>& r) {
+		size_type chunk_bytes = (size_type)r.chunk * sizeof(T);
+
+		while(r.submitted - r.released < (size_type)r.depth && r.next_offset < r.file_size && !r.failed) {
+			auto slot = (index_type)(r.submitted % (size_type)r.depth);
+
+			circular_buffer<T> at_slot = r.storage;
+			at_slot.tail = slot * r.chunk;
+			vector<T> window = first(write(at_slot, r.chunk));
+
+			async_request request;
+			request.slot = slot;
+			request.offset = r.next_offset;
+			request.bytes = (size_type)minimum((uint64_t)chunk_bytes, r.file_size - r.next_offset);
+			request.target = (unsigned char*)window.array;
+
+			r.slot_done[slot] = false;
+			r.slot_count[slot] = (index_type)(request.bytes / sizeof(T));
+			r.slot_offset[slot] = request.offset;
+			r.slot_remaining[slot] = request.bytes;
+
+			async_issue(r, request);
+
+			r.next_offset += request.bytes;
+			++r.submitted;
+		}
+
+#if defined(LIBAXL_HAS_IO_URING)
+		if(r.backend == async_io_uring && r.uring.pending > 0) {
+			if(!io_uring_submit(r.uring, false))
+				r.failed = true;
+		}
+#endif
+	}
+
+	/**
+	 *  Records a completion. A short read that is not at the end of the
+	 *  file is continued with a read of the rest of the slot.
+	 */
+	template <typename T>
+	inline
+	void async_complete(async_reader<T>& r, async_completion completion) {
+		index_type slot = completion.slot;
+
+		--r.in_flight;
+
+		if(completion.bytes <= 0) {
+			r.failed = true;
+			return;
+		}
+
+		size_type& remaining = r.slot_remaining[slot];
+		remaining -= (size_type)completion.bytes;
+
+		if(remaining == 0) {
+			r.slot_done[slot] = true;
+			return;
+		}
+
+		//Only io_uring reads come back short, the workers loop
+		size_type done = (size_type)r.slot_count[slot] * sizeof(T) - remaining;
+
+		async_request rest;
+		rest.slot = slot;
+		rest.bytes = remaining;
+		rest.offset = r.slot_offset[slot] + done;
+		rest.target = async_slot_memory(r, slot) + done;
+
+		async_issue(r, rest);
+	}
+
+	/**
+	 *  Waits for and records at least one completion.
+	 */
+	template <typename T>
+	inline
+	void async_wait(async_reader<T>& r) {
+		async_completion completion;
+
+#if defined(LIBAXL_HAS_IO_URING)
+		if(r.backend == async_io_uring) {
+			while(!io_uring_pop(r.uring, &completion)) {
+				if(!io_uring_submit(r.uring, true)) {
+					r.failed = true;
+					return;
+				}
+			}
+			async_complete(r, completion);
+			while(io_uring_pop(r.uring, &completion))
+				async_complete(r, completion);
+			return;
+		}
+#endif
+
+		vector<async_completion> item{ &completion, 1, 1 };
+		dequeue_wait(*r.completions, item);
+		async_complete(r, completion);
+		while(dequeue(*r.completions, &completion))
+			async_complete(r, completion);
+	}
+}
+
+/**
+ *  Returns the completed data not yet released, oldest first, waiting
+ *  for the next slot if none is complete. Empty at the end of the file
+ *  or after a read error (see failed()).
+ */
+template <typename T>
+inline
+vector_pair<T> peek_read(async_reader<T>& r) {
+	detail::async_submit(r);
+
+	while(r.completed == r.released && r.completed < r.submitted && !r.failed) {
+		while(!r.slot_done[r.completed % (size_type)r.depth] && !r.failed)
+			detail::async_wait(r);
+
+		while(r.completed < r.submitted && r.slot_done[r.completed % (size_type)r.depth])
+			++r.completed;
+	}
+
+	index_type count = 0;
+	for(size_type s = r.released; s < r.completed; ++s)
+		count += r.slot_count[s % (size_type)r.depth];
+
+	//read() yields the elements just before the tail
+	circular_buffer<T> window_end = r.storage;
+	size_type start = (size_type)ring_index(r.released, r.depth) * (size_type)r.chunk;
+	window_end.tail = ring_index(start + (size_type)count, length(r.storage));
+
+	return read(window_end, count);
+}
+
+/**
+ *  Hands the first count elements of the last peeked window back for
+ *  refilling and starts the next reads.
+ *
+ *  Preconditions:
+ *  (1) count is a multiple of the chunk size, or the whole window
+ */
+template <typename T>
+inline
+void release_read(async_reader<T>& r, index_type count) {
+	while(count > 0) {
+		assert(r.released < r.completed);
+
+		index_type slot_count = r.slot_count[r.released % (size_type)r.depth];
+		assert(count >= slot_count || r.released + 1 == r.completed);
+
+		count -= minimum(count, slot_count);
+		++r.released;
+	}
+
+	detail::async_submit(r);
+}
+
+template <typename T>
+inline
+bool failed(const async_reader<T>& r) {
+	return r.failed;
+}
+}
+
+// LIBAXL_ASYNC_READER_GUARD
+#endif
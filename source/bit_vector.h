@@ -0,0 +1,560 @@
+
+#ifndef LIBAXL_BIT_VECTOR_GUARD
+#define LIBAXL_BIT_VECTOR_GUARD
+
+#include <cstdint>
+
+#include "util.h"
+#include "arena.h"
+#include "vectors.h"
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#if defined(__AVX512F__)
+#include <immintrin.h>
+#endif
+
+namespace libaxl {
+
+/**
+ *  A packed mask, bit i of the vector is bit i % 64 of words[i / 64].
+ *
+ *  The bits past count in the last word are always 0, so word-wise
+ *  kernels (popcount, logical operations) need no tail handling.
+ *
+ *  Masks are made from any mask expression with to_bit_vector, e.g.
+ *  to_bit_vector(arena, v < constant(0.5)), and consumed by compress
+ *  and the masked fill/copy_to.
+ */
+struct bit_vector {
+	uint64_t* words;
+	index_type count;
+};
+
+namespace detail {
+	inline
+	index_type word_count(index_type bits) {
+		return (bits + 63) / 64;
+	}
+
+	inline
+	index_type popcount64(uint64_t word) {
+#if defined(_MSC_VER)
+		return (index_type)__popcnt64(word);
+#else
+		return (index_type)__builtin_popcountll(word);
+#endif
+	}
+
+	//Preconditions: word != 0
+	inline
+	index_type trailing_zeros64(uint64_t word) {
+#if defined(_MSC_VER)
+		unsigned long index;
+		_BitScanForward64(&index, word);
+		return (index_type)index;
+#else
+		return (index_type)__builtin_ctzll(word);
+#endif
+	}
+
+	//Mask of the valid bits of the last word
+	inline
+	uint64_t tail_mask(index_type bits) {
+		index_type used = bits % 64;
+		return (used == 0) ? ~(uint64_t)0 : (((uint64_t)1 << used) - 1);
+	}
+}
+
+/**
+ *  Creates a bit vector of count bits, all 0.
+ */
+inline
+bit_vector make_bit_vector(arena* arena, index_type count) {
+	bit_vector result;
+
+	assert(arena != nullptr);
+	assert(count >= 0);
+
+	index_type words = detail::word_count(count);
+	result.words = allocate<uint64_t>(arena, words);
+	result.count = count;
+
+	memset(result.words, 0, (size_type)words * sizeof(uint64_t));
+
+	return result;
+}
+
+inline
+index_type length(bit_vector bv) {
+	return bv.count;
+}
+
+inline
+bool test(bit_vector bv, index_type index) {
+	assert(index >= 0 && index < bv.count);
+
+	return ((bv.words[index / 64] >> (index % 64)) & 1) != 0;
+}
+
+inline
+void set(bit_vector bv, index_type index, bool value = true) {
+	assert(index >= 0 && index < bv.count);
+
+	uint64_t bit = (uint64_t)1 << (index % 64);
+	uint64_t& word = bv.words[index / 64];
+	word = value ? (word | bit) : (word & ~bit);
+}
+
+/**
+ *  Packs a mask expression (a comparison, logical_and, ...) or a
+ *  vector<bool> into a new bit vector of length(mask) bits.
+ *
+ *  Each word is assembled from 64 mask elements without branches,
+ *  which compilers turn into vector compares and bit packing.
+ */
+template <typename M>
+inline
+bit_vector to_bit_vector(arena* arena, M mask) {
+	bit_vector result;
+
+	assert(arena != nullptr);
+
+	reset_shared(mask);
+
+	result.count = length(mask);
+	index_type words = detail::word_count(result.count);
+	result.words = allocate<uint64_t>(arena, words);
+
+	index_type full = result.count / 64;
+
+	for(index_type w = 0; w < full; ++w) {
+		uint64_t word = 0;
+		index_type base = w * 64;
+		for(index_type b = 0; b < 64; ++b)
+			word |= (uint64_t)(mask[base + b] ? 1 : 0) << b;
+		result.words[w] = word;
+	}
+
+	if(full < words) {
+		uint64_t word = 0;
+		index_type base = full * 64;
+		for(index_type b = 0; base + b < result.count; ++b)
+			word |= (uint64_t)(mask[base + b] ? 1 : 0) << b;
+		result.words[full] = word;
+	}
+
+	return result;
+}
+
+/**
+ *  The number of set bits.
+ */
+inline
+index_type popcount(bit_vector bv) {
+	index_type result = 0;
+	index_type words = detail::word_count(bv.count);
+
+	for(index_type w = 0; w < words; ++w)
+		result += detail::popcount64(bv.words[w]);
+
+	return result;
+}
+
+/**
+ *  The number of set bits before index.
+ *
+ *  Counts word by word, O(index / 64). For many queries on the same
+ *  vector build a bit_rank_directory first.
+ *
+ *  Preconditions:
+ *  (1) 0 <= index <= length(bv)
+ */
+inline
+index_type rank(bit_vector bv, index_type index) {
+	assert(index >= 0 && index <= bv.count);
+
+	index_type result = 0;
+	index_type full = index / 64;
+
+	for(index_type w = 0; w < full; ++w)
+		result += detail::popcount64(bv.words[w]);
+
+	if(index % 64 != 0)
+		result += detail::popcount64(bv.words[full] & detail::tail_mask(index));
+
+	return result;
+}
+
+/**
+ *  The position of the set bit of rank k (the k + 1-th set bit),
+ *  -1 if fewer than k + 1 bits are set.
+ *
+ *  Scans word by word, O(length(bv) / 64). For many queries on the
+ *  same vector build a bit_rank_directory first.
+ */
+inline
+index_type select(bit_vector bv, index_type k) {
+	assert(k >= 0);
+
+	index_type words = detail::word_count(bv.count);
+
+	for(index_type w = 0; w < words; ++w) {
+		uint64_t word = bv.words[w];
+		index_type bits = detail::popcount64(word);
+
+		if(k < bits) {
+			//Clear the k lowest set bits
+			for(; k > 0; --k)
+				word &= word - 1;
+			return w * 64 + detail::trailing_zeros64(word);
+		}
+
+		k -= bits;
+	}
+
+	return -1;
+}
+
+//
+//  Rank directory: set bits before each block of words
+//
+
+/**
+ *  counts[b] is the number of set bits before block b of
+ *  bit_rank_directory::block_words words, counts[block_count] is the
+ *  popcount. With it rank is O(1) and select O(log(length / 512)).
+ *
+ *  The directory describes the bits as they were when it was built,
+ *  it has to be rebuilt after set or other writes to the words.
+ */
+struct bit_rank_directory {
+	static constexpr index_type block_words = 8;
+
+	index_type* counts;
+	index_type block_count;
+};
+
+inline
+bit_rank_directory make_rank_directory(arena* arena, bit_vector bv) {
+	bit_rank_directory result;
+
+	assert(arena != nullptr);
+
+	index_type words = detail::word_count(bv.count);
+	result.block_count = (words + bit_rank_directory::block_words - 1) / bit_rank_directory::block_words;
+	result.counts = allocate<index_type>(arena, result.block_count + 1);
+
+	index_type total = 0;
+	for(index_type b = 0; b < result.block_count; ++b) {
+		result.counts[b] = total;
+
+		index_type end = minimum(words, (b + 1) * bit_rank_directory::block_words);
+		for(index_type w = b * bit_rank_directory::block_words; w < end; ++w)
+			total += detail::popcount64(bv.words[w]);
+	}
+	result.counts[result.block_count] = total;
+
+	return result;
+}
+
+/**
+ *  rank(bv, index) from the directory, at most block_words - 1 word
+ *  popcounts.
+ *
+ *  Preconditions:
+ *  (1) directory was made from bv with make_rank_directory
+ *  (2) 0 <= index <= length(bv)
+ */
+inline
+index_type rank(bit_vector bv, const bit_rank_directory& directory, index_type index) {
+	assert(index >= 0 && index <= bv.count);
+
+	index_type full = index / 64;
+	index_type block = full / bit_rank_directory::block_words;
+	index_type result = directory.counts[block];
+
+	for(index_type w = block * bit_rank_directory::block_words; w < full; ++w)
+		result += detail::popcount64(bv.words[w]);
+
+	if(index % 64 != 0)
+		result += detail::popcount64(bv.words[full] & detail::tail_mask(index));
+
+	return result;
+}
+
+/**
+ *  select(bv, k) from the directory: a binary search for the block,
+ *  then a scan of at most block_words words.
+ *
+ *  Preconditions:
+ *  (1) directory was made from bv with make_rank_directory
+ */
+inline
+index_type select(bit_vector bv, const bit_rank_directory& directory, index_type k) {
+	assert(k >= 0);
+
+	if(k >= directory.counts[directory.block_count])
+		return -1;
+
+	//The last block whose count is <= k
+	index_type low = 0;
+	index_type high = directory.block_count - 1;
+	while(low < high) {
+		index_type middle = low + (high - low + 1) / 2;
+		if(directory.counts[middle] <= k)
+			low = middle;
+		else
+			high = middle - 1;
+	}
+
+	k -= directory.counts[low];
+
+	index_type words = detail::word_count(bv.count);
+	index_type end = minimum(words, (low + 1) * bit_rank_directory::block_words);
+
+	for(index_type w = low * bit_rank_directory::block_words; w < end; ++w) {
+		uint64_t word = bv.words[w];
+		index_type bits = detail::popcount64(word);
+
+		if(k < bits) {
+			for(; k > 0; --k)
+				word &= word - 1;
+			return w * 64 + detail::trailing_zeros64(word);
+		}
+
+		k -= bits;
+	}
+
+	return -1;
+}
+
+//
+//  Logical operations, word by word
+//
+
+namespace detail {
+	template <typename Op>
+	inline
+	bit_vector combine_bits(arena* arena, bit_vector a, bit_vector b, Op op) {
+		assert(a.count == b.count);
+
+		bit_vector result = make_bit_vector(arena, a.count);
+		index_type words = word_count(a.count);
+
+		for(index_type w = 0; w < words; ++w)
+			result.words[w] = op(a.words[w], b.words[w]);
+
+		return result;
+	}
+}
+
+inline
+bit_vector logical_and(arena* arena, bit_vector a, bit_vector b) {
+	return detail::combine_bits(arena, a, b, [](uint64_t x, uint64_t y) { return x & y; });
+}
+
+inline
+bit_vector logical_or(arena* arena, bit_vector a, bit_vector b) {
+	return detail::combine_bits(arena, a, b, [](uint64_t x, uint64_t y) { return x | y; });
+}
+
+inline
+bit_vector logical_xor(arena* arena, bit_vector a, bit_vector b) {
+	return detail::combine_bits(arena, a, b, [](uint64_t x, uint64_t y) { return x ^ y; });
+}
+
+/**
+ *  a and not b.
+ */
+inline
+bit_vector logical_and_not(arena* arena, bit_vector a, bit_vector b) {
+	return detail::combine_bits(arena, a, b, [](uint64_t x, uint64_t y) { return x & ~y; });
+}
+
+inline
+bit_vector logical_not(arena* arena, bit_vector a) {
+	bit_vector result = make_bit_vector(arena, a.count);
+	index_type words = detail::word_count(a.count);
+
+	for(index_type w = 0; w < words; ++w)
+		result.words[w] = ~a.words[w];
+
+	if(words > 0)
+		result.words[words - 1] &= detail::tail_mask(a.count);
+
+	return result;
+}
+
+//
+//  Compress: the elements whose mask bit is set, in order
+//
+
+namespace detail {
+	/**
+	 *  Writes the selected elements of one word of mask to out, returns
+	 *  their number. Walks the set bits, so sparse words are cheap.
+	 */
+	template <typename T>
+	inline
+	index_type compress_word(const T* in, index_type stride, uint64_t word, T* out) {
+		index_type written = 0;
+
+		while(word != 0) {
+			out[written++] = in[trailing_zeros64(word) * stride];
+			word &= word - 1;
+		}
+
+		return written;
+	}
+
+#if defined(__AVX512F__)
+	//VPCOMPRESS into a register, 8 lanes at a time, then a masked store
+	//of the n packed lanes: the compress-to-memory form is microcoded on
+	//some cores
+
+	inline
+	index_type compress_word(const f64* in, index_type stride, uint64_t word, f64* out) {
+		if(stride != 1)
+			return compress_word<f64>(in, stride, word, out);
+
+		index_type written = 0;
+		for(index_type lane = 0; lane < 64; lane += 8) {
+			auto m = (__mmask8)(word >> lane);
+			__m512d packed = _mm512_maskz_compress_pd(m, _mm512_loadu_pd(in + lane));
+			index_type n = popcount64((uint64_t)m);
+			_mm512_mask_storeu_pd(out + written, (__mmask8)((1U << n) - 1), packed);
+			written += n;
+		}
+		return written;
+	}
+
+	inline
+	index_type compress_word(const f32* in, index_type stride, uint64_t word, f32* out) {
+		if(stride != 1)
+			return compress_word<f32>(in, stride, word, out);
+
+		index_type written = 0;
+		for(index_type lane = 0; lane < 64; lane += 16) {
+			auto m = (__mmask16)(word >> lane);
+			__m512 packed = _mm512_maskz_compress_ps(m, _mm512_loadu_ps(in + lane));
+			index_type n = popcount64((uint64_t)m);
+			_mm512_mask_storeu_ps(out + written, (__mmask16)((1U << n) - 1), packed);
+			written += n;
+		}
+		return written;
+	}
+#endif
+}
+
+/**
+ *  Writes the elements of in whose mask bit is set to the front of
+ *  out and returns the written part of out.
+ *
+ *  Preconditions:
+ *  (1) length(mask) == length(in)
+ *  (2) out is contiguous (stride 1)
+ *  (3) length(out) >= popcount(mask)
+ */
+template <typename T>
+inline
+vector<T> compress(vector<T> in, bit_vector mask, vector<T> out) {
+	assert(length(mask) == length(in));
+	assert(out.stride == 1);
+	assert(length(out) >= popcount(mask));
+
+	index_type full = mask.count / 64;
+	index_type written = 0;
+
+	for(index_type w = 0; w < full; ++w) {
+		uint64_t word = mask.words[w];
+		if(word != 0)
+			written += detail::compress_word(in.array + w * 64 * in.stride, in.stride, word, out.array + written);
+	}
+
+	//The tail word goes the scalar way, the SIMD loads would overrun in
+	if(full < detail::word_count(mask.count))
+		written += detail::compress_word<T>(in.array + full * 64 * in.stride, in.stride, mask.words[full], out.array + written);
+
+	out.count = written;
+	return out;
+}
+
+/**
+ *  The selected elements of in as a new vector of popcount(mask)
+ *  elements.
+ */
+template <typename T>
+inline
+vector<T> compress(arena* arena, vector<T> in, bit_vector mask) {
+	vector<T> out = make_uninitialized_vector<T>(arena, popcount(mask));
+	return compress(in, mask, out);
+}
+
+//
+//  Masked fill and copy
+//
+
+/**
+ *  v[i] = value where the mask bit i is set.
+ */
+template <typename T>
+inline
+void fill(vector<T> v, bit_vector mask, T value) {
+	assert(length(mask) == length(v));
+
+	index_type words = detail::word_count(mask.count);
+
+	for(index_type w = 0; w < words; ++w) {
+		uint64_t word = mask.words[w];
+		T* base = v.array + w * 64 * v.stride;
+
+		//All set is common in filters and vectorizes
+		if(word == ~(uint64_t)0) {
+			for(index_type b = 0; b < 64; ++b)
+				base[b * v.stride] = value;
+			continue;
+		}
+
+		while(word != 0) {
+			base[detail::trailing_zeros64(word) * v.stride] = value;
+			word &= word - 1;
+		}
+	}
+}
+
+/**
+ *  out[i] = in[i] where the mask bit i is set, the other elements of
+ *  out are left as they are.
+ */
+template <typename T>
+inline
+void copy_to(vector<T> in, vector<T> out, bit_vector mask) {
+	assert(length(mask) == length(in));
+	assert(length(out) >= length(in));
+
+	index_type words = detail::word_count(mask.count);
+
+	for(index_type w = 0; w < words; ++w) {
+		uint64_t word = mask.words[w];
+		const T* from = in.array + w * 64 * in.stride;
+		T* to = out.array + w * 64 * out.stride;
+
+		if(word == ~(uint64_t)0) {
+			for(index_type b = 0; b < 64; ++b)
+				to[b * out.stride] = from[b * in.stride];
+			continue;
+		}
+
+		while(word != 0) {
+			index_type b = detail::trailing_zeros64(word);
+			to[b * out.stride] = from[b * in.stride];
+			word &= word - 1;
+		}
+	}
+}
+}
+
+// LIBAXL_BIT_VECTOR_GUARD
+#endif
@@ -0,0 +1,226 @@
+
+#ifndef LIBAXL_CHUNKED_VECTOR_GUARD
+#define LIBAXL_CHUNKED_VECTOR_GUARD
+
+#include "util.h"
+#include "arena.h"
+#include "vectors.h"
+#include "vector_list.h"
+
+namespace libaxl {
+
+/**
+ *  A growable vector stored as a directory of fixed size chunks, for
+ *  logs and time series that grow without bound.
+ *
+ *  Appending never moves elements: a full chunk stays where it is and
+ *  a new one is allocated from the arena, so references and vector<T>
+ *  views of the contents stay valid while the vector grows. Only the
+ *  directory of chunk pointers is doubled when it fills up.
+ *
+ *  The chunk size is a power of two, element i is at
+ *  chunks[i >> chunk_shift][i & chunk_mask].
+ *
+ *  Kernels run chunk by chunk over segment(cv, 0 .. segment_count(cv)),
+ *  or over the vector_list of to_vector_list.
+ */
+template <typename T>
+struct chunked_vector {
+	T** chunks;
+	index_type directory_size;
+	index_type chunk_count;
+
+	index_type count;
+	index_type chunk_shift;
+	index_type chunk_mask;
+
+	arena* allocator;
+
+	ALWAYS_INLINE T& operator[](index_type index);
+};
+
+namespace detail {
+	//Default chunk size in bytes
+	const size_type chunk_bytes = 64 * 1024;
+	const size_type huge_page_size = 2 * 1024 * 1024;
+
+	/**
+	 *  Chunks are cache line aligned, page aligned when they span whole
+	 *  pages and huge page aligned when they span whole huge pages.
+	 */
+	inline
+	size_type chunk_alignment(size_type bytes) {
+		if(bytes % huge_page_size == 0)
+			return huge_page_size;
+		if(bytes % 4096 == 0)
+			return 4096;
+		return 64;
+	}
+
+	template <typename T>
+	inline
+	void add_chunk(chunked_vector<T>& cv) {
+		if(cv.chunk_count == cv.directory_size) {
+			index_type new_size = maximum<index_type>(2 * cv.directory_size, 8);
+			T** directory = allocate<T*>(cv.allocator, new_size);
+
+			for(index_type i = 0; i < cv.chunk_count; ++i)
+				directory[i] = cv.chunks[i];
+
+			cv.chunks = directory;
+			cv.directory_size = new_size;
+		}
+
+		size_type bytes = ((size_type)1 << cv.chunk_shift) * sizeof(T);
+		cv.chunks[cv.chunk_count] = (T*)cv.allocator->alloc(bytes, chunk_alignment(bytes));
+		++cv.chunk_count;
+	}
+}
+
+/**
+ *  Creates an empty chunked vector. chunk_size is the number of
+ *  elements per chunk, 0 for the largest power of two that fits in
+ *  64 KiB.
+ *
+ *  Preconditions:
+ *  (1) chunk_size is 0 or a power of two
+ */
+template <typename T>
+inline
+chunked_vector<T> make_chunked_vector(arena* arena, index_type chunk_size = 0) {
+	chunked_vector<T> result;
+
+	assert(arena != nullptr);
+	assert(chunk_size >= 0 && (chunk_size & (chunk_size - 1)) == 0);
+
+	if(chunk_size == 0) {
+		chunk_size = 1;
+		while((size_type)chunk_size * 2 * sizeof(T) <= detail::chunk_bytes)
+			chunk_size *= 2;
+	}
+
+	index_type shift = 0;
+	while(((index_type)1 << shift) < chunk_size)
+		++shift;
+
+	result.chunks = nullptr;
+	result.directory_size = 0;
+	result.chunk_count = 0;
+	result.count = 0;
+	result.chunk_shift = shift;
+	result.chunk_mask = chunk_size - 1;
+	result.allocator = arena;
+
+	return result;
+}
+
+template <typename T>
+inline
+index_type length(const chunked_vector<T>& cv) {
+	return cv.count;
+}
+
+template <typename T>
+inline
+index_type chunk_size(const chunked_vector<T>& cv) {
+	return cv.chunk_mask + 1;
+}
+
+/**
+ *  The number of non-empty chunks.
+ */
+template <typename T>
+inline
+index_type segment_count(const chunked_vector<T>& cv) {
+	return (cv.count + cv.chunk_mask) >> cv.chunk_shift;
+}
+
+/**
+ *  The used part of chunk index, all of it except for the last.
+ */
+template <typename T>
+inline
+vector<T> segment(const chunked_vector<T>& cv, index_type index) {
+	vector<T> result;
+
+	assert(index >= 0 && index < segment_count(cv));
+
+	result.array = cv.chunks[index];
+	result.count = minimum(cv.count - (index << cv.chunk_shift), chunk_size(cv));
+	result.stride = 1;
+
+	return result;
+}
+
+template <typename T>
+ALWAYS_INLINE
+T& chunked_vector<T>::operator[](index_type index) {
+	assert(index >= 0 && index < count);
+
+	return chunks[index >> chunk_shift][index & chunk_mask];
+}
+
+/**
+ *  Appends one element, amortized O(1).
+ */
+template <typename T>
+inline
+void append(chunked_vector<T>& cv, T value) {
+	if((cv.count >> cv.chunk_shift) == cv.chunk_count)
+		detail::add_chunk(cv);
+
+	cv.chunks[cv.count >> cv.chunk_shift][cv.count & cv.chunk_mask] = value;
+	++cv.count;
+}
+
+/**
+ *  Appends all of v, filling the last chunk and then whole new chunks.
+ */
+template <typename T>
+inline
+void append(chunked_vector<T>& cv, vector<T> v) {
+	while(!is_empty(v)) {
+		if((cv.count >> cv.chunk_shift) == cv.chunk_count)
+			detail::add_chunk(cv);
+
+		vector<T> free_space;
+		index_type used = cv.count & cv.chunk_mask;
+		free_space.array = cv.chunks[cv.count >> cv.chunk_shift] + used;
+		free_space.count = chunk_size(cv) - used;
+		free_space.stride = 1;
+
+		index_type copied = length(copy_to(v, free_space));
+		cv.count += copied;
+		v = drop(v, copied);
+	}
+}
+
+/**
+ *  Makes the length 0. The chunks are kept and refilled by later
+ *  appends.
+ */
+template <typename T>
+inline
+void clear(chunked_vector<T>& cv) {
+	cv.count = 0;
+}
+
+/**
+ *  The chunks as a vector_list, e.g. to evaluate lazy expressions over
+ *  the whole vector. The list is a snapshot: it does not see later
+ *  appends.
+ */
+template <typename T>
+inline
+vector_list<T> to_vector_list(arena* arena, const chunked_vector<T>& cv) {
+	vector_list<T> result = make_vector_list<T>(arena, segment_count(cv));
+
+	for(index_type i = 0; i < result.count; ++i)
+		result.v[i] = segment(cv, i);
+
+	return result;
+}
+}
+
+// LIBAXL_CHUNKED_VECTOR_GUARD
+#endif
@@ -12,12 +12,12 @@ namespace libaxl {
 template <typename T>
 struct circular_buffer {
 	vector<T> buf_vector;
-	int tail;
+	index_type tail;
 };
 
 template <typename T>
 inline
-circular_buffer<T> make_circular_buffer(arena* arena, int count) {
+circular_buffer<T> make_circular_buffer(arena* arena, index_type count) {
 	circular_buffer<T> result;
 
 	result.buf_vector = zeros<T>(arena, count);
@@ -28,7 +28,7 @@ circular_buffer<T> make_circular_buffer(arena* arena, int count) {
 
 template <typename T>
 inline
-circular_buffer<T> make_circular_buffer(vector<T> v, int tail = 0) {
+circular_buffer<T> make_circular_buffer(vector<T> v, index_type tail = 0) {
 	circular_buffer<T> result;
 
 	assert(tail >= 0);
@@ -46,6 +46,20 @@ index_type length(circular_buffer<T> c) {
 	return length(c.buf_vector);
 }
 
+/**
+ *  The slot that the position-th element ever written to a ring of
+ *  count slots occupies. Positions are free running counters, as used
+ *  by the concurrent rings built on circular_buffer.
+ */
+inline
+index_type ring_index(size_type position, index_type count) {
+	assert(count >= 1);
+
+	if((count & (count - 1)) == 0)
+		return (index_type)(position & (size_type)(count - 1));
+	return (index_type)(position % (size_type)count);
+}
+
 /**
  *  Rotates the circular buffer to the left.
  *
@@ -64,10 +78,10 @@ index_type length(circular_buffer<T> c) {
  */
 template <typename T>
 inline
-circular_buffer<T> rotate_left(circular_buffer<T> c, int count) {
-	int size = length(c);
+circular_buffer<T> rotate_left(circular_buffer<T> c, index_type count) {
+	index_type size = length(c);
 
-	int new_tail = c.tail + count;
+	index_type new_tail = c.tail + count;
 	if(new_tail >= size)
 		new_tail -= size;
 
@@ -93,11 +107,11 @@ circular_buffer<T> rotate_left(circular_buffer<T> c, int count) {
  */
 template <typename T>
 inline
-circular_buffer<T> rotate_right(circular_buffer<T> c, int count) {
-	int size = length(c);
+circular_buffer<T> rotate_right(circular_buffer<T> c, index_type count) {
+	index_type size = length(c);
 
 
-	int new_tail = c.tail - count;
+	index_type new_tail = c.tail - count;
 	if(new_tail < 0)
 		new_tail += size;
 
@@ -107,15 +121,15 @@ circular_buffer<T> rotate_right(circular_buffer<T> c, int count) {
 
 template <typename T>
 inline
-vector_pair<T> write(circular_buffer<T> c, int count) {
+vector_pair<T> write(circular_buffer<T> c, index_type count) {
 	vector_pair<T> result;
 
-	int size = length(c);
+	index_type size = length(c);
 	assert(count <= size);
 
 	result.v[0] = take_at_most(drop(c.buf_vector, c.tail), count);
 
-	int remaining_count = count - length(result.v[0]);
+	index_type remaining_count = count - length(result.v[0]);
 	result.v[1] = take_at_most(take(c.buf_vector, c.tail), remaining_count);
 
 	return result;
@@ -123,20 +137,20 @@ vector_pair<T> write(circular_buffer<T> c, int count) {
 
 template <typename T>
 inline
-vector_pair<T> read(circular_buffer<T> c, int count, int offset) {
+vector_pair<T> read(circular_buffer<T> c, index_type count, index_type offset) {
 	vector_pair<T> result;
 
-	int size = length(c);
+	index_type size = length(c);
 	assert(offset >= 0);
 	assert(count + offset <= size);
 
-	int read_tail = c.tail - (count + offset);
+	index_type read_tail = c.tail - (count + offset);
 	if(read_tail < 0)
 		read_tail += size;
 
 	result.v[0] = take_at_most(drop(c.buf_vector, read_tail), count);
 
-	int remaining_count = count - length(result.v[0]);
+	index_type remaining_count = count - length(result.v[0]);
 	result.v[1] = take_at_most(take(c.buf_vector, read_tail), remaining_count);
 
 	return result;
@@ -144,19 +158,19 @@ vector_pair<T> read(circular_buffer<T> c, int count, int offset) {
 
 template <typename T>
 inline
-vector_pair<T> read(circular_buffer<T> c, int count) {
+vector_pair<T> read(circular_buffer<T> c, index_type count) {
 	vector_pair<T> result;
 
-	int size = length(c);
+	index_type size = length(c);
 	assert(count <= size);
 
-	int read_tail = c.tail - count;
+	index_type read_tail = c.tail - count;
 	if(read_tail < 0)
 		read_tail += size;
 
 	result.v[0] = take_at_most(drop(c.buf_vector, read_tail), count);
 
-	int remaining_count = count - length(result.v[0]);
+	index_type remaining_count = count - length(result.v[0]);
 	result.v[1] = take_at_most(take(c.buf_vector, read_tail), remaining_count);
 
 	return result;
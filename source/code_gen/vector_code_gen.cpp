@@ -7,6 +7,7 @@
 #include "expr.h"
 #include "struct.h"
 #include "function.h"
+#include "../io_segments.h"
 
 using namespace libaxl;
 /*
@@ -261,11 +262,10 @@ void vector_codegen(vector_cg_settings settings) {
 
 	//write_include_guard(&context, settings.type_name, false);
 
-	FILE* file = fopen(settings.out_path, "wb");
-	if(file) {
-		fwrite(context.sb.memory, sizeof(char), context.sb.used, file);
-		fclose(file);
-	}
+	io_segment segment;
+	io_vec io = { &segment, 0, 1 };
+	add(io, context.sb.memory, (size_type)context.sb.used);
+	write_file(settings.out_path, io);
 }
 
 int main(int argc, char** argv) {
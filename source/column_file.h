@@ -0,0 +1,656 @@
+
+#ifndef LIBAXL_COLUMN_FILE_GUARD
+#define LIBAXL_COLUMN_FILE_GUARD
+
+#include <cstdio>
+#include <cmath>
+
+#include "util.h"
+#include "arena.h"
+#include "vectors.h"
+#include "mapped_vector.h"
+
+namespace libaxl {
+
+//
+//  Column files hold named vector<T> columns in native byte order:
+//
+//  [header, 64 bytes]
+//  [column payloads, each starting at a multiple of 64 bytes]
+//  [chunk statistics of all columns]
+//  [string table with the column names]
+//  [directory, one column_entry per column]
+//
+//  The directory and the names are written last, so the payloads can
+//  be streamed out while the file is being built; the header, patched
+//  on close, points to them. The string table uses the layout of the
+//  code generator's string table: every name is a string_info
+//  {length, FNV-1a hash} followed by the characters and a '\0', and is
+//  referred to by the offset of its first character.
+//
+//  Loading maps the file and hands out the payloads as vector<T>
+//  views of the mapping, nothing is copied.
+//
+
+enum column_type : uint32_t {
+	column_f64 = 1,
+	column_f32,
+	column_s8,
+	column_u8,
+	column_s16,
+	column_u16,
+	column_s32,
+	column_u32,
+	column_s64,
+	column_u64
+};
+
+template <typename T>
+struct column_type_of;
+
+template <> struct column_type_of<f64> { static const column_type value = column_f64; };
+template <> struct column_type_of<f32> { static const column_type value = column_f32; };
+template <> struct column_type_of<int8_t> { static const column_type value = column_s8; };
+template <> struct column_type_of<uint8_t> { static const column_type value = column_u8; };
+template <> struct column_type_of<int16_t> { static const column_type value = column_s16; };
+template <> struct column_type_of<uint16_t> { static const column_type value = column_u16; };
+template <> struct column_type_of<int32_t> { static const column_type value = column_s32; };
+template <> struct column_type_of<uint32_t> { static const column_type value = column_u32; };
+template <> struct column_type_of<int64_t> { static const column_type value = column_s64; };
+template <> struct column_type_of<uint64_t> { static const column_type value = column_u64; };
+
+struct column_file_header {
+	char magic[8];
+	uint32_t version;
+	uint32_t column_count;
+	uint64_t directory_offset;
+	uint64_t string_table_offset;
+	uint64_t string_table_size;
+	uint64_t file_size;
+	uint8_t reserved[16];
+};
+
+struct column_entry {
+	uint32_t name;
+	uint32_t type;
+	uint32_t element_size;
+	uint32_t alignment;
+	uint64_t count;
+	uint64_t payload_offset;
+	//0 if the column has no chunk statistics
+	uint64_t chunk_size;
+	uint64_t chunk_count;
+	uint64_t stats_offset;
+	uint8_t reserved[8];
+};
+
+/**
+ *  Statistics of chunk_size consecutive elements (fewer in the last
+ *  chunk). min/max are the extremes as f64, NaNs are skipped;
+ *  checksum is detail::column_checksum of the elements.
+ */
+struct column_chunk_stats {
+	uint64_t checksum;
+	f64 min;
+	f64 max;
+};
+
+static_assert(sizeof(column_file_header) == 64, "column file header must be 64 bytes");
+static_assert(sizeof(column_entry) == 64, "column entry must be 64 bytes");
+static_assert(sizeof(column_chunk_stats) == 24, "chunk statistics must be 24 bytes");
+
+namespace detail {
+	const char column_file_magic[8] = { 'L', 'A', 'X', 'L', 'C', 'O', 'L', '\0' };
+	const uint32_t column_file_version = 1;
+	const uint64_t column_alignment = 64;
+
+	const uint64_t column_hash_offset = 14695981039346656037ULL;
+	const uint64_t column_hash_prime = 1099511628211ULL;
+
+	struct column_name_info {
+		uint32_t length;
+		uint32_t hash;
+	};
+
+	inline
+	uint32_t column_name_hash(const char* name, uint32_t length) {
+		uint64_t hc = column_hash_offset;
+		for(uint32_t i = 0; i < length; ++i) {
+			hc ^= (unsigned char)name[i];
+			hc *= column_hash_prime;
+		}
+		return (uint32_t)hc;
+	}
+
+	/**
+	 *  FNV-1a over the elements widened to 64 bits, one multiply per
+	 *  element whatever its size.
+	 */
+	template <typename T>
+	inline
+	uint64_t column_checksum(uint64_t hc, T value) {
+		uint64_t bits = 0;
+		memcpy(&bits, &value, sizeof(T));
+		return (hc ^ bits) * column_hash_prime;
+	}
+
+	//Element size of a column type, 0 for unknown types
+	inline
+	uint64_t column_type_size(uint32_t type) {
+		switch(type) {
+			case column_f64:
+			case column_s64:
+			case column_u64:
+			return 8;
+			case column_f32:
+			case column_s32:
+			case column_u32:
+			return 4;
+			case column_s16:
+			case column_u16:
+			return 2;
+			case column_s8:
+			case column_u8:
+			return 1;
+			default:
+			return 0;
+		}
+	}
+
+	inline
+	uint64_t column_align(uint64_t offset) {
+		return (offset + column_alignment - 1) & ~(column_alignment - 1);
+	}
+}
+
+//
+//  Writing
+//
+
+/**
+ *  A column file being written. The directory, names and statistics
+ *  are gathered in allocator until close_column_file.
+ */
+struct column_file_writer {
+	FILE* file;
+	arena* allocator;
+	bool failed;
+	uint64_t position;
+
+	column_entry* columns;
+	const char** names;
+	column_chunk_stats** stats;
+	uint32_t column_count;
+	uint32_t column_capacity;
+};
+
+/**
+ *  Starts a column file with room for up to max_columns columns.
+ *  On failure the returned writer has file == nullptr.
+ */
+inline
+column_file_writer create_column_file(const char* path, arena* arena, uint32_t max_columns) {
+	column_file_writer result;
+
+	assert(path != nullptr);
+	assert(arena != nullptr);
+
+	result.file = fopen(path, "wb");
+	result.allocator = arena;
+	result.failed = (result.file == nullptr);
+	result.position = 0;
+
+	result.columns = allocate<column_entry>(arena, (index_type)max_columns);
+	result.names = allocate<const char*>(arena, (index_type)max_columns);
+	result.stats = allocate<column_chunk_stats*>(arena, (index_type)max_columns);
+	result.column_count = 0;
+	result.column_capacity = max_columns;
+
+	//Placeholder, patched by close_column_file
+	if(result.file) {
+		column_file_header header;
+		memset(&header, 0, sizeof(header));
+		if(fwrite(&header, sizeof(header), 1, result.file) != 1)
+			result.failed = true;
+		result.position = sizeof(header);
+	}
+
+	return result;
+}
+
+namespace detail {
+	inline
+	void column_write(column_file_writer& w, const void* data, size_type size) {
+		if(w.failed || size == 0)
+			return;
+		if(fwrite(data, 1, size, w.file) != size)
+			w.failed = true;
+		w.position += size;
+	}
+
+	inline
+	void column_pad(column_file_writer& w) {
+		static const unsigned char zeros[64] = {};
+		uint64_t aligned = column_align(w.position);
+		column_write(w, zeros, (size_type)(aligned - w.position));
+	}
+
+	template <typename T>
+	inline
+	void column_update_stats(column_chunk_stats& s, vector<T> chunk) {
+		uint64_t hc = s.checksum;
+		f64 low = s.min;
+		f64 high = s.max;
+
+		for(index_type i = 0; i < length(chunk); ++i) {
+			T value = chunk.array[i * chunk.stride];
+			hc = column_checksum(hc, value);
+
+			f64 x = (f64)value;
+			if(x < low)
+				low = x;
+			if(x > high)
+				high = x;
+		}
+
+		s.checksum = hc;
+		s.min = low;
+		s.max = high;
+	}
+
+	/**
+	 *  Writes v, contiguous data straight from its buffer and strided
+	 *  data through a small staging buffer.
+	 */
+	template <typename T>
+	inline
+	void column_write_elements(column_file_writer& w, vector<T> v) {
+		if(v.stride == 1) {
+			column_write(w, v.array, (size_type)length(v) * sizeof(T));
+			return;
+		}
+
+		const index_type staging_count = (index_type)(4096 / sizeof(T));
+		T staging[4096 / sizeof(T)];
+
+		while(!is_empty(v)) {
+			index_type count = minimum(length(v), staging_count);
+			for(index_type i = 0; i < count; ++i)
+				staging[i] = v.array[i * v.stride];
+
+			column_write(w, staging, (size_type)count * sizeof(T));
+			v = drop(v, count);
+		}
+	}
+}
+
+/**
+ *  Appends a column. With chunk_size > 0 a checksum and min/max are
+ *  recorded for every chunk_size elements.
+ *
+ *  Preconditions:
+ *  (1) name is unique in the file
+ *  (2) chunk_size >= 0
+ *
+ *  Returns false if the writer has failed or is full.
+ */
+template <typename T>
+inline
+bool add_column(column_file_writer& w, const char* name, vector<T> v, index_type chunk_size = 0) {
+	assert(name != nullptr);
+	assert(chunk_size >= 0);
+
+	if(w.failed || w.column_count == w.column_capacity)
+		return false;
+
+	detail::column_pad(w);
+
+	column_entry& entry = w.columns[w.column_count];
+	memset(&entry, 0, sizeof(entry));
+	entry.type = column_type_of<T>::value;
+	entry.element_size = (uint32_t)sizeof(T);
+	entry.alignment = (uint32_t)detail::column_alignment;
+	entry.count = (uint64_t)length(v);
+	entry.payload_offset = w.position;
+
+	column_chunk_stats* stats = nullptr;
+
+	if(chunk_size > 0 && !is_empty(v)) {
+		index_type chunk_count = (length(v) + chunk_size - 1) / chunk_size;
+		stats = allocate<column_chunk_stats>(w.allocator, chunk_count);
+
+		entry.chunk_size = (uint64_t)chunk_size;
+		entry.chunk_count = (uint64_t)chunk_count;
+
+		for(index_type c = 0; c < chunk_count; ++c) {
+			vector<T> chunk = take_at_most(drop(v, c * chunk_size), chunk_size);
+
+			stats[c].checksum = detail::column_hash_offset;
+			stats[c].min = INFINITY;
+			stats[c].max = -INFINITY;
+			detail::column_update_stats(stats[c], chunk);
+
+			detail::column_write_elements(w, chunk);
+		}
+	} else {
+		detail::column_write_elements(w, v);
+	}
+
+	w.names[w.column_count] = name;
+	w.stats[w.column_count] = stats;
+	++w.column_count;
+
+	return !w.failed;
+}
+
+/**
+ *  Writes the statistics, names and directory, patches the header and
+ *  closes the file. Returns false if anything failed on the way.
+ */
+inline
+bool close_column_file(column_file_writer& w) {
+	if(!w.file)
+		return false;
+
+	//Statistics
+	detail::column_pad(w);
+	for(uint32_t i = 0; i < w.column_count; ++i) {
+		column_entry& entry = w.columns[i];
+		if(entry.chunk_count > 0) {
+			entry.stats_offset = w.position;
+			detail::column_write(w, w.stats[i], (size_type)entry.chunk_count * sizeof(column_chunk_stats));
+		}
+	}
+
+	//String table, offset 0 is reserved as the null name
+	detail::column_pad(w);
+	uint64_t string_table_offset = w.position;
+	char null_name = '\0';
+	detail::column_write(w, &null_name, 1);
+
+	for(uint32_t i = 0; i < w.column_count; ++i) {
+		const char* name = w.names[i];
+
+		detail::column_name_info info;
+		info.length = (uint32_t)strlen(name);
+		info.hash = detail::column_name_hash(name, info.length);
+
+		detail::column_write(w, &info, sizeof(info));
+		w.columns[i].name = (uint32_t)(w.position - string_table_offset);
+		detail::column_write(w, name, (size_type)info.length + 1);
+	}
+	uint64_t string_table_size = w.position - string_table_offset;
+
+	//Directory
+	detail::column_pad(w);
+	uint64_t directory_offset = w.position;
+	detail::column_write(w, w.columns, (size_type)w.column_count * sizeof(column_entry));
+
+	column_file_header header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, detail::column_file_magic, sizeof(header.magic));
+	header.version = detail::column_file_version;
+	header.column_count = w.column_count;
+	header.directory_offset = directory_offset;
+	header.string_table_offset = string_table_offset;
+	header.string_table_size = string_table_size;
+	header.file_size = w.position;
+
+	if(!w.failed) {
+		if(fseek(w.file, 0, SEEK_SET) != 0 || fwrite(&header, sizeof(header), 1, w.file) != 1)
+			w.failed = true;
+	}
+
+	if(fclose(w.file) != 0)
+		w.failed = true;
+	w.file = nullptr;
+
+	return !w.failed;
+}
+
+//
+//  Reading
+//
+
+/**
+ *  A mapped column file. Column vectors handed out are views of the
+ *  mapping and valid until close_column_file.
+ *
+ *  The mapping is kept as a byte size_type rather than a vector, so
+ *  files may exceed index_type_max bytes; each column still holds at
+ *  most index_type_max elements.
+ */
+struct column_file {
+	unsigned char* data;
+	size_type size;
+	const column_file_header* header;
+	const column_entry* columns;
+	const char* strings;
+};
+
+namespace detail {
+	inline
+	bool column_range_valid(const column_file_header* header, uint64_t offset, uint64_t size) {
+		return offset <= header->file_size && size <= header->file_size - offset;
+	}
+
+	inline
+	bool column_file_valid(const column_file& f) {
+		const column_file_header* header = f.header;
+		auto file_size = (uint64_t)f.size;
+
+		if(file_size < sizeof(column_file_header))
+			return false;
+		if(memcmp(header->magic, column_file_magic, sizeof(header->magic)) != 0)
+			return false;
+		if(header->version != column_file_version || header->file_size != file_size)
+			return false;
+		if(!column_range_valid(header, header->directory_offset, (uint64_t)header->column_count * sizeof(column_entry)))
+			return false;
+		if(!column_range_valid(header, header->string_table_offset, header->string_table_size))
+			return false;
+
+		const column_entry* columns = (const column_entry*)(f.data + header->directory_offset);
+		for(uint32_t i = 0; i < header->column_count; ++i) {
+			const column_entry& entry = columns[i];
+
+			if(entry.count > (uint64_t)index_type_max || entry.element_size != column_type_size(entry.type))
+				return false;
+			if(entry.payload_offset % column_alignment != 0)
+				return false;
+			//The products below are bounded by the file size only once
+			//they are known not to wrap
+			if(entry.count > UINT64_MAX / entry.element_size)
+				return false;
+			if(!column_range_valid(header, entry.payload_offset, entry.count * entry.element_size))
+				return false;
+
+			uint64_t expected_chunks = 0;
+			if(entry.chunk_size > 0 && entry.count > 0)
+				expected_chunks = entry.count / entry.chunk_size + (entry.count % entry.chunk_size != 0 ? 1 : 0);
+			if(entry.chunk_count != expected_chunks)
+				return false;
+			if(entry.chunk_count > UINT64_MAX / sizeof(column_chunk_stats))
+				return false;
+			if(!column_range_valid(header, entry.stats_offset, entry.chunk_count * sizeof(column_chunk_stats)))
+				return false;
+
+			//find_column reads the name up to its '\0'
+			if(entry.name < sizeof(column_name_info) || entry.name >= header->string_table_size)
+				return false;
+			const char* name = (const char*)(f.data + header->string_table_offset + entry.name);
+			if(!memchr(name, '\0', (size_type)(header->string_table_size - entry.name)))
+				return false;
+		}
+
+		return true;
+	}
+}
+
+/**
+ *  Maps and validates the column file at path.
+ *  On failure the returned file has header == nullptr.
+ */
+inline
+column_file open_column_file(const char* path) {
+	column_file result;
+
+	assert(path != nullptr);
+
+	result.size = 0;
+	result.data = detail::map_file(path, 0, &result.size, map_read);
+	result.header = (const column_file_header*)result.data;
+	result.columns = nullptr;
+	result.strings = nullptr;
+
+	if(!result.data) {
+		result.size = 0;
+		return result;
+	}
+
+	if(!detail::column_file_valid(result)) {
+		detail::unmap_file(result.data, result.size);
+		result.data = nullptr;
+		result.size = 0;
+		result.header = nullptr;
+		return result;
+	}
+
+	result.columns = (const column_entry*)(result.data + result.header->directory_offset);
+	result.strings = (const char*)(result.data + result.header->string_table_offset);
+
+	return result;
+}
+
+inline
+void close_column_file(column_file& f) {
+	if(f.data)
+		detail::unmap_file(f.data, f.size);
+
+	f.data = nullptr;
+	f.size = 0;
+	f.header = nullptr;
+	f.columns = nullptr;
+	f.strings = nullptr;
+}
+
+inline
+index_type column_count(const column_file& f) {
+	return f.header ? (index_type)f.header->column_count : 0;
+}
+
+inline
+const char* column_name(const column_file& f, index_type column) {
+	assert(column >= 0 && column < column_count(f));
+
+	return f.strings + f.columns[column].name;
+}
+
+inline
+column_type type_of_column(const column_file& f, index_type column) {
+	assert(column >= 0 && column < column_count(f));
+
+	return (column_type)f.columns[column].type;
+}
+
+/**
+ *  The index of the column called name, -1 if there is none.
+ */
+inline
+index_type find_column(const column_file& f, const char* name) {
+	assert(name != nullptr);
+
+	auto length = (uint32_t)strlen(name);
+	uint32_t hash = detail::column_name_hash(name, length);
+
+	for(index_type i = 0; i < column_count(f); ++i) {
+		const char* candidate = column_name(f, i);
+
+		detail::column_name_info info;
+		memcpy(&info, candidate - sizeof(info), sizeof(info));
+
+		if(info.hash == hash && info.length == length && memcmp(candidate, name, length) == 0)
+			return i;
+	}
+
+	return -1;
+}
+
+/**
+ *  The payload of a column as a view of the mapping.
+ *
+ *  Preconditions:
+ *  (1) type_of_column(f, column) == column_type_of<T>::value
+ */
+template <typename T>
+inline
+vector<T> column(const column_file& f, index_type column) {
+	vector<T> result;
+
+	assert(column >= 0 && column < column_count(f));
+
+	const column_entry& entry = f.columns[column];
+	assert(entry.type == (uint32_t)column_type_of<T>::value);
+	assert(entry.element_size == sizeof(T));
+
+	result.array = (T*)(f.data + entry.payload_offset);
+	result.count = (index_type)entry.count;
+	result.stride = 1;
+
+	return result;
+}
+
+/**
+ *  The number of chunks with statistics, 0 if the column has none.
+ */
+inline
+index_type chunk_count(const column_file& f, index_type column) {
+	assert(column >= 0 && column < column_count(f));
+
+	return (index_type)f.columns[column].chunk_count;
+}
+
+inline
+column_chunk_stats chunk_stats(const column_file& f, index_type column, index_type chunk) {
+	assert(chunk >= 0 && chunk < chunk_count(f, column));
+
+	column_chunk_stats result;
+	memcpy(&result, f.data + f.columns[column].stats_offset + (size_type)chunk * sizeof(result), sizeof(result));
+
+	return result;
+}
+
+/**
+ *  The elements of one chunk, to be read after chunk_stats has shown
+ *  that the chunk is of interest.
+ */
+template <typename T>
+inline
+vector<T> column_chunk(const column_file& f, index_type column, index_type chunk) {
+	assert(chunk >= 0 && chunk < chunk_count(f, column));
+
+	auto chunk_size = (index_type)f.columns[column].chunk_size;
+	return take_at_most(drop(libaxl::column<T>(f, column), chunk * chunk_size), chunk_size);
+}
+
+/**
+ *  Recomputes the checksum of a chunk and compares it with the stored
+ *  one.
+ */
+template <typename T>
+inline
+bool verify_chunk(const column_file& f, index_type column, index_type chunk) {
+	column_chunk_stats stored = chunk_stats(f, column, chunk);
+
+	column_chunk_stats computed;
+	computed.checksum = detail::column_hash_offset;
+	computed.min = INFINITY;
+	computed.max = -INFINITY;
+	detail::column_update_stats(computed, column_chunk<T>(f, column, chunk));
+
+	return computed.checksum == stored.checksum;
+}
+}
+
+// LIBAXL_COLUMN_FILE_GUARD
+#endif
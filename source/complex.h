@@ -0,0 +1,352 @@
+
+#ifndef LIBAXL_COMPLEX_GUARD
+#define LIBAXL_COMPLEX_GUARD
+
+#include <cmath>
+
+#include "util.h"
+#include "arena.h"
+#include "vectors.h"
+
+namespace libaxl {
+
+/**
+ *  A complex number laid out as (re, im), so an array of them is the
+ *  interleaved re, im, re, im, ... layout.
+ */
+template <typename T>
+struct complex {
+	T re;
+	T im;
+};
+
+/**
+ *  Complex vector in split layout, one vector per channel.
+ */
+template <typename T>
+struct split_complex {
+	vector<T> re;
+	vector<T> im;
+};
+
+using complex_f32 = complex<f32>;
+using complex_f64 = complex<f64>;
+
+using vector_c32 = vector<complex<f32>>;
+using vector_c64 = vector<complex<f64>>;
+
+//
+//  scalar arithmetic, which also makes vector<complex<T>> usable in
+//  lazy expressions
+//
+
+template <typename T>
+inline
+complex<T> operator+(complex<T> a, complex<T> b) {
+	return complex<T>{ a.re + b.re, a.im + b.im };
+}
+
+template <typename T>
+inline
+complex<T> operator-(complex<T> a, complex<T> b) {
+	return complex<T>{ a.re - b.re, a.im - b.im };
+}
+
+template <typename T>
+inline
+complex<T> operator*(complex<T> a, complex<T> b) {
+	return complex<T>{ a.re * b.re - a.im * b.im, a.re * b.im + a.im * b.re };
+}
+
+template <typename T>
+inline
+complex<T> conjugate(complex<T> a) {
+	return complex<T>{ a.re, -a.im };
+}
+
+template <typename T>
+inline
+T magnitude(complex<T> a) {
+	return std::sqrt(a.re * a.re + a.im * a.im);
+}
+
+//
+//  views
+//
+
+/**
+ *  The real channel of an interleaved vector, a stride 2 view.
+ */
+template <typename T>
+inline
+vector<T> real(vector<complex<T>> v) {
+	vector<T> result;
+
+	result.array = &v.array->re;
+	result.count = v.count;
+	result.stride = 2 * v.stride;
+
+	return result;
+}
+
+/**
+ *  The imaginary channel of an interleaved vector, a stride 2 view.
+ */
+template <typename T>
+inline
+vector<T> imag(vector<complex<T>> v) {
+	vector<T> result;
+
+	result.array = &v.array->im;
+	result.count = v.count;
+	result.stride = 2 * v.stride;
+
+	return result;
+}
+
+/**
+ *  Views raw interleaved scalars, e.g. as read from a file, as complex
+ *  numbers.
+ *
+ *  Preconditions:
+ *  (1) v is contiguous (stride 1)
+ *  (2) length(v) is even
+ */
+template <typename T>
+inline
+vector<complex<T>> as_complex(vector<T> v) {
+	vector<complex<T>> result;
+
+	assert(v.stride == 1);
+	assert(length(v) % 2 == 0);
+
+	result.array = (complex<T>*)v.array;
+	result.count = v.count / 2;
+	result.stride = 1;
+
+	return result;
+}
+
+template <typename T>
+inline
+index_type length(split_complex<T> v) {
+	return length(v.re);
+}
+
+template <typename T>
+inline
+split_complex<T> make_split_complex(arena* arena, index_type count) {
+	split_complex<T> result;
+
+	result.re = make_uninitialized_vector<T>(arena, count);
+	result.im = make_uninitialized_vector<T>(arena, count);
+
+	return result;
+}
+
+template <typename T>
+inline
+split_complex<T> take(split_complex<T> v, index_type count) {
+	return split_complex<T>{ take(v.re, count), take(v.im, count) };
+}
+
+template <typename T>
+inline
+split_complex<T> drop(split_complex<T> v, index_type count) {
+	return split_complex<T>{ drop(v.re, count), drop(v.im, count) };
+}
+
+//
+//  layout conversion
+//
+
+/**
+ *  Splits interleaved in into out.re and out.im.
+ *  Returns out truncated to the elements written.
+ */
+template <typename T>
+inline
+split_complex<T> deinterleave(vector<complex<T>> in, split_complex<T> out) {
+	auto count = minimum(length(in), length(out));
+
+	if(in.stride == 1 && out.re.stride == 1 && out.im.stride == 1) {
+		const T* source = &in.array->re;
+		T* re = out.re.array;
+		T* im = out.im.array;
+
+		for(index_type i = 0; i < count; ++i) {
+			re[i] = source[2 * i];
+			im[i] = source[2 * i + 1];
+		}
+	} else {
+		for(index_type i = 0; i < count; ++i) {
+			complex<T> value = in.array[i * in.stride];
+			out.re.array[i * out.re.stride] = value.re;
+			out.im.array[i * out.im.stride] = value.im;
+		}
+	}
+
+	return take(out, count);
+}
+
+template <typename T>
+inline
+split_complex<T> deinterleave(vector<complex<T>> in, arena* arena) {
+	return deinterleave(in, make_split_complex<T>(arena, length(in)));
+}
+
+/**
+ *  Merges in.re and in.im into interleaved out.
+ *  Returns out truncated to the elements written.
+ */
+template <typename T>
+inline
+vector<complex<T>> interleave(split_complex<T> in, vector<complex<T>> out) {
+	auto count = minimum(length(in), length(out));
+
+	if(out.stride == 1 && in.re.stride == 1 && in.im.stride == 1) {
+		T* destination = &out.array->re;
+		const T* re = in.re.array;
+		const T* im = in.im.array;
+
+		for(index_type i = 0; i < count; ++i) {
+			destination[2 * i] = re[i];
+			destination[2 * i + 1] = im[i];
+		}
+	} else {
+		for(index_type i = 0; i < count; ++i) {
+			out.array[i * out.stride] = complex<T>{ in.re.array[i * in.re.stride], in.im.array[i * in.im.stride] };
+		}
+	}
+
+	return take(out, count);
+}
+
+template <typename T>
+inline
+vector<complex<T>> interleave(split_complex<T> in, arena* arena) {
+	return interleave(in, make_uninitialized_vector<complex<T>>(arena, length(in)));
+}
+
+//
+//  interleaved kernels, out may alias a or b
+//
+
+template <typename T>
+inline
+void multiply(vector<complex<T>> a, vector<complex<T>> b, vector<complex<T>> out) {
+	auto count = minimum(minimum(length(a), length(b)), length(out));
+
+	if(a.stride == 1 && b.stride == 1 && out.stride == 1) {
+		const T* x = &a.array->re;
+		const T* y = &b.array->re;
+		T* z = &out.array->re;
+
+		for(index_type i = 0; i < count; ++i) {
+			T x_re = x[2 * i], x_im = x[2 * i + 1];
+			T y_re = y[2 * i], y_im = y[2 * i + 1];
+
+			z[2 * i] = x_re * y_re - x_im * y_im;
+			z[2 * i + 1] = x_re * y_im + x_im * y_re;
+		}
+	} else {
+		for(index_type i = 0; i < count; ++i) {
+			out.array[i * out.stride] = a.array[i * a.stride] * b.array[i * b.stride];
+		}
+	}
+}
+
+template <typename T>
+inline
+void conjugate(vector<complex<T>> in, vector<complex<T>> out) {
+	auto count = minimum(length(in), length(out));
+
+	for(index_type i = 0; i < count; ++i) {
+		out.array[i * out.stride] = conjugate(in.array[i * in.stride]);
+	}
+}
+
+template <typename T>
+inline
+void magnitude(vector<complex<T>> in, vector<T> out) {
+	auto count = minimum(length(in), length(out));
+
+	if(in.stride == 1 && out.stride == 1) {
+		const T* x = &in.array->re;
+		T* y = out.array;
+
+		for(index_type i = 0; i < count; ++i) {
+			T re = x[2 * i], im = x[2 * i + 1];
+			y[i] = std::sqrt(re * re + im * im);
+		}
+	} else {
+		for(index_type i = 0; i < count; ++i) {
+			out.array[i * out.stride] = magnitude(in.array[i * in.stride]);
+		}
+	}
+}
+
+//
+//  split kernels, out may alias a or b
+//
+
+template <typename T>
+inline
+void multiply(split_complex<T> a, split_complex<T> b, split_complex<T> out) {
+	auto count = minimum(minimum(length(a), length(b)), length(out));
+
+	if(a.re.stride == 1 && a.im.stride == 1 && b.re.stride == 1 && b.im.stride == 1 &&
+		out.re.stride == 1 && out.im.stride == 1)
+	{
+		for(index_type i = 0; i < count; ++i) {
+			T x_re = a.re.array[i], x_im = a.im.array[i];
+			T y_re = b.re.array[i], y_im = b.im.array[i];
+
+			out.re.array[i] = x_re * y_re - x_im * y_im;
+			out.im.array[i] = x_re * y_im + x_im * y_re;
+		}
+	} else {
+		for(index_type i = 0; i < count; ++i) {
+			T x_re = a.re[i], x_im = a.im[i];
+			T y_re = b.re[i], y_im = b.im[i];
+
+			out.re[i] = x_re * y_re - x_im * y_im;
+			out.im[i] = x_re * y_im + x_im * y_re;
+		}
+	}
+}
+
+template <typename T>
+inline
+void conjugate(split_complex<T> in, split_complex<T> out) {
+	auto count = minimum(length(in), length(out));
+
+	if(in.re.array != out.re.array || in.re.stride != out.re.stride)
+		copy_to(take(in.re, count), out.re);
+
+	for(index_type i = 0; i < count; ++i) {
+		out.im.array[i * out.im.stride] = -in.im.array[i * in.im.stride];
+	}
+}
+
+template <typename T>
+inline
+void magnitude(split_complex<T> in, vector<T> out) {
+	auto count = minimum(length(in), length(out));
+
+	if(in.re.stride == 1 && in.im.stride == 1 && out.stride == 1) {
+		for(index_type i = 0; i < count; ++i) {
+			T re = in.re.array[i], im = in.im.array[i];
+			out.array[i] = std::sqrt(re * re + im * im);
+		}
+	} else {
+		for(index_type i = 0; i < count; ++i) {
+			T re = in.re[i], im = in.im[i];
+			out[i] = std::sqrt(re * re + im * im);
+		}
+	}
+}
+}
+
+// LIBAXL_COMPLEX_GUARD
+#endif
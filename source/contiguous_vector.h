@@ -0,0 +1,73 @@
+
+#ifndef LIBAXL_CONTIGUOUS_VECTOR_GUARD
+#define LIBAXL_CONTIGUOUS_VECTOR_GUARD
+
+#include "util.h"
+#include "vectors.h"
+
+namespace libaxl {
+
+/**
+ *  A vector with a compile-time stride of 1.
+ *
+ *  Indexing is a plain array[index], without the index * stride
+ *  multiply of vector<T>, which lets the compiler vectorize loops
+ *  over it. Obtained from a vector<T> whose stride has been checked
+ *  to be 1, see make_contiguous_vector.
+ */
+template <typename T>
+struct contiguous_vector {
+	T* array;
+	index_type count;
+
+	ALWAYS_INLINE T& operator[](index_type index) {
+		assert(index >= 0 && index < count); // Bounds checking
+
+		return array[index];
+	}
+};
+
+template <typename T>
+inline
+index_type length(contiguous_vector<T> v) {
+	return v.count;
+}
+
+template <typename T>
+ALWAYS_INLINE
+bool is_contiguous(vector<T> v) {
+	return v.stride == 1;
+}
+
+/**
+ *  Preconditions:
+ *  (1) v.stride == 1
+ */
+template <typename T>
+inline
+contiguous_vector<T> make_contiguous_vector(vector<T> v) {
+	contiguous_vector<T> result;
+
+	assert(is_contiguous(v));
+
+	result.array = v.array;
+	result.count = v.count;
+
+	return result;
+}
+
+template <typename T>
+inline
+vector<T> to_vector(contiguous_vector<T> v) {
+	vector<T> result;
+
+	result.array = v.array;
+	result.count = v.count;
+	result.stride = 1;
+
+	return result;
+}
+}
+
+// LIBAXL_CONTIGUOUS_VECTOR_GUARD
+#endif
@@ -0,0 +1,472 @@
+
+#ifndef LIBAXL_FFT_GUARD
+#define LIBAXL_FFT_GUARD
+
+#include <cmath>
+
+#include "util.h"
+#include "arena.h"
+#include "vectors.h"
+#include "complex.h"
+
+namespace libaxl {
+
+/**
+ *  Precomputed tables for complex transforms of one size.
+ *
+ *  size = 2^k * leaf_size with leaf_size odd. The factors of two are
+ *  done by radix-2 butterflies, the odd leaves by a direct DFT.
+ *
+ *  stage_re/im hold the butterfly twiddles exp(-2 pi i j / (2 h)),
+ *  j < h, of the stage with half size h contiguously at offset
+ *  h - leaf_size, so every butterfly loop reads its twiddles with
+ *  stride 1. twiddle_re/im hold the full circle exp(-2 pi i j / size)
+ *  for the leaves. permutation is the bit reversal used by the
+ *  iterative path (leaf_size == 1 only).
+ *
+ *  A plan is read-only once made and may be shared between threads.
+ *
+ *  The module is f64 only. There are no f32 kernels, no hand written
+ *  SIMD butterflies (the unit stride loops are left to the compiler)
+ *  and no radix-3/5 kernels: sizes with odd factors pay O(leaf_size^2)
+ *  per leaf. These are out of scope until a user needs them.
+ */
+struct fft_plan {
+	index_type size;
+	index_type leaf_size;
+	vector_f64 stage_re;
+	vector_f64 stage_im;
+	vector_f64 twiddle_re;
+	vector_f64 twiddle_im;
+	index_type* permutation;
+};
+
+/**
+ *  Tables for real-input transforms of size n, done as a complex
+ *  transform of size n / 2 on the even/odd samples.
+ *
+ *  half is the plan of that transform, twiddle_re/im hold
+ *  exp(-2 pi i k / n) for k <= n / 4. Read-only once made like
+ *  fft_plan, irfft works in its input instead of plan scratch.
+ */
+struct rfft_plan {
+	index_type size;
+	fft_plan half;
+	vector_f64 twiddle_re;
+	vector_f64 twiddle_im;
+};
+
+namespace detail {
+	const f64 fft_pi = 3.14159265358979323846;
+}
+
+/**
+ *  Preconditions:
+ *  (1) n >= 1
+ */
+inline
+fft_plan make_fft_plan(arena* arena, index_type n) {
+	fft_plan result;
+
+	assert(arena != nullptr);
+	assert(n >= 1);
+
+	index_type leaf_size = n;
+	while(leaf_size % 2 == 0)
+		leaf_size /= 2;
+
+	result.size = n;
+	result.leaf_size = leaf_size;
+
+	result.twiddle_re = make_uninitialized_vector<f64>(arena, n);
+	result.twiddle_im = make_uninitialized_vector<f64>(arena, n);
+	for(index_type j = 0; j < n; ++j) {
+		f64 angle = -2.0 * detail::fft_pi * (f64)j / (f64)n;
+		result.twiddle_re.array[j] = std::cos(angle);
+		result.twiddle_im.array[j] = std::sin(angle);
+	}
+
+	//Stages h = leaf_size, 2 leaf_size, ..., n / 2
+	index_type stage_count = maximum(n - leaf_size, (index_type)1);
+	result.stage_re = make_uninitialized_vector<f64>(arena, stage_count);
+	result.stage_im = make_uninitialized_vector<f64>(arena, stage_count);
+	for(index_type h = leaf_size; h < n; h *= 2) {
+		index_type step = n / (2 * h);
+		for(index_type j = 0; j < h; ++j) {
+			result.stage_re.array[h - leaf_size + j] = result.twiddle_re.array[j * step];
+			result.stage_im.array[h - leaf_size + j] = result.twiddle_im.array[j * step];
+		}
+	}
+
+	result.permutation = nullptr;
+	if(leaf_size == 1) {
+		result.permutation = allocate<index_type>(arena, n);
+		result.permutation[0] = 0;
+		for(index_type i = 1, j = 0; i < n; ++i) {
+			index_type bit = n >> 1;
+			for(; j & bit; bit >>= 1)
+				j ^= bit;
+			j ^= bit;
+			result.permutation[i] = j;
+		}
+	}
+
+	return result;
+}
+
+/**
+ *  Preconditions:
+ *  (1) n >= 2 and n is even
+ */
+inline
+rfft_plan make_rfft_plan(arena* arena, index_type n) {
+	rfft_plan result;
+
+	assert(arena != nullptr);
+	assert(n >= 2 && n % 2 == 0);
+
+	index_type half = n / 2;
+
+	result.size = n;
+	result.half = make_fft_plan(arena, half);
+
+	result.twiddle_re = make_uninitialized_vector<f64>(arena, half / 2 + 1);
+	result.twiddle_im = make_uninitialized_vector<f64>(arena, half / 2 + 1);
+	for(index_type k = 0; k <= half / 2; ++k) {
+		f64 angle = -2.0 * detail::fft_pi * (f64)k / (f64)n;
+		result.twiddle_re.array[k] = std::cos(angle);
+		result.twiddle_im.array[k] = std::sin(angle);
+	}
+
+	return result;
+}
+
+inline
+index_type length(const fft_plan& plan) {
+	return plan.size;
+}
+
+inline
+index_type length(const rfft_plan& plan) {
+	return plan.size;
+}
+
+namespace detail {
+	/**
+	 *  Combines the transforms of the even and odd samples, stored in
+	 *  [re, re + h) and [re + h, re + 2 h), into one of size 2 h.
+	 */
+	inline
+	void fft_butterflies(f64* re, f64* im, const f64* w_re, const f64* w_im, index_type h) {
+		f64* odd_re = re + h;
+		f64* odd_im = im + h;
+
+		for(index_type j = 0; j < h; ++j) {
+			f64 t_re = odd_re[j] * w_re[j] - odd_im[j] * w_im[j];
+			f64 t_im = odd_re[j] * w_im[j] + odd_im[j] * w_re[j];
+
+			odd_re[j] = re[j] - t_re;
+			odd_im[j] = im[j] - t_im;
+			re[j] += t_re;
+			im[j] += t_im;
+		}
+	}
+
+	/**
+	 *  Direct DFT of an odd sized leaf, n = plan.size / twiddle_step.
+	 */
+	inline
+	void fft_leaf(const fft_plan& plan, vector_f64 in_re, vector_f64 in_im,
+		f64* out_re, f64* out_im, index_type twiddle_step)
+	{
+		index_type n = length(in_re);
+
+		if(n == 1) {
+			out_re[0] = in_re[0];
+			out_im[0] = in_im[0];
+			return;
+		}
+
+		const f64* w_re = plan.twiddle_re.array;
+		const f64* w_im = plan.twiddle_im.array;
+
+		for(index_type k = 0; k < n; ++k) {
+			f64 acc_re = 0.0;
+			f64 acc_im = 0.0;
+			index_type w = 0;
+
+			for(index_type j = 0; j < n; ++j) {
+				f64 x_re = in_re[j];
+				f64 x_im = in_im[j];
+				acc_re += x_re * w_re[w * twiddle_step] - x_im * w_im[w * twiddle_step];
+				acc_im += x_re * w_im[w * twiddle_step] + x_im * w_re[w * twiddle_step];
+
+				w += k;
+				if(w >= n)
+					w -= n;
+			}
+
+			out_re[k] = acc_re;
+			out_im[k] = acc_im;
+		}
+	}
+
+	/**
+	 *  Recursive decimation in time on strided views: the even samples
+	 *  are drop_odd(x), the odd samples drop_even(x).
+	 */
+	inline
+	void fft_recursive(const fft_plan& plan, vector_f64 in_re, vector_f64 in_im,
+		f64* out_re, f64* out_im, index_type twiddle_step)
+	{
+		index_type n = length(in_re);
+
+		if(n == plan.leaf_size) {
+			fft_leaf(plan, in_re, in_im, out_re, out_im, twiddle_step);
+			return;
+		}
+
+		index_type h = n / 2;
+
+		fft_recursive(plan, drop_odd(in_re), drop_odd(in_im), out_re, out_im, 2 * twiddle_step);
+		fft_recursive(plan, drop_even(in_re), drop_even(in_im), out_re + h, out_im + h, 2 * twiddle_step);
+
+		fft_butterflies(out_re, out_im,
+			plan.stage_re.array + (h - plan.leaf_size), plan.stage_im.array + (h - plan.leaf_size), h);
+	}
+
+	/**
+	 *  Iterative radix-2 for power of two sizes: one bit reversed
+	 *  gather into out, then log2(n) passes of contiguous butterflies.
+	 */
+	inline
+	void fft_iterative(const fft_plan& plan, vector_f64 in_re, vector_f64 in_im, f64* out_re, f64* out_im) {
+		index_type n = plan.size;
+		const index_type* permutation = plan.permutation;
+
+		if(in_re.stride == 1 && in_im.stride == 1) {
+			for(index_type i = 0; i < n; ++i) {
+				out_re[i] = in_re.array[permutation[i]];
+				out_im[i] = in_im.array[permutation[i]];
+			}
+		} else {
+			for(index_type i = 0; i < n; ++i) {
+				out_re[i] = in_re[permutation[i]];
+				out_im[i] = in_im[permutation[i]];
+			}
+		}
+
+		for(index_type h = 1; h < n; h *= 2) {
+			const f64* w_re = plan.stage_re.array + (h - 1);
+			const f64* w_im = plan.stage_im.array + (h - 1);
+
+			for(index_type start = 0; start < n; start += 2 * h) {
+				fft_butterflies(out_re + start, out_im + start, w_re, w_im, h);
+			}
+		}
+	}
+
+	inline
+	void fft_forward(const fft_plan& plan, vector_f64 in_re, vector_f64 in_im, f64* out_re, f64* out_im) {
+		if(plan.leaf_size == 1)
+			fft_iterative(plan, in_re, in_im, out_re, out_im);
+		else
+			fft_recursive(plan, in_re, in_im, out_re, out_im, 1);
+	}
+
+	inline
+	void fft_scale(f64* re, f64* im, index_type n, f64 scale) {
+		for(index_type i = 0; i < n; ++i) {
+			re[i] *= scale;
+			im[i] *= scale;
+		}
+	}
+}
+
+/**
+ *  out = DFT(in), out[k] = sum_j in[j] exp(-2 pi i j k / n).
+ *
+ *  The input views may have any stride; the output is written out of
+ *  place and must be contiguous.
+ *
+ *  Preconditions:
+ *  (1) all four vectors have length(plan) elements
+ *  (2) out_re and out_im are contiguous (stride 1)
+ *  (3) the output does not overlap the input
+ */
+inline
+void fft(const fft_plan& plan, vector_f64 in_re, vector_f64 in_im, vector_f64 out_re, vector_f64 out_im) {
+	assert(length(in_re) == plan.size && length(in_im) == plan.size);
+	assert(length(out_re) == plan.size && length(out_im) == plan.size);
+	assert(out_re.stride == 1 && out_im.stride == 1);
+
+	detail::fft_forward(plan, in_re, in_im, out_re.array, out_im.array);
+}
+
+/**
+ *  out = inverse DFT(in), scaled by 1 / n so that ifft(fft(x)) == x.
+ *  Same preconditions as fft.
+ */
+inline
+void ifft(const fft_plan& plan, vector_f64 in_re, vector_f64 in_im, vector_f64 out_re, vector_f64 out_im) {
+	assert(length(in_re) == plan.size && length(in_im) == plan.size);
+	assert(length(out_re) == plan.size && length(out_im) == plan.size);
+	assert(out_re.stride == 1 && out_im.stride == 1);
+
+	//conj(DFT(conj(x))), with the conjugations done by swapping re/im
+	detail::fft_forward(plan, in_im, in_re, out_im.array, out_re.array);
+	detail::fft_scale(out_re.array, out_im.array, plan.size, 1.0 / (f64)plan.size);
+}
+
+/**
+ *  Split layout forms, interleaved input is read through its stride 2
+ *  real/imag views.
+ */
+inline
+void fft(const fft_plan& plan, split_complex<f64> in, split_complex<f64> out) {
+	fft(plan, in.re, in.im, out.re, out.im);
+}
+
+inline
+void fft(const fft_plan& plan, vector_c64 in, split_complex<f64> out) {
+	fft(plan, real(in), imag(in), out.re, out.im);
+}
+
+inline
+void ifft(const fft_plan& plan, split_complex<f64> in, split_complex<f64> out) {
+	ifft(plan, in.re, in.im, out.re, out.im);
+}
+
+/**
+ *  The first n / 2 + 1 bins of the DFT of the real signal in, the
+ *  others being their conjugates.
+ *
+ *  Preconditions:
+ *  (1) length(in) == length(plan)
+ *  (2) length(out_re) == length(out_im) == length(plan) / 2 + 1
+ *  (3) out_re and out_im are contiguous (stride 1)
+ *  (4) the output does not overlap the input
+ */
+inline
+void rfft(const rfft_plan& plan, vector_f64 in, vector_f64 out_re, vector_f64 out_im) {
+	index_type half = plan.size / 2;
+
+	assert(length(in) == plan.size);
+	assert(length(out_re) == half + 1 && length(out_im) == half + 1);
+	assert(out_re.stride == 1 && out_im.stride == 1);
+
+	f64* re = out_re.array;
+	f64* im = out_im.array;
+	const f64* w_re = plan.twiddle_re.array;
+	const f64* w_im = plan.twiddle_im.array;
+
+	//z[k] = in[2 k] + i in[2 k + 1]
+	detail::fft_forward(plan.half, drop_odd(in), drop_even(in), re, im);
+
+	f64 z0_re = re[0];
+	f64 z0_im = im[0];
+	re[0] = z0_re + z0_im;
+	im[0] = 0.0;
+	re[half] = z0_re - z0_im;
+	im[half] = 0.0;
+
+	//X[k] = E[k] + w^k O[k], E/O the transforms of the even/odd
+	//samples, recovered from z[k] and z[half - k] together
+	for(index_type k = 1; k <= half / 2; ++k) {
+		index_type j = half - k;
+
+		f64 zk_re = re[k], zk_im = im[k];
+		f64 zj_re = re[j], zj_im = im[j];
+
+		f64 e_re = 0.5 * (zk_re + zj_re);
+		f64 e_im = 0.5 * (zk_im - zj_im);
+		f64 o_re = 0.5 * (zk_im + zj_im);
+		f64 o_im = -0.5 * (zk_re - zj_re);
+
+		f64 t_re = w_re[k] * o_re - w_im[k] * o_im;
+		f64 t_im = w_re[k] * o_im + w_im[k] * o_re;
+
+		re[k] = e_re + t_re;
+		im[k] = e_im + t_im;
+
+		//w^j = -conj(w^k)
+		re[j] = e_re - t_re;
+		im[j] = t_im - e_im;
+	}
+}
+
+/**
+ *  The real signal whose first n / 2 + 1 DFT bins are in, the inverse
+ *  of rfft. The imaginary parts of in[0] and in[n / 2] are ignored.
+ *
+ *  in_re and in_im are overwritten: they are the work space of the
+ *  half size transform once the input has been read, so the plan stays
+ *  read-only and can be shared between threads. Copy the spectrum
+ *  first if it is still needed.
+ *
+ *  Preconditions:
+ *  (1) length(in_re) == length(in_im) == length(plan) / 2 + 1
+ *  (2) in_re and in_im are contiguous (stride 1)
+ *  (3) length(out) == length(plan)
+ *  (4) out does not overlap the input
+ */
+inline
+void irfft(const rfft_plan& plan, vector_f64 in_re, vector_f64 in_im, vector_f64 out) {
+	index_type half = plan.size / 2;
+
+	assert(length(in_re) == half + 1 && length(in_im) == half + 1);
+	assert(in_re.stride == 1 && in_im.stride == 1);
+	assert(length(out) == plan.size);
+
+	//z is formed in the two halves of out and transformed from there
+	//into the input arrays, which are no longer read by then
+	vector_f64 z_re = take(out, half);
+	vector_f64 z_im = drop(out, half);
+	const f64* w_re = plan.twiddle_re.array;
+	const f64* w_im = plan.twiddle_im.array;
+
+	//z[k] = E[k] + i O[k], with E[k] = (X[k] + conj X[half - k]) / 2
+	//and O[k] = (X[k] - conj X[half - k]) conj(w^k) / 2
+	z_re[0] = 0.5 * (in_re[0] + in_re[half]);
+	z_im[0] = 0.5 * (in_re[0] - in_re[half]);
+
+	for(index_type k = 1; k <= half / 2; ++k) {
+		index_type j = half - k;
+
+		f64 xk_re = in_re[k], xk_im = in_im[k];
+		f64 xj_re = in_re[j], xj_im = in_im[j];
+
+		f64 e_re = 0.5 * (xk_re + xj_re);
+		f64 e_im = 0.5 * (xk_im - xj_im);
+		f64 d_re = 0.5 * (xk_re - xj_re);
+		f64 d_im = 0.5 * (xk_im + xj_im);
+
+		f64 o_re = d_re * w_re[k] + d_im * w_im[k];
+		f64 o_im = d_im * w_re[k] - d_re * w_im[k];
+
+		z_re[k] = e_re - o_im;
+		z_im[k] = e_im + o_re;
+
+		//E[j] = conj E[k], O[j] = conj O[k]
+		z_re[j] = e_re + o_im;
+		z_im[j] = o_re - e_im;
+	}
+
+	//ifft via conj(DFT(conj(z))), the conjugations done by swapping re/im
+	f64* x_re = in_re.array;
+	f64* x_im = in_im.array;
+	detail::fft_forward(plan.half, z_im, z_re, x_im, x_re);
+
+	//out[2 k] = Re x[k], out[2 k + 1] = Im x[k]
+	f64 scale = 1.0 / (f64)half;
+	vector_f64 even = drop_odd(out);
+	vector_f64 odd = drop_even(out);
+	for(index_type k = 0; k < half; ++k) {
+		even[k] = x_re[k] * scale;
+		odd[k] = x_im[k] * scale;
+	}
+}
+}
+
+// LIBAXL_FFT_GUARD
+#endif
@@ -0,0 +1,360 @@
+
+#ifndef LIBAXL_FIR_FILTER_GUARD
+#define LIBAXL_FIR_FILTER_GUARD
+
+#include "util.h"
+#include "arena.h"
+#include "vectors.h"
+#include "vector_pair.h"
+#include "circular_buffer.h"
+#include "fft.h"
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#endif
+
+namespace libaxl {
+
+/**
+ *  fir_direct:       tap by tap multiply-add over the input block
+ *  fir_overlap_save: block convolution through the FFT
+ */
+enum fir_mode {
+	fir_direct,
+	fir_overlap_save
+};
+
+namespace detail {
+	//Filters with more taps than this use overlap-save by default
+	const index_type fir_fft_threshold = 64;
+	//Outputs per pass of the direct kernel, keeps the output tile in L1
+	const index_type fir_direct_tile = 2048;
+}
+
+/**
+ *  Streaming FIR filter, y[n] = sum_k taps[k] * x[n - k], for T f32 or
+ *  f64.
+ *
+ *  The last taps - 1 input samples are kept in a circular_buffer, so
+ *  consecutive calls to process continue the same stream and only the
+ *  history, never the input block, is copied between calls.
+ *
+ *  Short filters use the direct kernel, which runs contiguous
+ *  multiply-add loops over a tile of outputs, four taps per pass (AVX
+ *  under __AVX__). Long
+ *  filters use overlap-save: fft_size point real transforms, each
+ *  producing fft_size - (taps - 1) outputs. The transforms are f64
+ *  only (see fft.h), f32 blocks are widened as they are copied into
+ *  the transform buffer and narrowed on the way out.
+ */
+template <typename T>
+struct fir_filter {
+	vector<T> taps;
+	fir_mode mode;
+	circular_buffer<T> history;
+
+	//Overlap-save state
+	index_type fft_size;
+	rfft_plan plan;
+	vector_f64 response_re;
+	vector_f64 response_im;
+	vector_f64 work;
+	vector_f64 spectrum_re;
+	vector_f64 spectrum_im;
+};
+
+/**
+ *  Creates a filter in the given mode, taps is copied into arena.
+ *
+ *  Preconditions:
+ *  (1) length(taps) >= 1
+ */
+template <typename T>
+inline
+fir_filter<T> make_fir_filter(arena* arena, vector<T> taps, fir_mode mode) {
+	fir_filter<T> result;
+
+	assert(arena != nullptr);
+	assert(length(taps) >= 1);
+
+	index_type tap_count = length(taps);
+
+	result.taps = copy_to(taps, make_uninitialized_vector<T>(arena, tap_count));
+	result.mode = mode;
+	result.history = make_circular_buffer<T>(arena, maximum(tap_count - 1, (index_type)1));
+
+	result.fft_size = 0;
+	result.response_re = result.response_im = vector_f64();
+	result.work = vector_f64();
+	result.spectrum_re = result.spectrum_im = vector_f64();
+
+	if(mode == fir_overlap_save) {
+		index_type n = 1;
+		while(n < 4 * tap_count)
+			n *= 2;
+		result.fft_size = n;
+
+		result.plan = make_rfft_plan(arena, n);
+
+		result.work = zeros<f64>(arena, n);
+		for(index_type k = 0; k < tap_count; ++k)
+			result.work.array[k] = (f64)result.taps.array[k];
+
+		result.response_re = make_uninitialized_vector<f64>(arena, n / 2 + 1);
+		result.response_im = make_uninitialized_vector<f64>(arena, n / 2 + 1);
+		rfft(result.plan, result.work, result.response_re, result.response_im);
+
+		result.spectrum_re = make_uninitialized_vector<f64>(arena, n / 2 + 1);
+		result.spectrum_im = make_uninitialized_vector<f64>(arena, n / 2 + 1);
+	}
+
+	return result;
+}
+
+/**
+ *  Creates a filter, picking the mode from the number of taps.
+ */
+template <typename T>
+inline
+fir_filter<T> make_fir_filter(arena* arena, vector<T> taps) {
+	fir_mode mode = (length(taps) > detail::fir_fft_threshold) ? fir_overlap_save : fir_direct;
+	return make_fir_filter(arena, taps, mode);
+}
+
+/**
+ *  Forgets the stream history (as if all past input was zero).
+ */
+template <typename T>
+inline
+void reset(fir_filter<T>& f) {
+	fill(f.history.buf_vector, (T)0);
+}
+
+namespace detail {
+	/**
+	 *  x[n] of the stream for -(taps - 1) <= n < length(in), n < 0
+	 *  being the history.
+	 */
+	template <typename T>
+	inline
+	T fir_input(vector_pair<T> past, vector<T> in, index_type n) {
+		if(n >= 0)
+			return in.array[n];
+		return past[length(past) + n];
+	}
+
+	/**
+	 *  y[n] += h0 * x[n] + h1 * x[n - 1] + h2 * x[n - 2] + h3 * x[n - 3]
+	 *  for begin <= n < end, one pass of the direct kernel over a tile.
+	 */
+	template <typename T>
+	inline
+	void fir_accumulate4(const T* x, T* y, index_type begin, index_type end, T h0, T h1, T h2, T h3) {
+		for(index_type n = begin; n < end; ++n)
+			y[n] += h0 * x[n] + h1 * x[n - 1] + h2 * x[n - 2] + h3 * x[n - 3];
+	}
+
+#if defined(__AVX__)
+	//4 doubles/8 floats of y per step, unaligned loads of the shifted x.
+	//x and y are different buffers, which the compiler cannot see and
+	//would otherwise check at run time before vectorizing
+
+#if defined(__FMA__)
+	inline __m256d fir_multiply_add(__m256d a, __m256d b, __m256d c) { return _mm256_fmadd_pd(a, b, c); }
+	inline __m256 fir_multiply_add(__m256 a, __m256 b, __m256 c) { return _mm256_fmadd_ps(a, b, c); }
+#else
+	inline __m256d fir_multiply_add(__m256d a, __m256d b, __m256d c) { return _mm256_add_pd(_mm256_mul_pd(a, b), c); }
+	inline __m256 fir_multiply_add(__m256 a, __m256 b, __m256 c) { return _mm256_add_ps(_mm256_mul_ps(a, b), c); }
+#endif
+
+	inline
+	void fir_accumulate4(const f64* x, f64* y, index_type begin, index_type end, f64 h0, f64 h1, f64 h2, f64 h3) {
+		__m256d t0 = _mm256_set1_pd(h0), t1 = _mm256_set1_pd(h1), t2 = _mm256_set1_pd(h2), t3 = _mm256_set1_pd(h3);
+		index_type n = begin;
+
+		for(; n + 4 <= end; n += 4) {
+			__m256d acc = _mm256_loadu_pd(y + n);
+			acc = fir_multiply_add(t0, _mm256_loadu_pd(x + n), acc);
+			acc = fir_multiply_add(t1, _mm256_loadu_pd(x + n - 1), acc);
+			acc = fir_multiply_add(t2, _mm256_loadu_pd(x + n - 2), acc);
+			acc = fir_multiply_add(t3, _mm256_loadu_pd(x + n - 3), acc);
+			_mm256_storeu_pd(y + n, acc);
+		}
+
+		fir_accumulate4<f64>(x, y, n, end, h0, h1, h2, h3);
+	}
+
+	inline
+	void fir_accumulate4(const f32* x, f32* y, index_type begin, index_type end, f32 h0, f32 h1, f32 h2, f32 h3) {
+		__m256 t0 = _mm256_set1_ps(h0), t1 = _mm256_set1_ps(h1), t2 = _mm256_set1_ps(h2), t3 = _mm256_set1_ps(h3);
+		index_type n = begin;
+
+		for(; n + 8 <= end; n += 8) {
+			__m256 acc = _mm256_loadu_ps(y + n);
+			acc = fir_multiply_add(t0, _mm256_loadu_ps(x + n), acc);
+			acc = fir_multiply_add(t1, _mm256_loadu_ps(x + n - 1), acc);
+			acc = fir_multiply_add(t2, _mm256_loadu_ps(x + n - 2), acc);
+			acc = fir_multiply_add(t3, _mm256_loadu_ps(x + n - 3), acc);
+			_mm256_storeu_ps(y + n, acc);
+		}
+
+		fir_accumulate4<f32>(x, y, n, end, h0, h1, h2, h3);
+	}
+#endif
+
+	template <typename T>
+	inline
+	void fir_process_direct(fir_filter<T>& f, vector<T> in, vector<T> out) {
+		index_type tap_count = length(f.taps);
+		index_type count = length(in);
+		const T* h = f.taps.array;
+		const T* x = in.array;
+		T* y = out.array;
+
+		vector_pair<T> past = read(f.history, tap_count - 1);
+
+		//Outputs that reach back into the history
+		index_type head = minimum(count, tap_count - 1);
+		for(index_type n = 0; n < head; ++n) {
+			T acc = 0;
+			for(index_type k = 0; k < tap_count; ++k) {
+				acc += h[k] * fir_input(past, in, n - k);
+			}
+			y[n] = acc;
+		}
+
+		//Outputs that only read the block: contiguous multiply-adds over
+		//a tile of outputs, four taps per pass so that each load and
+		//store of y serves four products
+		index_type tap_count4 = tap_count - tap_count % 4;
+
+		for(index_type tile = head; tile < count; tile += fir_direct_tile) {
+			index_type tile_end = tile + minimum(fir_direct_tile, count - tile);
+
+			for(index_type n = tile; n < tile_end; ++n)
+				y[n] = 0;
+
+			for(index_type k = 0; k < tap_count4; k += 4)
+				fir_accumulate4(x - k, y, tile, tile_end, h[k], h[k + 1], h[k + 2], h[k + 3]);
+
+			//The last taps % 4 taps one at a time, a zero padded pass of
+			//four would read before the block
+			for(index_type k = tap_count4; k < tap_count; ++k) {
+				T tap = h[k];
+				for(index_type n = tile; n < tile_end; ++n) {
+					y[n] += tap * x[n - k];
+				}
+			}
+		}
+	}
+
+	template <typename T>
+	inline
+	void fir_process_overlap_save(fir_filter<T>& f, vector<T> in, vector<T> out) {
+		index_type tap_count = length(f.taps);
+		index_type overlap = tap_count - 1;
+		index_type n = f.fft_size;
+		index_type step = n - overlap;
+
+		f64* x = f.work.array;
+		f64* re = f.spectrum_re.array;
+		f64* im = f.spectrum_im.array;
+		const f64* h_re = f.response_re.array;
+		const f64* h_im = f.response_im.array;
+		index_type bins = n / 2 + 1;
+
+		for(index_type begin = 0; begin < length(in); begin += step) {
+			index_type chunk = minimum(step, length(in) - begin);
+
+			//[last overlap inputs, chunk inputs, zero padding]
+			vector_pair<T> past = read(f.history, overlap);
+			index_type i = 0;
+			for(; i < overlap; ++i)
+				x[i] = (f64)fir_input(past, in, begin - overlap + i);
+			for(index_type k = 0; k < chunk; ++k)
+				x[overlap + k] = (f64)in.array[begin + k];
+			for(i = overlap + chunk; i < n; ++i)
+				x[i] = 0.0;
+
+			rfft(f.plan, f.work, f.spectrum_re, f.spectrum_im);
+
+			for(i = 0; i < bins; ++i) {
+				f64 a = re[i] * h_re[i] - im[i] * h_im[i];
+				f64 b = re[i] * h_im[i] + im[i] * h_re[i];
+				re[i] = a;
+				im[i] = b;
+			}
+
+			irfft(f.plan, f.spectrum_re, f.spectrum_im, f.work);
+
+			//The first overlap outputs are circularly aliased
+			for(index_type k = 0; k < chunk; ++k)
+				out.array[begin + k] = (T)x[overlap + k];
+		}
+	}
+
+	/**
+	 *  Pushes the tail of in into the history ring.
+	 */
+	template <typename T>
+	inline
+	void fir_update_history(fir_filter<T>& f, vector<T> in) {
+		index_type keep = minimum(length(in), length(f.history));
+		vector<T> latest = drop(in, length(in) - keep);
+
+		vector_pair<T> slots = write(f.history, keep);
+		copy_to(latest, first(slots));
+		copy_to(drop(latest, length(first(slots))), second(slots));
+		f.history = rotate_left(f.history, keep);
+	}
+}
+
+/**
+ *  Filters the next block of the stream, out[i] is the filter output
+ *  at in[i].
+ *
+ *  Preconditions:
+ *  (1) in and out are contiguous (stride 1)
+ *  (2) length(out) >= length(in)
+ *  (3) in and out do not overlap
+ */
+template <typename T>
+inline
+void process(fir_filter<T>& f, vector<T> in, vector<T> out) {
+	assert(in.stride == 1 && out.stride == 1);
+	assert(length(out) >= length(in));
+
+	if(is_empty(in))
+		return;
+
+	if(length(f.taps) == 1) {
+		T tap = f.taps.array[0];
+		for(index_type i = 0; i < length(in); ++i)
+			out.array[i] = tap * in.array[i];
+		return;
+	}
+
+	if(f.mode == fir_direct)
+		detail::fir_process_direct(f, in, out);
+	else
+		detail::fir_process_overlap_save(f, in, out);
+
+	detail::fir_update_history(f, in);
+}
+
+/**
+ *  Filters the oldest count samples of a circular_buffer window, e.g.
+ *  read(cb, count), segment by segment.
+ */
+template <typename T>
+inline
+void process(fir_filter<T>& f, vector_pair<T> in, vector<T> out) {
+	assert(length(out) >= length(in));
+
+	process(f, first(in), out);
+	process(f, second(in), drop(out, length(first(in))));
+}
+}
+
+// LIBAXL_FIR_FILTER_GUARD
+#endif
@@ -0,0 +1,274 @@
+
+#ifndef LIBAXL_GATHER_GUARD
+#define LIBAXL_GATHER_GUARD
+
+#include "util.h"
+#include "vectors.h"
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#endif
+
+namespace libaxl {
+
+/**
+ *  Pack/unpack kernels for strided data, e.g. a column of a row-major
+ *  matrix (stride == number of columns).
+ *
+ *  When the stride spans a cache line or more, every element of a
+ *  strided vector is on its own line. gather copies such a vector into
+ *  contiguous scratch, with the loads issued ahead of use, and scatter
+ *  writes a contiguous buffer back. transpose moves a whole 2D block at
+ *  once, so that every cache line it touches is used completely.
+ *
+ *  In lazy expressions a strided leaf is packed one tile at a time by
+ *  pack(v, arena) (see lazy_eval/packed_expr.h).
+ */
+
+namespace detail {
+	//Strides of at least this many bytes put every element on its own line
+	const size_type wide_stride_bytes = 64;
+	//Side of the square tiles of transpose
+	const index_type transpose_tile = 32;
+
+	template <typename T>
+	inline
+	bool is_wide_stride(index_type stride) {
+		size_type step = (size_type)(stride < 0 ? -stride : stride) * sizeof(T);
+		return step >= wide_stride_bytes;
+	}
+
+	template <typename T>
+	inline
+	void gather_scalar(const T* in, index_type stride, T* out, index_type count) {
+		index_type i = 0;
+
+		if(LIBAXL_PREFETCH_DISTANCE > 0 && is_wide_stride<T>(stride)) {
+			for(; i + LIBAXL_PREFETCH_DISTANCE < count; ++i) {
+				prefetch(in + (i + LIBAXL_PREFETCH_DISTANCE) * stride);
+				out[i] = in[i * stride];
+			}
+		}
+
+		for(; i < count; ++i)
+			out[i] = in[i * stride];
+	}
+
+	template <typename T>
+	inline
+	void gather_kernel(const T* in, index_type stride, T* out, index_type count) {
+		gather_scalar(in, stride, out, count);
+	}
+
+#if defined(__AVX2__)
+	//Hardware gathers of 4 doubles/8 floats per instruction, the offsets
+	//are 32 bit relative to a base advanced every step. The masked form
+	//with an all set mask and a zero source is the same instruction, the
+	//unmasked intrinsic leaves its source undefined and GCC warns
+	//(-Wmaybe-uninitialized) wherever it is inlined
+
+	inline
+	void gather_kernel(const f64* in, index_type stride, f64* out, index_type count) {
+		if((int64_t)stride * 3 > INT32_MAX || (int64_t)stride * 3 < -INT32_MAX) {
+			gather_scalar(in, stride, out, count);
+			return;
+		}
+
+		__m128i offsets = _mm_setr_epi32(0, (int)stride, (int)(2 * stride), (int)(3 * stride));
+		__m256d all = _mm256_castsi256_pd(_mm256_set1_epi64x(-1));
+		index_type i = 0;
+
+		for(; i + 4 <= count; i += 4) {
+			const f64* base = in + i * stride;
+			if(LIBAXL_PREFETCH_DISTANCE > 0 && i + LIBAXL_PREFETCH_DISTANCE < count)
+				prefetch(base + LIBAXL_PREFETCH_DISTANCE * stride);
+			_mm256_storeu_pd(out + i, _mm256_mask_i32gather_pd(_mm256_setzero_pd(), base, offsets, all, 8));
+		}
+
+		for(; i < count; ++i)
+			out[i] = in[i * stride];
+	}
+
+	inline
+	void gather_kernel(const f32* in, index_type stride, f32* out, index_type count) {
+		if((int64_t)stride * 7 > INT32_MAX || (int64_t)stride * 7 < -INT32_MAX) {
+			gather_scalar(in, stride, out, count);
+			return;
+		}
+
+		__m256i offsets = _mm256_mullo_epi32(_mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7), _mm256_set1_epi32((int)stride));
+		__m256 all = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+		index_type i = 0;
+
+		for(; i + 8 <= count; i += 8) {
+			const f32* base = in + i * stride;
+			if(LIBAXL_PREFETCH_DISTANCE > 0 && i + LIBAXL_PREFETCH_DISTANCE < count)
+				prefetch(base + LIBAXL_PREFETCH_DISTANCE * stride);
+			_mm256_storeu_ps(out + i, _mm256_mask_i32gather_ps(_mm256_setzero_ps(), base, offsets, all, 4));
+		}
+
+		for(; i < count; ++i)
+			out[i] = in[i * stride];
+	}
+#endif
+
+	template <typename T>
+	inline
+	void scatter_kernel(const T* in, T* out, index_type stride, index_type count) {
+		for(index_type i = 0; i < count; ++i)
+			out[i * stride] = in[i];
+	}
+
+	/**
+	 *  out[j][i] = in[i][j] for a rows x cols block, element by element.
+	 */
+	template <typename T>
+	inline
+	void transpose_scalar(const T* in, index_type in_row_stride, T* out, index_type out_row_stride,
+		index_type rows, index_type cols)
+	{
+		for(index_type i = 0; i < rows; ++i) {
+			for(index_type j = 0; j < cols; ++j)
+				out[j * out_row_stride + i] = in[i * in_row_stride + j];
+		}
+	}
+
+	//4x4 blocks transposed in registers
+
+	template <typename T>
+	inline
+	bool transpose_4x4(const T* in, index_type in_row_stride, T* out, index_type out_row_stride) {
+		return false;
+	}
+
+#if defined(LIBAXL_HAS_STREAM_STORES)
+	inline
+	bool transpose_4x4(const f32* in, index_type in_row_stride, f32* out, index_type out_row_stride) {
+		__m128 r0 = _mm_loadu_ps(in);
+		__m128 r1 = _mm_loadu_ps(in + in_row_stride);
+		__m128 r2 = _mm_loadu_ps(in + 2 * in_row_stride);
+		__m128 r3 = _mm_loadu_ps(in + 3 * in_row_stride);
+
+		_MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+
+		_mm_storeu_ps(out, r0);
+		_mm_storeu_ps(out + out_row_stride, r1);
+		_mm_storeu_ps(out + 2 * out_row_stride, r2);
+		_mm_storeu_ps(out + 3 * out_row_stride, r3);
+		return true;
+	}
+#endif
+
+#if defined(__AVX__)
+	inline
+	bool transpose_4x4(const f64* in, index_type in_row_stride, f64* out, index_type out_row_stride) {
+		__m256d r0 = _mm256_loadu_pd(in);
+		__m256d r1 = _mm256_loadu_pd(in + in_row_stride);
+		__m256d r2 = _mm256_loadu_pd(in + 2 * in_row_stride);
+		__m256d r3 = _mm256_loadu_pd(in + 3 * in_row_stride);
+
+		//Pairs within 128 bit lanes, then swap the lanes
+		__m256d t0 = _mm256_unpacklo_pd(r0, r1);
+		__m256d t1 = _mm256_unpackhi_pd(r0, r1);
+		__m256d t2 = _mm256_unpacklo_pd(r2, r3);
+		__m256d t3 = _mm256_unpackhi_pd(r2, r3);
+
+		_mm256_storeu_pd(out, _mm256_permute2f128_pd(t0, t2, 0x20));
+		_mm256_storeu_pd(out + out_row_stride, _mm256_permute2f128_pd(t1, t3, 0x20));
+		_mm256_storeu_pd(out + 2 * out_row_stride, _mm256_permute2f128_pd(t0, t2, 0x31));
+		_mm256_storeu_pd(out + 3 * out_row_stride, _mm256_permute2f128_pd(t1, t3, 0x31));
+		return true;
+	}
+#endif
+
+	template <typename T>
+	inline
+	void transpose_tile_kernel(const T* in, index_type in_row_stride, T* out, index_type out_row_stride,
+		index_type rows, index_type cols)
+	{
+		index_type rows4 = rows - rows % 4;
+		index_type cols4 = cols - cols % 4;
+
+		for(index_type i = 0; i < rows4; i += 4) {
+			for(index_type j = 0; j < cols4; j += 4) {
+				const T* from = in + i * in_row_stride + j;
+				T* to = out + j * out_row_stride + i;
+				if(!transpose_4x4(from, in_row_stride, to, out_row_stride))
+					transpose_scalar(from, in_row_stride, to, out_row_stride, 4, 4);
+			}
+		}
+
+		//Right and bottom edges
+		transpose_scalar(in + cols4, in_row_stride, out + cols4 * out_row_stride, out_row_stride, rows, cols - cols4);
+		transpose_scalar(in + rows4 * in_row_stride, in_row_stride, out + rows4, out_row_stride, rows - rows4, cols4);
+	}
+}
+
+/**
+ *  Copies in to the front of out, returns the written part of out.
+ *
+ *  Preconditions:
+ *  (1) out is contiguous (stride 1)
+ */
+template <typename T>
+inline
+vector<T> gather(vector<T> in, vector<T> out) {
+	assert(out.stride == 1);
+
+	out.count = minimum(length(in), length(out));
+	detail::gather_kernel(in.array, in.stride, out.array, out.count);
+
+	return out;
+}
+
+/**
+ *  Copies the contiguous in to the front of out, returns the written
+ *  part of out.
+ *
+ *  Preconditions:
+ *  (1) in is contiguous (stride 1)
+ */
+template <typename T>
+inline
+vector<T> scatter(vector<T> in, vector<T> out) {
+	assert(in.stride == 1);
+
+	out.count = minimum(length(in), length(out));
+	detail::scatter_kernel(in.array, out.array, out.stride, out.count);
+
+	return out;
+}
+
+/**
+ *  out[j * out_row_stride + i] = in[i * in_row_stride + j] for a
+ *  rows x cols matrix in, both row-major with the given row strides.
+ *
+ *  The matrix is moved one square tile at a time, so both the rows read
+ *  and the rows written stay cache resident while a tile is done.
+ *
+ *  Preconditions:
+ *  (1) in_row_stride >= cols, out_row_stride >= rows
+ *  (2) in and out do not overlap
+ */
+template <typename T>
+inline
+void transpose(const T* in, index_type in_row_stride, T* out, index_type out_row_stride,
+	index_type rows, index_type cols)
+{
+	assert(rows >= 0 && cols >= 0);
+	assert(in_row_stride >= cols && out_row_stride >= rows);
+
+	const index_type tile = detail::transpose_tile;
+
+	for(index_type i = 0; i < rows; i += tile) {
+		for(index_type j = 0; j < cols; j += tile) {
+			detail::transpose_tile_kernel(in + i * in_row_stride + j, in_row_stride,
+				out + j * out_row_stride + i, out_row_stride,
+				minimum(tile, rows - i), minimum(tile, cols - j));
+		}
+	}
+}
+}
+
+// LIBAXL_GATHER_GUARD
+#endif
@@ -0,0 +1,261 @@
+
+#ifndef LIBAXL_IO_SEGMENTS_GUARD
+#define LIBAXL_IO_SEGMENTS_GUARD
+
+#include <cstdint>
+
+#include "util.h"
+#include "arena.h"
+
+#if defined(_WIN32)
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <cerrno>
+#include <climits>
+#include <fcntl.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#endif
+
+namespace libaxl {
+
+/**
+ *  Scatter/gather I/O of byte ranges (e.g. string_buffer memory): the
+ *  ranges are written or read with one system call (writev/readv,
+ *  pwritev/preadv), without staging them in a contiguous buffer first.
+ *
+ *  This header does not depend on vectors.h, so it can be used next to
+ *  strings.h; the vector, vector_pair and vector_list forms are in
+ *  io_vec.h.
+ *
+ *  On Windows the segments are transferred one WriteFile/ReadFile
+ *  call at a time; the interface is the same.
+ */
+
+#if defined(_WIN32)
+using file_handle = HANDLE;
+
+//Same layout as the POSIX struct iovec
+struct io_segment {
+	void* iov_base;
+	size_t iov_len;
+};
+#else
+using file_handle = int;
+using io_segment = ::iovec;
+#endif
+
+/**
+ *  A list of byte ranges. The segment array is owned by the arena it
+ *  was allocated from, the bytes themselves may be anywhere.
+ */
+struct io_vec {
+	io_segment* segments;
+	index_type count;
+	index_type capacity;
+};
+
+/**
+ *  Creates an empty io_vec with room for capacity segments.
+ *
+ *  Preconditions:
+ *  (1) capacity >= 0
+ */
+inline
+io_vec make_io_vec(arena* arena, index_type capacity) {
+	io_vec result;
+
+	assert(arena != nullptr);
+	assert(capacity >= 0);
+
+	result.segments = allocate<io_segment>(arena, capacity);
+	result.count = 0;
+	result.capacity = capacity;
+
+	return result;
+}
+
+/**
+ *  Appends size bytes at data. Empty ranges are skipped.
+ *
+ *  Preconditions:
+ *  (1) the io_vec has room for another segment
+ */
+inline
+void add(io_vec& io, const void* data, size_type size) {
+	if(size == 0)
+		return;
+
+	assert(io.count < io.capacity);
+
+	io.segments[io.count].iov_base = (void*)data;
+	io.segments[io.count].iov_len = size;
+	++io.count;
+}
+
+inline
+size_type byte_count(io_vec io) {
+	size_type result = 0;
+
+	for(index_type i = 0; i < io.count; ++i)
+		result += io.segments[i].iov_len;
+
+	return result;
+}
+
+namespace detail {
+	/**
+	 *  Transfers all of segments[0, count) with one call per round,
+	 *  resubmitting the rest after a partial transfer. The segment a
+	 *  partial transfer stopped in is trimmed for the next round and
+	 *  restored afterwards, the caller's array is left unchanged.
+	 *
+	 *  offset < 0 transfers at the current file position.
+	 *  Returns the bytes transferred (fewer than requested only at the
+	 *  end of the file when reading), -1 on error.
+	 */
+	inline
+	int64_t transfer_segments(file_handle file, io_segment* segments, index_type count,
+		int64_t offset, bool writing)
+	{
+		int64_t total = 0;
+		index_type index = 0;
+
+		while(index < count && segments[index].iov_len == 0)
+			++index;
+
+		while(index < count) {
+#if defined(_WIN32)
+			DWORD bytes = 0;
+			DWORD request = (DWORD)minimum(segments[index].iov_len, (size_t)(1U << 30));
+			OVERLAPPED position = {};
+			OVERLAPPED* at = nullptr;
+			if(offset >= 0) {
+				position.Offset = (DWORD)(uint64_t)(offset + total);
+				position.OffsetHigh = (DWORD)((uint64_t)(offset + total) >> 32);
+				at = &position;
+			}
+
+			BOOL ok = writing
+				? WriteFile(file, segments[index].iov_base, request, &bytes, at)
+				: ReadFile(file, segments[index].iov_base, request, &bytes, at);
+			if(!ok) {
+				if(!writing && GetLastError() == ERROR_HANDLE_EOF)
+					break;
+				return -1;
+			}
+			int64_t done = (int64_t)bytes;
+#else
+			int round = (int)minimum<index_type>(count - index, IOV_MAX);
+			ssize_t done;
+			if(offset >= 0) {
+				done = writing
+					? ::pwritev(file, segments + index, round, (off_t)(offset + total))
+					: ::preadv(file, segments + index, round, (off_t)(offset + total));
+			} else {
+				done = writing
+					? ::writev(file, segments + index, round)
+					: ::readv(file, segments + index, round);
+			}
+			if(done < 0) {
+				if(errno == EINTR)
+					continue;
+				return -1;
+			}
+#endif
+			if(done == 0) {
+				//End of file when reading
+				if(!writing)
+					break;
+				return -1;
+			}
+
+			total += done;
+
+			//Skip the segments done, trim the one stopped in
+			size_type left = (size_type)done;
+			while(index < count && left >= segments[index].iov_len) {
+				left -= segments[index].iov_len;
+				++index;
+			}
+			if(left > 0) {
+				io_segment saved = segments[index];
+				segments[index].iov_base = (unsigned char*)saved.iov_base + left;
+				segments[index].iov_len = saved.iov_len - left;
+
+				int64_t rest = transfer_segments(file, segments + index, count - index,
+					(offset >= 0) ? offset + total : offset, writing);
+
+				segments[index] = saved;
+				return (rest < 0) ? -1 : total + rest;
+			}
+		}
+
+		return total;
+	}
+}
+
+/**
+ *  Writes all segments at the current file position.
+ *  Returns false on error.
+ */
+inline
+bool write_segments(file_handle file, io_vec io) {
+	return detail::transfer_segments(file, io.segments, io.count, -1, true) >= 0;
+}
+
+/**
+ *  Writes all segments starting at byte offset of the file, without
+ *  moving the file position.
+ */
+inline
+bool write_segments_at(file_handle file, io_vec io, uint64_t offset) {
+	return detail::transfer_segments(file, io.segments, io.count, (int64_t)offset, true) >= 0;
+}
+
+/**
+ *  Fills the segments in order from the current file position.
+ *  Returns the bytes read, less than byte_count(io) only at the end
+ *  of the file, -1 on error.
+ */
+inline
+int64_t read_segments(file_handle file, io_vec io) {
+	return detail::transfer_segments(file, io.segments, io.count, -1, false);
+}
+
+inline
+int64_t read_segments_at(file_handle file, io_vec io, uint64_t offset) {
+	return detail::transfer_segments(file, io.segments, io.count, (int64_t)offset, false);
+}
+
+/**
+ *  Creates or truncates the file at path and writes all segments to
+ *  it. Returns false if the file cannot be created or written.
+ */
+inline
+bool write_file(const char* path, io_vec io) {
+	assert(path != nullptr);
+
+#if defined(_WIN32)
+	HANDLE file = CreateFileA(path, GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if(file == INVALID_HANDLE_VALUE)
+		return false;
+
+	bool ok = write_segments(file, io);
+	return CloseHandle(file) && ok;
+#else
+	int fd = ::open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if(fd < 0)
+		return false;
+
+	bool ok = write_segments(fd, io);
+	return (::close(fd) == 0) && ok;
+#endif
+}
+}
+
+// LIBAXL_IO_SEGMENTS_GUARD
+#endif
@@ -0,0 +1,105 @@
+
+#ifndef LIBAXL_IO_VEC_GUARD
+#define LIBAXL_IO_VEC_GUARD
+
+#include "util.h"
+#include "arena.h"
+#include "vectors.h"
+#include "vector_pair.h"
+#include "vector_list.h"
+#include "io_segments.h"
+
+namespace libaxl {
+
+//
+//  The segments of a vector_pair or a vector_list as an io_vec, see
+//  io_segments.h
+//
+
+/**
+ *  Preconditions:
+ *  (1) v is contiguous (stride 1) or empty
+ */
+template <typename T>
+inline
+void add(io_vec& io, vector<T> v) {
+	if(is_empty(v))
+		return;
+
+	assert(v.stride == 1);
+
+	add(io, v.array, (size_type)length(v) * sizeof(T));
+}
+
+template <typename T>
+inline
+void add(io_vec& io, vector_pair<T> vp) {
+	add(io, first(vp));
+	add(io, second(vp));
+}
+
+template <typename T>
+inline
+void add(io_vec& io, vector_list<T> vl) {
+	for(index_type i = 0; i < segment_count(vl); ++i)
+		add(io, segment(vl, i));
+}
+
+template <typename T>
+inline
+io_vec make_io_vec(arena* arena, vector_pair<T> vp) {
+	io_vec result = make_io_vec(arena, 2);
+	add(result, vp);
+	return result;
+}
+
+template <typename T>
+inline
+io_vec make_io_vec(arena* arena, vector_list<T> vl) {
+	io_vec result = make_io_vec(arena, segment_count(vl));
+	add(result, vl);
+	return result;
+}
+
+/**
+ *  Writes a vector_pair, e.g. read(cb, count) of a circular_buffer,
+ *  without an arena.
+ */
+template <typename T>
+inline
+bool write_segments(file_handle file, vector_pair<T> vp) {
+	io_segment segments[2];
+	io_vec io = { segments, 0, 2 };
+	add(io, vp);
+	return write_segments(file, io);
+}
+
+/**
+ *  Reads straight into a vector_pair, e.g. write(cb, count) of a
+ *  circular_buffer. Returns the number of whole elements read, -1 on
+ *  error.
+ *
+ *  Short reads are resumed until vp is full or the file ends, so a
+ *  partial element is only left when the file ends inside one: its
+ *  leading bytes are then in the element after the last whole one and
+ *  their number in *partial_bytes, if given. A caller reading on from a growing file
+ *  or a pipe completes that element first instead of starting the
+ *  next read misaligned.
+ */
+template <typename T>
+inline
+index_type read_segments(file_handle file, vector_pair<T> vp, size_type* partial_bytes = nullptr) {
+	io_segment segments[2];
+	io_vec io = { segments, 0, 2 };
+	add(io, vp);
+
+	int64_t bytes = read_segments(file, io);
+	if(partial_bytes)
+		*partial_bytes = (bytes < 0) ? 0 : (size_type)(bytes % (int64_t)sizeof(T));
+
+	return (bytes < 0) ? -1 : (index_type)(bytes / (int64_t)sizeof(T));
+}
+}
+
+// LIBAXL_IO_VEC_GUARD
+#endif
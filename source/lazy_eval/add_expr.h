@@ -3,32 +3,25 @@
 #define LIBAXL_ADD_EXPR_GUARD
 
 namespace libaxl {
-template <typename T1, typename T2>
-struct add_expr {
-	T1 left;
-	T2 right;
-
-	ALWAYS_INLINE
-	auto operator[](index_type index) -> decltype(left[index] + right[index]) {
-		return left[index] + right[index];
-	}
-};
+namespace detail {
+	struct add_op {
+		static const int cost = 1;
+
+		template <typename A, typename B>
+		ALWAYS_INLINE
+		static auto apply(A a, B b) -> decltype(a + b) {
+			return a + b;
+		}
+	};
+}
 
 template <typename T1, typename T2>
-inline
-index_type length(add_expr<T1, T2> e) {
-	return minimum(length(e.left), length(e.right));
-}
+using add_expr = binary_expr<detail::add_op, T1, T2>;
 
 template <typename T1, typename T2>
 inline
 add_expr<T1, T2> operator+(T1 a, T2 b) {
-	add_expr<T1, T2> result;
-
-	result.left = a;
-	result.right = b;
-
-	return result;
+	return detail::make_binary_expr<detail::add_op>(a, b);
 }
 }
 
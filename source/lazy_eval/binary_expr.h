@@ -0,0 +1,96 @@
+
+#ifndef LIBAXL_BINARY_EXPR_GUARD
+#define LIBAXL_BINARY_EXPR_GUARD
+
+/**
+ *  Element-wise binary node: Op::apply(left[i], right[i]).
+ *
+ *  The arithmetic, comparison and logical nodes are aliases of
+ *  binary_expr with their own Op (add_expr.h ... logical_expr.h), so
+ *  length, expr_cost, the stride specialization and the segment
+ *  functions are written once here. Op::cost is the cost of the node
+ *  itself, without its children.
+ */
+
+namespace libaxl {
+template <typename Op, typename T1, typename T2>
+struct binary_expr {
+	T1 left;
+	T2 right;
+
+	ALWAYS_INLINE
+	auto operator[](index_type index) -> decltype(Op::apply(left[index], right[index])) {
+		return Op::apply(left[index], right[index]);
+	}
+};
+
+template <typename Op, typename T1, typename T2>
+inline
+index_type length(binary_expr<Op, T1, T2> e) {
+	return minimum(length(e.left), length(e.right));
+}
+
+template <typename Op, typename T1, typename T2>
+struct expr_cost<binary_expr<Op, T1, T2>> {
+	static const int value = Op::cost + expr_cost<T1>::value + expr_cost<T2>::value;
+};
+
+template <typename Op, typename T1, typename T2>
+inline
+bool is_contiguous(binary_expr<Op, T1, T2> e) {
+	return is_contiguous(e.left) && is_contiguous(e.right);
+}
+
+template <typename Op, typename T1, typename T2>
+inline
+void reset_shared(binary_expr<Op, T1, T2> e) {
+	reset_shared(e.left);
+	reset_shared(e.right);
+}
+
+template <typename Op, typename T1, typename T2>
+inline
+auto to_contiguous(binary_expr<Op, T1, T2> e)
+-> binary_expr<Op, decltype(to_contiguous(e.left)), decltype(to_contiguous(e.right))> {
+	binary_expr<Op, decltype(to_contiguous(e.left)), decltype(to_contiguous(e.right))> result;
+
+	result.left = to_contiguous(e.left);
+	result.right = to_contiguous(e.right);
+
+	return result;
+}
+
+template <typename Op, typename T1, typename T2>
+inline
+index_type next_break(binary_expr<Op, T1, T2> e, index_type from) {
+	return minimum(next_break(e.left, from), next_break(e.right, from));
+}
+
+template <typename Op, typename T1, typename T2>
+inline
+auto slice(binary_expr<Op, T1, T2> e, index_type begin, index_type count)
+-> binary_expr<Op, decltype(slice(e.left, begin, count)), decltype(slice(e.right, begin, count))> {
+	binary_expr<Op, decltype(slice(e.left, begin, count)), decltype(slice(e.right, begin, count))> result;
+
+	result.left = slice(e.left, begin, count);
+	result.right = slice(e.right, begin, count);
+
+	return result;
+}
+
+namespace detail {
+	template <typename Op, typename T1, typename T2>
+	inline
+	binary_expr<Op, T1, T2> make_binary_expr(T1 a, T2 b) {
+		binary_expr<Op, T1, T2> result;
+
+		result.left = a;
+		result.right = b;
+
+		return result;
+	}
+}
+}
+
+// LIBAXL_BINARY_EXPR_GUARD
+#endif
@@ -0,0 +1,140 @@
+
+#ifndef LIBAXL_COMPARE_EXPR_GUARD
+#define LIBAXL_COMPARE_EXPR_GUARD
+
+/**
+ *  Element-wise comparison nodes.
+ *
+ *  Each node yields a mask expression (bool per element) which
+ *  can be fed to where(), logical_and/or/not, count, any and all
+ *  without breaking the fused evaluation loop.
+ *
+ *  Equality is exposed as the functions equal/not_equal rather
+ *  than as operator==/operator!= so that value comparisons of other
+ *  libaxl types are not captured by the expression templates.
+ */
+
+namespace libaxl {
+namespace detail {
+	struct less_op {
+		static const int cost = 1;
+
+		template <typename A, typename B>
+		ALWAYS_INLINE
+		static bool apply(A a, B b) {
+			return a < b;
+		}
+	};
+
+	struct less_equal_op {
+		static const int cost = 1;
+
+		template <typename A, typename B>
+		ALWAYS_INLINE
+		static bool apply(A a, B b) {
+			return a <= b;
+		}
+	};
+
+	struct greater_op {
+		static const int cost = 1;
+
+		template <typename A, typename B>
+		ALWAYS_INLINE
+		static bool apply(A a, B b) {
+			return a > b;
+		}
+	};
+
+	struct greater_equal_op {
+		static const int cost = 1;
+
+		template <typename A, typename B>
+		ALWAYS_INLINE
+		static bool apply(A a, B b) {
+			return a >= b;
+		}
+	};
+
+	struct equal_op {
+		static const int cost = 1;
+
+		template <typename A, typename B>
+		ALWAYS_INLINE
+		static bool apply(A a, B b) {
+			return a == b;
+		}
+	};
+
+	struct not_equal_op {
+		static const int cost = 1;
+
+		template <typename A, typename B>
+		ALWAYS_INLINE
+		static bool apply(A a, B b) {
+			return a != b;
+		}
+	};
+}
+
+template <typename T1, typename T2>
+using less_expr = binary_expr<detail::less_op, T1, T2>;
+
+template <typename T1, typename T2>
+using less_equal_expr = binary_expr<detail::less_equal_op, T1, T2>;
+
+template <typename T1, typename T2>
+using greater_expr = binary_expr<detail::greater_op, T1, T2>;
+
+template <typename T1, typename T2>
+using greater_equal_expr = binary_expr<detail::greater_equal_op, T1, T2>;
+
+template <typename T1, typename T2>
+using equal_expr = binary_expr<detail::equal_op, T1, T2>;
+
+template <typename T1, typename T2>
+using not_equal_expr = binary_expr<detail::not_equal_op, T1, T2>;
+
+//
+//  Factory functions
+//
+
+template <typename T1, typename T2>
+inline
+less_expr<T1, T2> operator<(T1 a, T2 b) {
+	return detail::make_binary_expr<detail::less_op>(a, b);
+}
+
+template <typename T1, typename T2>
+inline
+less_equal_expr<T1, T2> operator<=(T1 a, T2 b) {
+	return detail::make_binary_expr<detail::less_equal_op>(a, b);
+}
+
+template <typename T1, typename T2>
+inline
+greater_expr<T1, T2> operator>(T1 a, T2 b) {
+	return detail::make_binary_expr<detail::greater_op>(a, b);
+}
+
+template <typename T1, typename T2>
+inline
+greater_equal_expr<T1, T2> operator>=(T1 a, T2 b) {
+	return detail::make_binary_expr<detail::greater_equal_op>(a, b);
+}
+
+template <typename T1, typename T2>
+inline
+equal_expr<T1, T2> equal(T1 a, T2 b) {
+	return detail::make_binary_expr<detail::equal_op>(a, b);
+}
+
+template <typename T1, typename T2>
+inline
+not_equal_expr<T1, T2> not_equal(T1 a, T2 b) {
+	return detail::make_binary_expr<detail::not_equal_op>(a, b);
+}
+}
+
+// LIBAXL_COMPARE_EXPR_GUARD
+#endif
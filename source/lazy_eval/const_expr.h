@@ -16,7 +16,24 @@ struct const_expr {
 template <typename T>
 inline
 index_type length(const_expr<T> e) {
-	return 2147483647;
+	return index_type_max;
+}
+
+template <typename T>
+struct expr_cost<const_expr<T>> {
+	static const int value = 0;
+};
+
+template <typename T>
+inline
+bool is_contiguous(const_expr<T>) {
+	return true;
+}
+
+template <typename T>
+inline
+const_expr<T> slice(const_expr<T> e, index_type, index_type) {
+	return e;
 }
 
 //
@@ -0,0 +1,50 @@
+
+#ifndef LIBAXL_CONTIGUOUS_EXPR_GUARD
+#define LIBAXL_CONTIGUOUS_EXPR_GUARD
+
+/**
+ *  Stride specialization of expression trees.
+ *
+ *  is_contiguous(e) is true when every vector<T> leaf of e has stride 1,
+ *  and to_contiguous(e) then rebuilds e with those leaves replaced by
+ *  contiguous_vector<T>. eval tests this once per call and runs the
+ *  contiguous instantiation, so the inner loop has no stride arithmetic.
+ *
+ *  Every node type provides an overload of both functions next to its
+ *  length(). The fallbacks below keep unknown leaves on the generic path.
+ */
+
+namespace libaxl {
+template <typename E>
+inline
+bool is_contiguous(E) {
+	return false;
+}
+
+template <typename E>
+inline
+E to_contiguous(E e) {
+	return e;
+}
+
+template <typename T>
+inline
+contiguous_vector<T> to_contiguous(vector<T> v) {
+	return make_contiguous_vector(v);
+}
+
+template <typename T>
+inline
+bool is_contiguous(contiguous_vector<T> v) {
+	return true;
+}
+
+template <typename T>
+inline
+contiguous_vector<T> to_contiguous(contiguous_vector<T> v) {
+	return v;
+}
+}
+
+// LIBAXL_CONTIGUOUS_EXPR_GUARD
+#endif
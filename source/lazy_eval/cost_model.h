@@ -0,0 +1,67 @@
+
+#ifndef LIBAXL_COST_MODEL_GUARD
+#define LIBAXL_COST_MODEL_GUARD
+
+/**
+ *  Compile-time cost model of expression trees.
+ *
+ *  expr_cost<E>::value is a rough per-element cost of evaluating E,
+ *  in units of one add/multiply (a load of a leaf costs 1). Each node
+ *  type specializes expr_cost next to its definition, the cost of a
+ *  node is its own cost plus the cost of its children.
+ *
+ *  reuse_choice<E>::value uses the cost to decide how a subtree that
+ *  is referenced more than once in an expression (see shared_expr.h)
+ *  should be reused.
+ */
+
+namespace libaxl {
+template <typename E>
+struct expr_cost {
+	static const int value = 1;
+};
+
+template <typename T>
+struct expr_cost<vector<T>> {
+	static const int value = 1;
+};
+
+template <typename T>
+struct expr_cost<contiguous_vector<T>> {
+	static const int value = 1;
+};
+
+/**
+ *  reuse_recompute:   evaluate the subtree again at every use
+ *  reuse_last_value:  keep the value of the last index evaluated in the
+ *                     scratch state of the node
+ *  reuse_materialize: evaluate the subtree one tile at a time into
+ *                     scratch memory and read the uses from there
+ *
+ *  reuse_last_value is a load, compare and store through memory at
+ *  every access, and the stores keep the enclosing loop from being
+ *  vectorized. It is never picked by reuse_choice, it only pays off for
+ *  subtrees that do not vectorize anyway and are read at the same index
+ *  by all uses.
+ */
+enum reuse_strategy {
+	reuse_recompute,
+	reuse_last_value,
+	reuse_materialize
+};
+
+namespace detail {
+	//Subtrees above this cost amortize the scratch traffic of
+	//materializing, cheaper ones are recomputed in the vectorized loop
+	const int reuse_materialize_cost = 8;
+}
+
+template <typename E>
+struct reuse_choice {
+	static const reuse_strategy value =
+		(expr_cost<E>::value <= detail::reuse_materialize_cost) ? reuse_recompute : reuse_materialize;
+};
+}
+
+// LIBAXL_COST_MODEL_GUARD
+#endif
@@ -3,32 +3,26 @@
 #define LIBAXL_DIV_EXPR_GUARD
 
 namespace libaxl {
-template <typename T1, typename T2>
-struct div_expr {
-	T1 left;
-	T2 right;
-
-	ALWAYS_INLINE
-	auto operator[](index_type index) -> decltype(left[index] / right[index]) {
-		return left[index] / right[index];
-	}
-};
+namespace detail {
+	struct div_op {
+		//Division has several times the latency and a fraction of the throughput of a multiply
+		static const int cost = 8;
+
+		template <typename A, typename B>
+		ALWAYS_INLINE
+		static auto apply(A a, B b) -> decltype(a / b) {
+			return a / b;
+		}
+	};
+}
 
 template <typename T1, typename T2>
-inline
-index_type length(div_expr<T1, T2> e) {
-	return minimum(length(e.left), length(e.right));
-}
+using div_expr = binary_expr<detail::div_op, T1, T2>;
 
 template <typename T1, typename T2>
 inline
 div_expr<T1, T2> operator/(T1 a, T2 b) {
-	div_expr<T1, T2> result;
-
-	result.left = a;
-	result.right = b;
-
-	return result;
+	return detail::make_binary_expr<detail::div_op>(a, b);
 }
 }
 
@@ -2,40 +2,277 @@
 #ifndef LIBAXL_LAZY_EVAL_GUARD
 #define LIBAXL_LAZY_EVAL_GUARD
 
+#include <type_traits>
+#include <utility>
+
 #include "../util.h"
 #include "../vectors.h"
 #include "../arena.h"
+#include "../vector_pair.h"
+#include "../vector_list.h"
+#include "../circular_buffer.h"
+#include "../contiguous_vector.h"
+#include "../tile_profile.h"
+#include "../gather.h"
 
 //
 //  Operations
 //
 
+#include "contiguous_expr.h"
+#include "cost_model.h"
+#include "segment_expr.h"
 #include "const_expr.h"
+#include "binary_expr.h"
 #include "add_expr.h"
 #include "sub_expr.h"
 #include "mul_expr.h"
 #include "div_expr.h"
 #include "square_expr.h"
+#include "compare_expr.h"
+#include "logical_expr.h"
+#include "select_expr.h"
+#include "shift_expr.h"
+#include "ring_expr.h"
+#include "shared_expr.h"
+#include "packed_expr.h"
 
 namespace libaxl {
 
+namespace detail {
+	template <typename T, typename E>
+	inline
+	void eval_loop(E e, vector<T> dest) {
+		auto count = minimum(length(dest), length(e));
+		auto dest_array = dest.array;
+		auto dest_stride = dest.stride;
+
+		if(dest_stride == 1) {
+			for(index_type i = 0; i < count; ++i) {
+				dest_array[i] = e[i];
+			}
+		} else {
+			for(index_type i = 0; i < count; ++i) {
+				dest_array[i * dest_stride] = e[i];
+			}
+		}
+	}
+
+	template <typename T, typename E>
+	inline
+	void eval_run(E e, vector<T> dest) {
+		if(is_contiguous(e)) {
+			eval_loop(to_contiguous(e), dest);
+		} else {
+			eval_loop(e, dest);
+		}
+	}
+
+	/**
+	 *  Evaluates e into the (possibly segmented) dest, one run between
+	 *  consecutive segment boundaries of dest and e at a time.
+	 */
+	template <typename D, typename E>
+	inline
+	index_type eval_runs(D dest, E e) {
+		auto count = minimum(length(dest), length(e));
+
+		index_type begin = 0;
+		index_type end = minimum(count, minimum(next_break(dest, 0), next_break(e, 0)));
+
+		if(end == count) {
+			eval_run(e, slice(dest, 0, count));
+			return count;
+		}
+
+		while(begin < count) {
+			eval_run(slice(e, begin, end - begin), slice(dest, begin, end - begin));
+
+			begin = end;
+			end = minimum(count, minimum(next_break(dest, begin), next_break(e, begin)));
+		}
+
+		return count;
+	}
+}
+
+/**
+ *  Evaluates e into a new vector allocated from arena.
+ *
+ *  Leaves made of several segments (vector_pair, vector_list, rings)
+ *  are split at their segment boundaries (see segment_expr.h), and
+ *  each run whose vector leaves all have stride 1 is evaluated on
+ *  contiguous leaves (see contiguous_expr.h).
+ */
 template <typename E>
 inline
-auto eval(E e, arena* arena) -> vector<decltype(e[0])> {
-	using value_type = decltype(e[0]);
+auto eval(E e, arena* arena) -> vector<typename std::decay<decltype(e[0])>::type> {
+	using value_type = typename std::decay<decltype(e[0])>::type;
 	vector<value_type> result;
 
 	result.count = length(e);
 	result.array = allocate<value_type>(arena, result.count);
 	result.stride = 1;
 
-	for(index_type i = 0; i < result.count; ++i) {
-		auto value = e[i];
-		result.array[i] = value;
-	}
+	reset_shared(e);
+	detail::eval_runs(result, e);
 
 	return result;
 }
+
+/**
+ *  Evaluates e into an existing vector.
+ *
+ *  Writes min(length(dest), length(e)) elements and returns
+ *  the written part of dest.
+ */
+template <typename T, typename E>
+inline
+vector<T> assign(vector<T> dest, E e) {
+	auto count = minimum(length(dest), length(e));
+	dest.count = count;
+
+	reset_shared(e);
+	detail::eval_runs(dest, e);
+
+	return dest;
+}
+
+template <typename T, typename E>
+inline
+vector_pair<T> assign(vector_pair<T> dest, E e) {
+	reset_shared(e);
+	auto count = detail::eval_runs(dest, e);
+
+	return take(dest, count);
+}
+
+/**
+ *  Writes min(length(dest), length(e)) elements, segment by segment,
+ *  and returns the written part of dest. arena holds the segment
+ *  array of the result when the written part ends inside a segment
+ *  (see take for vector_list).
+ */
+template <typename T, typename E>
+inline
+vector_list<T> assign(vector_list<T> dest, E e, arena* arena) {
+	reset_shared(e);
+	auto count = detail::eval_runs(dest, e);
+
+	return take(arena, dest, count);
+}
+
+/**
+ *  Masked assignment: dest[i] = mask[i] ? e[i] : dest[i].
+ *
+ *  Every element of dest is rewritten with a blend of the old and
+ *  the new value, so the loop contains no data dependent branches.
+ */
+template <typename T, typename M, typename E>
+inline
+vector<T> assign_where(vector<T> dest, M mask, E e) {
+	auto count = minimum(length(dest), minimum(length(mask), length(e)));
+	dest.count = count;
+
+	reset_shared(mask);
+	reset_shared(e);
+	for(index_type i = 0; i < count; ++i) {
+		T new_value = e[i];
+		T old_value = dest.array[i * dest.stride];
+		dest.array[i * dest.stride] = mask[i] ? new_value : old_value;
+	}
+
+	return dest;
+}
+
+//
+//  Mask reductions
+//
+
+namespace detail {
+	template <typename M>
+	inline
+	index_type count_mask(M mask) {
+		index_type result = 0;
+
+		auto len = length(mask);
+		for(index_type i = 0; i < len; ++i) {
+			result += mask[i] ? 1 : 0;
+		}
+
+		return result;
+	}
+}
+
+template <typename M>
+inline
+index_type count(M mask) {
+	reset_shared(mask);
+	if(is_contiguous(mask))
+		return detail::count_mask(to_contiguous(mask));
+
+	return detail::count_mask(mask);
+}
+
+namespace detail {
+	template <typename M>
+	inline
+	bool any_blocked(M mask, index_type block_size) {
+		auto len = length(mask);
+
+		for(index_type block = 0; block < len; block += block_size) {
+			auto block_end = block + minimum(block_size, len - block);
+			index_type hits = 0;
+
+			for(index_type i = block; i < block_end; ++i) {
+				hits += mask[i] ? 1 : 0;
+			}
+
+			if(hits != 0)
+				return true;
+		}
+
+		return false;
+	}
+
+	template <typename M>
+	inline
+	bool all_blocked(M mask, index_type block_size) {
+		auto len = length(mask);
+
+		for(index_type block = 0; block < len; block += block_size) {
+			auto block_end = block + minimum(block_size, len - block);
+			index_type hits = 0;
+
+			for(index_type i = block; i < block_end; ++i) {
+				hits += mask[i] ? 1 : 0;
+			}
+
+			if(hits != block_end - block)
+				return false;
+		}
+
+		return true;
+	}
+}
+
+/**
+ *  any/all count the hits of reduce_tile elements (see tile_profile.h)
+ *  without branching, and check for an early out between the blocks.
+ */
+template <typename M>
+inline
+bool any(M mask) {
+	reset_shared(mask);
+	return detail::any_blocked(mask, current_tile_profile().reduce_tile);
+}
+
+template <typename M>
+inline
+bool all(M mask) {
+	reset_shared(mask);
+	return detail::all_blocked(mask, current_tile_profile().reduce_tile);
+}
 }
 
 #endif
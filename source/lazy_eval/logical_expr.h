@@ -0,0 +1,128 @@
+
+#ifndef LIBAXL_LOGICAL_EXPR_GUARD
+#define LIBAXL_LOGICAL_EXPR_GUARD
+
+/**
+ *  Logical combinators for mask expressions.
+ *
+ *  Both operands are always evaluated (no short-circuit) so that
+ *  the combined mask stays branch-free inside the evaluation loop.
+ */
+
+namespace libaxl {
+namespace detail {
+	struct and_op {
+		static const int cost = 1;
+
+		template <typename A, typename B>
+		ALWAYS_INLINE
+		static bool apply(A a, B b) {
+			return (bool)a & (bool)b;
+		}
+	};
+
+	struct or_op {
+		static const int cost = 1;
+
+		template <typename A, typename B>
+		ALWAYS_INLINE
+		static bool apply(A a, B b) {
+			return (bool)a | (bool)b;
+		}
+	};
+}
+
+template <typename T1, typename T2>
+using and_expr = binary_expr<detail::and_op, T1, T2>;
+
+template <typename T1, typename T2>
+using or_expr = binary_expr<detail::or_op, T1, T2>;
+
+template <typename T>
+struct not_expr {
+	T child;
+
+	ALWAYS_INLINE
+	bool operator[](index_type index) {
+		return !child[index];
+	}
+};
+
+template <typename T>
+inline
+index_type length(not_expr<T> e) {
+	return length(e.child);
+}
+
+template <typename T>
+struct expr_cost<not_expr<T>> {
+	static const int value = 1 + expr_cost<T>::value;
+};
+
+template <typename T>
+inline
+bool is_contiguous(not_expr<T> e) {
+	return is_contiguous(e.child);
+}
+
+template <typename T>
+inline
+void reset_shared(not_expr<T> e) {
+	reset_shared(e.child);
+}
+
+template <typename T>
+inline
+auto to_contiguous(not_expr<T> e) -> not_expr<decltype(to_contiguous(e.child))> {
+	not_expr<decltype(to_contiguous(e.child))> result;
+
+	result.child = to_contiguous(e.child);
+
+	return result;
+}
+
+template <typename T>
+inline
+index_type next_break(not_expr<T> e, index_type from) {
+	return next_break(e.child, from);
+}
+
+template <typename T>
+inline
+auto slice(not_expr<T> e, index_type begin, index_type count) -> not_expr<decltype(slice(e.child, begin, count))> {
+	not_expr<decltype(slice(e.child, begin, count))> result;
+
+	result.child = slice(e.child, begin, count);
+
+	return result;
+}
+
+//
+//  Factory functions
+//
+
+template <typename T1, typename T2>
+inline
+and_expr<T1, T2> logical_and(T1 a, T2 b) {
+	return detail::make_binary_expr<detail::and_op>(a, b);
+}
+
+template <typename T1, typename T2>
+inline
+or_expr<T1, T2> logical_or(T1 a, T2 b) {
+	return detail::make_binary_expr<detail::or_op>(a, b);
+}
+
+template <typename T>
+inline
+not_expr<T> logical_not(T x) {
+	not_expr<T> result;
+
+	result.child = x;
+
+	return result;
+}
+}
+
+// LIBAXL_LOGICAL_EXPR_GUARD
+#endif
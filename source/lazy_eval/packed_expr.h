@@ -0,0 +1,174 @@
+
+#ifndef LIBAXL_PACKED_EXPR_GUARD
+#define LIBAXL_PACKED_EXPR_GUARD
+
+namespace libaxl {
+
+namespace detail {
+	//Elements gathered per refill of a packed leaf
+	const index_type pack_tile = 256;
+	//Tiles kept per packed leaf
+	const index_type pack_ways = 4;
+}
+
+template <typename T>
+struct packed_tile {
+	T* array;
+	index_type begin;
+	index_type end;
+};
+
+/**
+ *  Gather buffers of a packed leaf, filled round robin.
+ *
+ *  Lives in an arena so that every copy of the packed_vector inside an
+ *  expression tree (nodes hold their children by value) reads the same
+ *  tiles, like shared_state in shared_expr.h.
+ */
+template <typename T>
+struct packed_state {
+	packed_tile<T> tiles[detail::pack_ways];
+	index_type next_fill;
+};
+
+/**
+ *  A strided vector<T> leaf read through contiguous tile buffers,
+ *
+ *  auto c = pack(column, &arena);
+ *  assign(dest, (shift(c, -1) + c + shift(c, 1)) / constant(3.0));
+ *
+ *  The leaf gathers pack_tile elements at a time (see gather.h) into
+ *  one of pack_ways tiles shared by all its copies. Every copy, that is
+ *  every use in the expression, remembers the tile it read last, and
+ *  on leaving it looks for the next one among the tiles before
+ *  gathering it. Uses at different offsets, as in a stencil or in
+ *  shift(c, -300) + c, then each read their own tile, and a tile is
+ *  gathered once however many uses cross it, as long as the uses span
+ *  no more than pack_ways tiles at a time. Beyond that the oldest tile
+ *  is refilled and some elements are gathered again.
+ *
+ *  Packing is not applied by eval on its own: a leaf read once per
+ *  element is streamed as well by the hardware stride prefetcher, and
+ *  the extra copy made packed evaluation slower in that case.
+ *
+ *  An expression containing a packed leaf must not be evaluated by two
+ *  threads at the same time.
+ */
+template <typename T>
+struct packed_vector {
+	//The whole vector given to pack, slices keep it and move base
+	vector<T> source;
+	packed_state<T>* state;
+	index_type base;
+	index_type count;
+	//The tile this copy read last
+	index_type way;
+
+	ALWAYS_INLINE
+	T operator[](index_type index) {
+		index_type at = base + index;
+		const packed_tile<T>& tile = state->tiles[way];
+		if(at < tile.begin || at >= tile.end)
+			return read_other_tile(at);
+		return tile.array[at - tile.begin];
+	}
+
+	T read_other_tile(index_type at) {
+		assert(at >= 0 && at < source.count);
+
+		//Tiles are aligned in source, so slices share them
+		index_type begin = at - (at % detail::pack_tile);
+
+		for(index_type w = 0; w < detail::pack_ways; ++w) {
+			const packed_tile<T>& tile = state->tiles[w];
+			if(tile.begin == begin && tile.end > begin) {
+				way = w;
+				return tile.array[at - begin];
+			}
+		}
+
+		way = state->next_fill;
+		state->next_fill = (way + 1) % detail::pack_ways;
+
+		packed_tile<T>& tile = state->tiles[way];
+		index_type end = begin + minimum(detail::pack_tile, source.count - begin);
+		detail::gather_kernel(source.array + begin * source.stride, source.stride, tile.array, end - begin);
+		tile.begin = begin;
+		tile.end = end;
+
+		return tile.array[at - begin];
+	}
+};
+
+/**
+ *  Drops the gathered tiles, the source may have changed since the
+ *  last evaluation.
+ */
+template <typename T>
+inline
+void reset_shared(packed_vector<T> v) {
+	for(index_type w = 0; w < detail::pack_ways; ++w) {
+		v.state->tiles[w].begin = 0;
+		v.state->tiles[w].end = 0;
+	}
+}
+
+template <typename T>
+inline
+index_type length(const packed_vector<T>& v) {
+	return v.count;
+}
+
+template <typename T>
+struct expr_cost<packed_vector<T>> {
+	static const int value = 1;
+};
+
+template <typename T>
+inline
+packed_vector<T> slice(const packed_vector<T>& v, index_type begin, index_type count) {
+	assert(begin >= 0 && count >= 0 && begin + count <= v.count);
+
+	packed_vector<T> result = v;
+	result.base = v.base + begin;
+	result.count = count;
+
+	return result;
+}
+
+//
+//  Factory function
+//
+
+/**
+ *  Packs the strided v, the pack_ways tile buffers of pack_tile
+ *  elements are allocated from arena and must outlive every evaluation
+ *  of expressions containing the result.
+ */
+template <typename T>
+inline
+packed_vector<T> pack(vector<T> v, arena* arena) {
+	packed_vector<T> result;
+
+	assert(arena != nullptr);
+
+	auto state = allocate<packed_state<T>>(arena, 1);
+	for(index_type w = 0; w < detail::pack_ways; ++w) {
+		state->tiles[w].array = allocate<T>(arena, detail::pack_tile);
+		state->tiles[w].begin = 0;
+		state->tiles[w].end = 0;
+	}
+	state->next_fill = 0;
+
+	result.source = v;
+	result.state = state;
+	result.base = 0;
+	result.count = v.count;
+	result.way = 0;
+
+	return result;
+}
+}
+
+// LIBAXL_PACKED_EXPR_GUARD
+#endif
@@ -0,0 +1,114 @@
+
+#ifndef LIBAXL_RING_EXPR_GUARD
+#define LIBAXL_RING_EXPR_GUARD
+
+namespace libaxl {
+
+/**
+ *  Expression leaf over the contents of a circular_buffer.
+ *
+ *  Element 0 is the oldest element of the window and element
+ *  length - 1 the most recently written one, the same order as
+ *  first(read(c, count)) followed by second(read(c, count)).
+ *  The wrap point is resolved with a single compare per read,
+ *  so stencils over a ring need no copy into a linear buffer.
+ */
+template <typename T>
+struct ring_expr {
+	vector<T> buf_vector;
+	index_type start;
+	index_type count;
+
+	ALWAYS_INLINE
+	T operator[](index_type index) {
+		assert(index >= 0 && index < count);
+
+		index_type buf_index = start + index;
+		if(buf_index >= buf_vector.count)
+			buf_index -= buf_vector.count;
+
+		return buf_vector.array[buf_index * buf_vector.stride];
+	}
+};
+
+template <typename T>
+inline
+index_type length(ring_expr<T> e) {
+	return e.count;
+}
+
+//A load plus the wrap-around test
+template <typename T>
+struct expr_cost<ring_expr<T>> {
+	static const int value = 2;
+};
+
+template <typename T>
+inline
+bool is_contiguous(ring_expr<T>) {
+	return true;
+}
+
+//The wrap point of the ring is a segment boundary
+template <typename T>
+inline
+index_type next_break(ring_expr<T> e, index_type from) {
+	index_type wrap = length(e.buf_vector) - e.start;
+
+	if(wrap > from && wrap < e.count)
+		return wrap;
+	return detail::no_segment_break;
+}
+
+template <typename T>
+inline
+vector<T> slice(ring_expr<T> e, index_type begin, index_type count) {
+	index_type wrap = length(e.buf_vector) - e.start;
+
+	if(begin >= wrap)
+		return slice(e.buf_vector, begin - wrap, count);
+
+	assert(begin + count <= wrap); // The slice may not span the wrap point
+	return slice(e.buf_vector, e.start + begin, count);
+}
+
+//
+//  Factory functions
+//
+
+/**
+ *  The count most recently written elements of c as an expression.
+ *
+ *  Preconditions:
+ *  (1) c is a valid circular_buffer
+ *  (2) 0 <= count <= length(c)
+ */
+template <typename T>
+inline
+ring_expr<T> ring(circular_buffer<T> c, index_type count) {
+	ring_expr<T> result;
+
+	index_type size = length(c);
+	assert(count >= 0);
+	assert(count <= size);
+
+	index_type start = c.tail - count;
+	if(start < 0)
+		start += size;
+
+	result.buf_vector = c.buf_vector;
+	result.start = start;
+	result.count = count;
+
+	return result;
+}
+
+template <typename T>
+inline
+ring_expr<T> ring(circular_buffer<T> c) {
+	return ring(c, length(c));
+}
+}
+
+// LIBAXL_RING_EXPR_GUARD
+#endif
@@ -0,0 +1,187 @@
+
+#ifndef LIBAXL_SEGMENT_EXPR_GUARD
+#define LIBAXL_SEGMENT_EXPR_GUARD
+
+/**
+ *  Segmented evaluation of expression trees.
+ *
+ *  Leaves such as vector_pair, vector_list and ring_expr consist of
+ *  several linear segments. Reading them element by element costs a
+ *  segment lookup per access and prevents vectorization, so eval
+ *  splits the index range at every segment boundary of the tree
+ *  instead and evaluates each run on a sliced tree in which those
+ *  leaves are plain vectors.
+ *
+ *  next_break(e, from) is the first segment boundary of e after from
+ *  (no_segment_break if there is none), and slice(e, begin, count) is
+ *  the subexpression e[begin, begin + count), which must not contain
+ *  a boundary. Every node type provides both next to its length();
+ *  the fallbacks below wrap unknown nodes in a window_expr, which
+ *  keeps them correct but on the element-wise path.
+ */
+
+namespace libaxl {
+
+namespace detail {
+	const index_type no_segment_break = index_type_max;
+}
+
+/**
+ *  e[i] = child[begin + i] for 0 <= i < count.
+ */
+template <typename E>
+struct window_expr {
+	E child;
+	index_type begin;
+	index_type count;
+
+	ALWAYS_INLINE
+	auto operator[](index_type index) -> decltype(child[index]) {
+		return child[begin + index];
+	}
+};
+
+template <typename E>
+inline
+index_type length(window_expr<E> e) {
+	return e.count;
+}
+
+template <typename E>
+struct expr_cost<window_expr<E>> {
+	static const int value = expr_cost<E>::value;
+};
+
+template <typename E>
+inline
+bool is_contiguous(window_expr<E> e) {
+	return is_contiguous(e.child);
+}
+
+template <typename E>
+inline
+void reset_shared(window_expr<E> e) {
+	reset_shared(e.child);
+}
+
+template <typename E>
+inline
+auto to_contiguous(window_expr<E> e) -> window_expr<decltype(to_contiguous(e.child))> {
+	window_expr<decltype(to_contiguous(e.child))> result;
+
+	result.child = to_contiguous(e.child);
+	result.begin = e.begin;
+	result.count = e.count;
+
+	return result;
+}
+
+template <typename E>
+inline
+window_expr<E> slice(window_expr<E> e, index_type begin, index_type count) {
+	assert(begin >= 0 && begin + count <= e.count);
+
+	e.begin += begin;
+	e.count = count;
+
+	return e;
+}
+
+//
+//  Fallbacks
+//
+
+template <typename E>
+inline
+index_type next_break(E, index_type) {
+	return detail::no_segment_break;
+}
+
+template <typename E>
+inline
+window_expr<E> slice(E e, index_type begin, index_type count) {
+	window_expr<E> result;
+
+	assert(begin >= 0 && count >= 0);
+
+	result.child = e;
+	result.begin = begin;
+	result.count = count;
+
+	return result;
+}
+
+//
+//  Leaves
+//
+
+template <typename T>
+inline
+vector<T> slice(vector<T> v, index_type begin, index_type count) {
+	return take(drop(v, begin), count);
+}
+
+template <typename T>
+inline
+contiguous_vector<T> slice(contiguous_vector<T> v, index_type begin, index_type count) {
+	assert(begin >= 0 && count >= 0 && begin + count <= v.count);
+
+	v.array += begin;
+	v.count = count;
+
+	return v;
+}
+
+template <typename T>
+inline
+index_type next_break(vector_pair<T> vp, index_type from) {
+	index_type first_count = length(first(vp));
+
+	if(first_count > from && first_count < length(vp))
+		return first_count;
+	return detail::no_segment_break;
+}
+
+template <typename T>
+inline
+vector<T> slice(vector_pair<T> vp, index_type begin, index_type count) {
+	index_type first_count = length(first(vp));
+
+	if(begin >= first_count)
+		return slice(second(vp), begin - first_count, count);
+
+	assert(begin + count <= first_count); // The slice may not span both segments
+	return slice(first(vp), begin, count);
+}
+
+template <typename T>
+inline
+index_type next_break(vector_list<T> vl, index_type from) {
+	index_type segment_end = 0;
+
+	for(index_type i = 0; i + 1 < vl.count; ++i) {
+		segment_end += length(vl.v[i]);
+
+		if(segment_end > from)
+			return segment_end;
+	}
+
+	return detail::no_segment_break;
+}
+
+template <typename T>
+inline
+vector<T> slice(vector_list<T> vl, index_type begin, index_type count) {
+	index_type i = 0;
+
+	while(i + 1 < vl.count && begin >= length(vl.v[i])) {
+		begin -= length(vl.v[i]);
+		++i;
+	}
+
+	return slice(vl.v[i], begin, count);
+}
+}
+
+// LIBAXL_SEGMENT_EXPR_GUARD
+#endif
@@ -0,0 +1,105 @@
+
+#ifndef LIBAXL_SELECT_EXPR_GUARD
+#define LIBAXL_SELECT_EXPR_GUARD
+
+namespace libaxl {
+/**
+ *  Element-wise selection: mask[i] ? if_true[i] : if_false[i].
+ *
+ *  Both branches are read before the mask is tested, so the
+ *  selection has no data dependent control flow and the compiler
+ *  can lower the loop to compare + blend instructions.
+ */
+template <typename M, typename T1, typename T2>
+struct select_expr {
+	M mask;
+	T1 if_true;
+	T2 if_false;
+
+	using value_type = typename std::decay<decltype(std::declval<M&>()[0] ? std::declval<T1&>()[0] : std::declval<T2&>()[0])>::type;
+
+	ALWAYS_INLINE
+	value_type operator[](index_type index) {
+		value_type true_value = if_true[index];
+		value_type false_value = if_false[index];
+
+		return mask[index] ? true_value : false_value;
+	}
+};
+
+template <typename M, typename T1, typename T2>
+inline
+index_type length(select_expr<M, T1, T2> e) {
+	return minimum(length(e.mask), minimum(length(e.if_true), length(e.if_false)));
+}
+
+template <typename M, typename T1, typename T2>
+struct expr_cost<select_expr<M, T1, T2>> {
+	static const int value = 1 + expr_cost<M>::value + expr_cost<T1>::value + expr_cost<T2>::value;
+};
+
+template <typename M, typename T1, typename T2>
+inline
+bool is_contiguous(select_expr<M, T1, T2> e) {
+	return is_contiguous(e.mask) && is_contiguous(e.if_true) && is_contiguous(e.if_false);
+}
+
+template <typename M, typename T1, typename T2>
+inline
+void reset_shared(select_expr<M, T1, T2> e) {
+	reset_shared(e.mask);
+	reset_shared(e.if_true);
+	reset_shared(e.if_false);
+}
+
+template <typename M, typename T1, typename T2>
+inline
+auto to_contiguous(select_expr<M, T1, T2> e)
+-> select_expr<decltype(to_contiguous(e.mask)), decltype(to_contiguous(e.if_true)), decltype(to_contiguous(e.if_false))> {
+	select_expr<decltype(to_contiguous(e.mask)), decltype(to_contiguous(e.if_true)), decltype(to_contiguous(e.if_false))> result;
+
+	result.mask = to_contiguous(e.mask);
+	result.if_true = to_contiguous(e.if_true);
+	result.if_false = to_contiguous(e.if_false);
+
+	return result;
+}
+
+template <typename M, typename T1, typename T2>
+inline
+index_type next_break(select_expr<M, T1, T2> e, index_type from) {
+	return minimum(next_break(e.mask, from), minimum(next_break(e.if_true, from), next_break(e.if_false, from)));
+}
+
+template <typename M, typename T1, typename T2>
+inline
+auto slice(select_expr<M, T1, T2> e, index_type begin, index_type count)
+-> select_expr<decltype(slice(e.mask, begin, count)), decltype(slice(e.if_true, begin, count)), decltype(slice(e.if_false, begin, count))> {
+	select_expr<decltype(slice(e.mask, begin, count)), decltype(slice(e.if_true, begin, count)), decltype(slice(e.if_false, begin, count))> result;
+
+	result.mask = slice(e.mask, begin, count);
+	result.if_true = slice(e.if_true, begin, count);
+	result.if_false = slice(e.if_false, begin, count);
+
+	return result;
+}
+
+//
+//  Factory function
+//
+
+template <typename M, typename T1, typename T2>
+inline
+select_expr<M, T1, T2> where(M mask, T1 if_true, T2 if_false) {
+	select_expr<M, T1, T2> result;
+
+	result.mask = mask;
+	result.if_true = if_true;
+	result.if_false = if_false;
+
+	return result;
+}
+}
+
+// LIBAXL_SELECT_EXPR_GUARD
+#endif
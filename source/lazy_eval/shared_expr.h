@@ -0,0 +1,212 @@
+
+#ifndef LIBAXL_SHARED_EXPR_GUARD
+#define LIBAXL_SHARED_EXPR_GUARD
+
+namespace libaxl {
+
+/**
+ *  Scratch state of a shared subexpression.
+ *
+ *  Lives in an arena so that every copy of the shared_expr inside an
+ *  expression tree (nodes hold their children by value) refers to the
+ *  same cached values.
+ */
+template <typename T>
+struct shared_state {
+	//reuse_last_value
+	index_type last_index;
+	T last_value;
+
+	//reuse_materialize
+	T* tile;
+	index_type tile_size;
+	index_type tile_begin;
+	index_type tile_end;
+};
+
+/**
+ *  A subexpression that is referenced more than once in an expression,
+ *
+ *  auto e = share(a * b, &arena);
+ *  auto pv = eval((e + c) / e, &arena);
+ *
+ *  S selects how the uses are served, by default from the cost model
+ *  (see reuse_choice in cost_model.h): cheap subtrees are recomputed
+ *  and expensive ones are evaluated one tile at a time into scratch
+ *  memory, which also serves shifted uses of the subtree.
+ *  reuse_last_value has to be asked for explicitly.
+ */
+template <typename E, reuse_strategy S>
+struct shared_expr {
+	using value_type = typename std::decay<decltype(std::declval<E&>()[0])>::type;
+
+	E child;
+	shared_state<value_type>* state;
+	//Index of child[0] in the unsliced expression, the cache is keyed by
+	//that index so that differently sliced uses agree
+	index_type base;
+
+	ALWAYS_INLINE
+	value_type operator[](index_type index) {
+		index_type at = base + index;
+
+		switch(S) {
+			case reuse_last_value:
+			if(state->last_index != at) {
+				state->last_value = child[index];
+				state->last_index = at;
+			}
+			return state->last_value;
+			case reuse_materialize:
+			if(at < state->tile_begin || at >= state->tile_end)
+				fill_tile(at);
+			return state->tile[at - state->tile_begin];
+			default:
+			return child[index];
+		}
+	}
+
+	void fill_tile(index_type at) {
+		index_type tile_size = state->tile_size;
+		index_type begin = maximum(base, at - (at % tile_size));
+		index_type end = minimum(at - (at % tile_size) + tile_size, base + length(child));
+
+		value_type* tile = state->tile;
+		for(index_type i = begin; i < end; ++i) {
+			tile[i - begin] = child[i - base];
+		}
+
+		state->tile_begin = begin;
+		state->tile_end = end;
+	}
+};
+
+/**
+ *  Drops the values cached by a shared subexpression.
+ *
+ *  The cache is keyed by index only, so it would serve values from
+ *  before a change of the leaves. Every function that evaluates an
+ *  expression calls reset_shared first. Nodes with children forward
+ *  it to them, leaves have nothing to reset (see vectors.h).
+ */
+template <typename E, reuse_strategy S>
+inline
+void reset_shared(shared_expr<E, S> e) {
+	e.state->last_index = -1;
+	e.state->tile_begin = 0;
+	e.state->tile_end = 0;
+
+	reset_shared(e.child);
+}
+
+template <typename E, reuse_strategy S>
+inline
+index_type length(shared_expr<E, S> e) {
+	return length(e.child);
+}
+
+template <typename E, reuse_strategy S>
+struct expr_cost<shared_expr<E, S>> {
+	static const int value = (S == reuse_recompute) ? expr_cost<E>::value : 2;
+};
+
+template <typename E, reuse_strategy S>
+inline
+bool is_contiguous(shared_expr<E, S> e) {
+	return is_contiguous(e.child);
+}
+
+template <typename E, reuse_strategy S>
+inline
+auto to_contiguous(shared_expr<E, S> e) -> shared_expr<decltype(to_contiguous(e.child)), S> {
+	shared_expr<decltype(to_contiguous(e.child)), S> result;
+
+	result.child = to_contiguous(e.child);
+	result.state = e.state;
+	result.base = e.base;
+
+	return result;
+}
+
+template <typename E, reuse_strategy S>
+inline
+index_type next_break(shared_expr<E, S> e, index_type from) {
+	return next_break(e.child, from);
+}
+
+template <typename E, reuse_strategy S>
+inline
+auto slice(shared_expr<E, S> e, index_type begin, index_type count)
+-> shared_expr<decltype(slice(e.child, begin, count)), S> {
+	shared_expr<decltype(slice(e.child, begin, count)), S> result;
+
+	result.child = slice(e.child, begin, count);
+	result.state = e.state;
+	result.base = e.base + begin;
+
+	return result;
+}
+
+//
+//  Factory functions
+//
+
+/**
+ *  Marks e for reuse with an explicitly chosen strategy, materialized
+ *  in chunks of tile_size elements if S is reuse_materialize.
+ *
+ *  The scratch state is allocated from arena and must outlive every
+ *  evaluation of expressions containing the result. The shared
+ *  expression must not be evaluated by two threads at the same time.
+ */
+template <reuse_strategy S, typename E>
+inline
+shared_expr<E, S> share(E e, arena* arena, index_type tile_size) {
+	using value_type = typename shared_expr<E, S>::value_type;
+	shared_expr<E, S> result;
+
+	assert(arena != nullptr);
+	assert(tile_size >= 1);
+
+	auto state = allocate<shared_state<value_type>>(arena, 1);
+	state->last_index = -1;
+	state->last_value = value_type();
+	state->tile = nullptr;
+	state->tile_size = 0;
+	state->tile_begin = 0;
+	state->tile_end = 0;
+
+	if(S == reuse_materialize) {
+		state->tile_size = maximum((index_type)1, minimum(tile_size, length(e)));
+		state->tile = allocate<value_type>(arena, state->tile_size);
+	}
+
+	result.child = e;
+	result.state = state;
+	result.base = 0;
+
+	return result;
+}
+
+/**
+ *  Marks e for reuse with an explicitly chosen strategy, materialized
+ *  in chunks of the current eval_tile (see tile_profile.h).
+ */
+template <reuse_strategy S, typename E>
+inline
+shared_expr<E, S> share(E e, arena* arena) {
+	return share<S>(e, arena, current_tile_profile().eval_tile);
+}
+
+/**
+ *  Marks e for reuse with the strategy picked by the cost model.
+ */
+template <typename E>
+inline
+shared_expr<E, reuse_choice<E>::value> share(E e, arena* arena) {
+	return share<reuse_choice<E>::value>(e, arena);
+}
+}
+
+// LIBAXL_SHARED_EXPR_GUARD
+#endif
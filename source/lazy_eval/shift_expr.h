@@ -0,0 +1,183 @@
+
+#ifndef LIBAXL_SHIFT_EXPR_GUARD
+#define LIBAXL_SHIFT_EXPR_GUARD
+
+namespace libaxl {
+
+/**
+ *  How a shifted read outside [0, length) is resolved.
+ *
+ *  boundary_clamp: repeat the first/last element
+ *  boundary_wrap:  read periodically, child[(i + k) mod length]
+ *  boundary_zero:  read a value-initialized element (0 for numbers)
+ */
+enum boundary_policy {
+	boundary_clamp,
+	boundary_wrap,
+	boundary_zero
+};
+
+namespace detail {
+	inline
+	index_type wrap_index(index_type index, index_type count) {
+		index %= count;
+		return index < 0 ? index + count : index;
+	}
+}
+
+/**
+ *  Shifted-index node: e[i] = child[i + offset].
+ *
+ *  The length is the length of the child, reads that fall outside
+ *  the child are resolved by the boundary policy P. Since P is a
+ *  template parameter the policy switch is resolved at compile time
+ *  and only a single, well predicted range test remains in the loop.
+ *
+ *  child_count is the length of the child and count the length of the
+ *  node, they differ only for slices (see slice below).
+ */
+template <typename T, boundary_policy P>
+struct shift_expr {
+	T child;
+	index_type offset;
+	index_type count;
+	index_type child_count;
+
+	using value_type = typename std::decay<decltype(std::declval<T&>()[0])>::type;
+
+	ALWAYS_INLINE
+	value_type operator[](index_type index) {
+		index_type shifted = index + offset;
+
+		if((size_type)shifted < (size_type)child_count)
+			return child[shifted];
+
+		switch(P) {
+			case boundary_clamp:
+			return child[shifted < 0 ? 0 : child_count - 1];
+			case boundary_wrap:
+			return child[detail::wrap_index(shifted, child_count)];
+			default:
+			return value_type();
+		}
+	}
+};
+
+template <typename T, boundary_policy P>
+inline
+index_type length(shift_expr<T, P> e) {
+	return e.count;
+}
+
+template <typename T, boundary_policy P>
+struct expr_cost<shift_expr<T, P>> {
+	static const int value = 1 + expr_cost<T>::value;
+};
+
+template <typename T, boundary_policy P>
+inline
+bool is_contiguous(shift_expr<T, P> e) {
+	return is_contiguous(e.child);
+}
+
+template <typename T, boundary_policy P>
+inline
+void reset_shared(shift_expr<T, P> e) {
+	reset_shared(e.child);
+}
+
+template <typename T, boundary_policy P>
+inline
+auto to_contiguous(shift_expr<T, P> e) -> shift_expr<decltype(to_contiguous(e.child)), P> {
+	shift_expr<decltype(to_contiguous(e.child)), P> result;
+
+	result.child = to_contiguous(e.child);
+	result.offset = e.offset;
+	result.count = e.count;
+	result.child_count = e.child_count;
+
+	return result;
+}
+
+/**
+ *  Breaks where the shifted reads cross into or out of the child, and
+ *  at the segment breaks of the child moved by the offset. A run then
+ *  reads either one contiguous range of the child or a single boundary
+ *  element.
+ */
+template <typename T, boundary_policy P>
+inline
+index_type next_break(shift_expr<T, P> e, index_type from) {
+	index_type at = from + e.offset;
+
+	if(at < 0 || at >= e.child_count) {
+		if(P != boundary_wrap)
+			return at < 0 ? -e.offset : detail::no_segment_break;
+
+		at = detail::wrap_index(at, e.child_count);
+	}
+
+	return from + (minimum(next_break(e.child, at), e.child_count) - at);
+}
+
+/**
+ *  Preconditions:
+ *  (1) [begin, begin + count) contains no break of e
+ */
+template <typename T, boundary_policy P>
+inline
+auto slice(shift_expr<T, P> e, index_type begin, index_type count)
+-> shift_expr<decltype(slice(e.child, begin, count)), P> {
+	shift_expr<decltype(slice(e.child, begin, count)), P> result;
+
+	index_type at = begin + e.offset;
+	bool inside = at >= 0 && at < e.child_count;
+
+	if(inside || P == boundary_wrap) {
+		at = detail::wrap_index(at, e.child_count);
+		assert(at + count <= e.child_count);
+
+		result.child = slice(e.child, at, count);
+		result.offset = 0;
+		result.child_count = count;
+	} else {
+		//Every read is the same boundary element (or a zero)
+		result.child = slice(e.child, at < 0 ? 0 : e.child_count - 1, 1);
+		result.offset = (P == boundary_zero) ? -count : 0;
+		result.child_count = 1;
+	}
+
+	result.count = count;
+
+	return result;
+}
+
+//
+//  Factory function
+//
+
+/**
+ *  shift(v, k)[i] == v[i + k], e.g. a three point smoother is
+ *  (shift(v, -1) + constant(2.0) * v + shift(v, 1)) / constant(4.0)
+ *
+ *  Preconditions:
+ *  (1) length(x) >= 1
+ */
+template <boundary_policy P = boundary_clamp, typename T>
+inline
+shift_expr<T, P> shift(T x, index_type offset) {
+	shift_expr<T, P> result;
+
+	result.child = x;
+	result.offset = offset;
+	result.count = length(x);
+	result.child_count = result.count;
+
+	assert(result.count >= 1);
+
+	return result;
+}
+}
+
+// LIBAXL_SHIFT_EXPR_GUARD
+#endif
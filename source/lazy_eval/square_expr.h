@@ -20,6 +20,49 @@ index_type length(square_expr<T> e) {
 	return length(e.child);
 }
 
+template <typename T>
+struct expr_cost<square_expr<T>> {
+	static const int value = 1 + expr_cost<T>::value;
+};
+
+template <typename T>
+inline
+bool is_contiguous(square_expr<T> e) {
+	return is_contiguous(e.child);
+}
+
+template <typename T>
+inline
+void reset_shared(square_expr<T> e) {
+	reset_shared(e.child);
+}
+
+template <typename T>
+inline
+auto to_contiguous(square_expr<T> e) -> square_expr<decltype(to_contiguous(e.child))> {
+	square_expr<decltype(to_contiguous(e.child))> result;
+
+	result.child = to_contiguous(e.child);
+
+	return result;
+}
+
+template <typename T>
+inline
+index_type next_break(square_expr<T> e, index_type from) {
+	return next_break(e.child, from);
+}
+
+template <typename T>
+inline
+auto slice(square_expr<T> e, index_type begin, index_type count) -> square_expr<decltype(slice(e.child, begin, count))> {
+	square_expr<decltype(slice(e.child, begin, count))> result;
+
+	result.child = slice(e.child, begin, count);
+
+	return result;
+}
+
 template <typename T>
 inline
 square_expr<T> square(T x) {
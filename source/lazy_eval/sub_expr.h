@@ -3,32 +3,25 @@
 #define LIBAXL_SUB_EXPR_GUARD
 
 namespace libaxl {
-template <typename T1, typename T2>
-struct sub_expr {
-	T1 left;
-	T2 right;
-
-	ALWAYS_INLINE
-	auto operator[](index_type index) -> decltype(left[index] - right[index]) {
-		return left[index] - right[index];
-	}
-};
+namespace detail {
+	struct sub_op {
+		static const int cost = 1;
+
+		template <typename A, typename B>
+		ALWAYS_INLINE
+		static auto apply(A a, B b) -> decltype(a - b) {
+			return a - b;
+		}
+	};
+}
 
 template <typename T1, typename T2>
-inline
-index_type length(sub_expr<T1, T2> e) {
-	return minimum(length(e.left), length(e.right));
-}
+using sub_expr = binary_expr<detail::sub_op, T1, T2>;
 
 template <typename T1, typename T2>
 inline
 sub_expr<T1, T2> operator-(T1 a, T2 b) {
-	sub_expr<T1, T2> result;
-
-	result.left = a;
-	result.right = b;
-
-	return result;
+	return detail::make_binary_expr<detail::sub_op>(a, b);
 }
 }
 
@@ -0,0 +1,150 @@
+
+#ifndef LIBAXL_TILE_TUNER_GUARD
+#define LIBAXL_TILE_TUNER_GUARD
+
+#include <chrono>
+
+#include "../util.h"
+#include "../arena.h"
+#include "../tile_profile.h"
+#include "lazy_eval.h"
+
+namespace libaxl {
+
+namespace detail {
+	const index_type tile_candidates[] = { 256, 512, 1024, 2048, 4096, 8192, 16384, 32768 };
+	const int tile_candidate_count = sizeof(tile_candidates) / sizeof(tile_candidates[0]);
+
+	//Timed runs per candidate, the fastest run is kept
+	const int tile_tuner_repetitions = 5;
+
+	inline
+	double seconds_since(std::chrono::steady_clock::time_point start) {
+		std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+		return elapsed.count();
+	}
+
+	/**
+	 *  Best-of-N time of an expensive shared subexpression that is
+	 *  materialized in chunks of tile elements and read at three
+	 *  offsets.
+	 */
+	inline
+	double time_eval_tile(stack_arena* arena, vector_f64 a, vector_f64 b, vector_f64 c, vector_f64 out, index_type tile) {
+		double best = 1e300;
+
+		for(int rep = 0; rep < tile_tuner_repetitions; ++rep) {
+			stack_arena_scope scope{ arena };
+			auto start = std::chrono::steady_clock::now();
+
+			auto e = share<reuse_materialize>((a + b * c) / (a + constant(1.0)), arena, tile);
+			assign(out, shift(e, -1) + constant(2.0) * e + shift(e, 1));
+
+			best = minimum(best, seconds_since(start));
+		}
+
+		return best;
+	}
+
+	/**
+	 *  Best-of-N time of two early-out reductions that scan all of a in
+	 *  blocks of tile elements.
+	 *
+	 *  The results go to a volatile, without an observable use the
+	 *  optimizer drops the scans and release builds time nothing.
+	 */
+	inline
+	double time_reduce_tile(vector_f64 a, index_type tile) {
+		double best = 1e300;
+
+		volatile bool sink = false;
+		for(int rep = 0; rep < tile_tuner_repetitions; ++rep) {
+			auto start = std::chrono::steady_clock::now();
+
+			//a is >= 0 everywhere so both scans run to the end
+			sink = any_blocked(a < constant(-1.0), tile);
+			sink = !all_blocked(a >= constant(0.0), tile);
+
+			best = minimum(best, seconds_since(start));
+		}
+
+		//The volatile read counts as a use
+		(void)sink;
+
+		return best;
+	}
+}
+
+/**
+ *  Benchmarks every candidate tile size on representative expression
+ *  shapes over count elements and returns the fastest profile.
+ *
+ *  count should be well above the L2 size of the host (a few million
+ *  doubles) so that the measurement includes the memory hierarchy.
+ *  All scratch memory is released from arena before returning.
+ *
+ *  The current profile is not modified, see set_tile_profile.
+ */
+inline
+tile_profile tune_tile_profile(stack_arena* arena, index_type count) {
+	assert(arena != nullptr);
+	assert(count >= 3);
+
+	stack_arena_scope scope{ arena };
+
+	vector_f64 a = make_uninitialized_vector<f64>(arena, count);
+	vector_f64 b = make_uninitialized_vector<f64>(arena, count);
+	vector_f64 c = make_uninitialized_vector<f64>(arena, count);
+	vector_f64 out = make_uninitialized_vector<f64>(arena, count);
+
+	for(index_type i = 0; i < count; ++i) {
+		a.array[i] = (f64)(i % 17);
+		b.array[i] = 1.0 + (f64)(i % 5);
+		c.array[i] = 0.5;
+	}
+
+	tile_profile result = default_tile_profile();
+
+	double best_eval = 1e300;
+	double best_reduce = 1e300;
+
+	for(int i = 0; i < detail::tile_candidate_count; ++i) {
+		index_type tile = detail::tile_candidates[i];
+
+		double eval_time = detail::time_eval_tile(arena, a, b, c, out, tile);
+		if(eval_time < best_eval) {
+			best_eval = eval_time;
+			result.eval_tile = tile;
+		}
+
+		double reduce_time = detail::time_reduce_tile(a, tile);
+		if(reduce_time < best_reduce) {
+			best_reduce = reduce_time;
+			result.reduce_tile = tile;
+		}
+	}
+
+	return result;
+}
+
+/**
+ *  Loads the profile cached at path, or tunes and caches a new one
+ *  if there is none, and makes it the current profile.
+ */
+inline
+tile_profile load_or_tune_tile_profile(const char* path, stack_arena* arena, index_type count) {
+	tile_profile result;
+
+	if(!load_tile_profile(path, &result)) {
+		result = tune_tile_profile(arena, count);
+		save_tile_profile(path, result);
+	}
+
+	set_tile_profile(result);
+
+	return result;
+}
+}
+
+// LIBAXL_TILE_TUNER_GUARD
+#endif
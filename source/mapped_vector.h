@@ -0,0 +1,331 @@
+
+#ifndef LIBAXL_MAPPED_VECTOR_GUARD
+#define LIBAXL_MAPPED_VECTOR_GUARD
+
+#include "util.h"
+#include "vectors.h"
+
+#if defined(_WIN32)
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace libaxl {
+
+/**
+ *  Mapped vectors are vector<T> views of a file region backed by the
+ *  page cache: kernels read the file contents in place, without
+ *  copying them into an arena first.
+ *
+ *  The memory is not arena memory. It is obtained by map_vector and
+ *  released by unmap_vector, or by a mapped_vector_scope. Views made
+ *  from a mapped vector (take, drop, drop_even, ...) are only valid
+ *  until it is unmapped.
+ */
+
+/**
+ *  map_read:       read-only, writing to the vector faults
+ *  map_read_write: shared, writes go to the file
+ */
+enum map_access {
+	map_read,
+	map_read_write
+};
+
+/**
+ *  Access pattern hints for the pages of a mapped vector.
+ */
+enum map_advice {
+	map_advice_normal,
+	map_advice_sequential,
+	map_advice_random,
+	map_advice_willneed,
+	map_advice_hugepage
+};
+
+namespace detail {
+	//Mapping offsets must be multiples of this
+	inline
+	size_type map_granularity() {
+#if defined(_WIN32)
+		SYSTEM_INFO info;
+		GetSystemInfo(&info);
+		return (size_type)info.dwAllocationGranularity;
+#else
+		return (size_type)sysconf(_SC_PAGESIZE);
+#endif
+	}
+
+	inline
+	size_type map_page_size() {
+#if defined(_WIN32)
+		SYSTEM_INFO info;
+		GetSystemInfo(&info);
+		return (size_type)info.dwPageSize;
+#else
+		return (size_type)sysconf(_SC_PAGESIZE);
+#endif
+	}
+
+	/**
+	 *  Maps bytes [offset, offset + size) of the file at path, size ==
+	 *  0 meaning up to the end of the file. The mapping starts at
+	 *  offset rounded down to map_granularity().
+	 *
+	 *  Returns a pointer to the byte at offset and the mapped size in
+	 *  *size, nullptr if the file cannot be opened or mapped or is too
+	 *  short.
+	 */
+	inline
+	unsigned char* map_file(const char* path, size_type offset, size_type* size, map_access access) {
+		size_type aligned_offset = offset - offset % map_granularity();
+		size_type lead = offset - aligned_offset;
+
+#if defined(_WIN32)
+		bool writable = (access == map_read_write);
+		HANDLE file = CreateFileA(path, writable ? (GENERIC_READ | GENERIC_WRITE) : GENERIC_READ,
+			FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+		if(file == INVALID_HANDLE_VALUE)
+			return nullptr;
+
+		LARGE_INTEGER file_size;
+		if(!GetFileSizeEx(file, &file_size) || (size_type)file_size.QuadPart < offset) {
+			CloseHandle(file);
+			return nullptr;
+		}
+		if(*size == 0)
+			*size = (size_type)file_size.QuadPart - offset;
+		if(*size == 0 || (size_type)file_size.QuadPart - offset < *size) {
+			CloseHandle(file);
+			return nullptr;
+		}
+
+		HANDLE section = CreateFileMappingW(file, nullptr, writable ? PAGE_READWRITE : PAGE_READONLY, 0, 0, nullptr);
+		CloseHandle(file);
+		if(!section)
+			return nullptr;
+
+		void* view = MapViewOfFile(section, writable ? FILE_MAP_WRITE : FILE_MAP_READ,
+			(DWORD)((unsigned long long)aligned_offset >> 32), (DWORD)aligned_offset, lead + *size);
+
+		//The view keeps the section alive
+		CloseHandle(section);
+
+		if(!view)
+			return nullptr;
+		return (unsigned char*)view + lead;
+#else
+		int fd = open(path, (access == map_read_write) ? O_RDWR : O_RDONLY);
+		if(fd < 0)
+			return nullptr;
+
+		struct stat info;
+		if(fstat(fd, &info) != 0 || (size_type)info.st_size < offset) {
+			::close(fd);
+			return nullptr;
+		}
+		if(*size == 0)
+			*size = (size_type)info.st_size - offset;
+		if(*size == 0 || (size_type)info.st_size - offset < *size) {
+			::close(fd);
+			return nullptr;
+		}
+
+		int protection = (access == map_read_write) ? (PROT_READ | PROT_WRITE) : PROT_READ;
+		void* base = mmap(nullptr, lead + *size, protection, MAP_SHARED, fd, (off_t)aligned_offset);
+
+		//The mapping keeps the file open
+		::close(fd);
+
+		if(base == MAP_FAILED)
+			return nullptr;
+		return (unsigned char*)base + lead;
+#endif
+	}
+
+	inline
+	void unmap_file(unsigned char* data, size_type size) {
+		auto address = (size_type)data;
+		size_type lead = address % map_granularity();
+
+#if defined(_WIN32)
+		(void)size;
+		UnmapViewOfFile(data - lead);
+#else
+		munmap(data - lead, lead + size);
+#endif
+	}
+}
+
+/**
+ *  Maps count elements of type T starting at byte offset of the file
+ *  at path.
+ *
+ *  Preconditions:
+ *  (1) count >= 1
+ *  (2) offset is a multiple of alignof(T)
+ *
+ *  On failure (missing file, range beyond the end of the file, no
+ *  address space) the returned vector has array == nullptr and
+ *  count == 0.
+ */
+template <typename T>
+inline
+vector<T> map_vector(const char* path, size_type offset, index_type count, map_access access = map_read) {
+	vector<T> result;
+
+	assert(path != nullptr);
+	assert(count >= 1);
+	assert(offset % alignof(T) == 0);
+
+	size_type size = (size_type)count * sizeof(T);
+
+	result.array = (T*)detail::map_file(path, offset, &size, access);
+	result.count = result.array ? count : 0;
+	result.stride = 1;
+
+	return result;
+}
+
+/**
+ *  Maps the whole file at path. Same failure convention as above, a
+ *  file that does not hold a whole number of elements, or more than
+ *  index_type_max of them, also fails.
+ */
+template <typename T>
+inline
+vector<T> map_vector(const char* path, map_access access = map_read) {
+	vector<T> result;
+
+	assert(path != nullptr);
+
+	size_type size = 0;
+
+	result.array = (T*)detail::map_file(path, 0, &size, access);
+	result.count = 0;
+	result.stride = 1;
+
+	if(result.array) {
+		//A trailing partial element or more elements than index_type
+		//can count are failures like a missing file
+		if(size % sizeof(T) != 0 || size / sizeof(T) > (size_type)index_type_max) {
+			detail::unmap_file((unsigned char*)result.array, size);
+			result.array = nullptr;
+			return result;
+		}
+
+		result.count = (index_type)(size / sizeof(T));
+	}
+
+	return result;
+}
+
+/**
+ *  Releases a vector returned by map_vector. Views of it become
+ *  invalid.
+ *
+ *  Preconditions:
+ *  (1) v is exactly a vector returned by map_vector, or empty
+ */
+template <typename T>
+inline
+void unmap_vector(vector<T>& v) {
+	if(v.array) {
+		assert(v.stride == 1);
+		detail::unmap_file((unsigned char*)v.array, (size_type)v.count * sizeof(T));
+	}
+
+	v.array = nullptr;
+	v.count = 0;
+}
+
+/**
+ *  Hints the expected access pattern of v, which may be any contiguous
+ *  view of a mapped vector. Returns false if the hint is not supported
+ *  on this platform (map_advice_hugepage on read-only file mappings,
+ *  most hints on Windows) or was rejected.
+ */
+template <typename T>
+inline
+bool advise(vector<T> v, map_advice advice) {
+	if(is_empty(v))
+		return true;
+
+	assert(v.stride == 1);
+
+	size_type page_size = detail::map_page_size();
+	auto address = (size_type)v.array;
+	size_type lead = address % page_size;
+	size_type size = lead + (size_type)v.count * sizeof(T);
+	auto base = (unsigned char*)v.array - lead;
+
+#if defined(_WIN32)
+	if(advice != map_advice_willneed)
+		return advice == map_advice_normal;
+
+	WIN32_MEMORY_RANGE_ENTRY range;
+	range.VirtualAddress = base;
+	range.NumberOfBytes = size;
+	return PrefetchVirtualMemory(GetCurrentProcess(), 1, &range, 0) != 0;
+#else
+	int hint;
+	switch(advice) {
+		case map_advice_sequential:
+		hint = MADV_SEQUENTIAL;
+		break;
+		case map_advice_random:
+		hint = MADV_RANDOM;
+		break;
+		case map_advice_willneed:
+		hint = MADV_WILLNEED;
+		break;
+		case map_advice_hugepage:
+#ifdef MADV_HUGEPAGE
+		hint = MADV_HUGEPAGE;
+		break;
+#else
+		return false;
+#endif
+		default:
+		hint = MADV_NORMAL;
+		break;
+	}
+
+	return madvise(base, size, hint) == 0;
+#endif
+}
+
+/**
+ *  Unmaps a mapped vector when the scope ends.
+ */
+template <typename T>
+struct mapped_vector_scope {
+private:
+	vector<T>* v;
+public:
+	explicit mapped_vector_scope(vector<T>* v) : v(v) {
+		assert(v != nullptr);
+	}
+	~mapped_vector_scope() {
+		unmap_vector(*v);
+	}
+
+	//Make non-copyable/non-movable
+
+	mapped_vector_scope(const mapped_vector_scope&) = delete;
+	mapped_vector_scope(mapped_vector_scope&&) = delete;
+
+	mapped_vector_scope& operator=(const mapped_vector_scope&) = delete;
+	mapped_vector_scope& operator=(mapped_vector_scope&&) = delete;
+};
+}
+
+// LIBAXL_MAPPED_VECTOR_GUARD
+#endif
@@ -0,0 +1,469 @@
+
+#ifndef LIBAXL_MATRIX_GUARD
+#define LIBAXL_MATRIX_GUARD
+
+#include "util.h"
+#include "arena.h"
+#include "vectors.h"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+namespace libaxl {
+
+/**
+ *  A 2D view, the matrix equivalent of vector<T>: element (i, j) is
+ *  array[i * row_stride + j * col_stride].
+ *
+ *  Row-major storage has col_stride == 1, column-major storage has
+ *  row_stride == 1. Rows, columns, submatrices and the transpose are
+ *  all views of the same elements, made by adjusting the strides.
+ */
+template <typename T>
+struct matrix {
+	T* array;
+	index_type rows;
+	index_type cols;
+	index_type row_stride;
+	index_type col_stride;
+
+	ALWAYS_INLINE T& operator()(index_type row, index_type col);
+};
+
+template <typename T>
+ALWAYS_INLINE
+T& matrix<T>::operator()(index_type row, index_type col) {
+	assert(row >= 0 && row < rows); // Bounds checking
+	assert(col >= 0 && col < cols);
+
+	return array[row * row_stride + col * col_stride];
+}
+
+/**
+ *  Creates a row-major rows x cols matrix, uninitialized.
+ */
+template <typename T>
+inline
+matrix<T> make_uninitialized_matrix(arena* arena, index_type rows, index_type cols) {
+	matrix<T> result;
+
+	assert(arena != nullptr);
+	assert(rows >= 0 && cols >= 0);
+
+	result.array = allocate<T>(arena, rows * cols);
+	result.rows = rows;
+	result.cols = cols;
+	result.row_stride = cols;
+	result.col_stride = 1;
+
+	return result;
+}
+
+template <typename T>
+inline
+matrix<T> zeros_matrix(arena* arena, index_type rows, index_type cols) {
+	matrix<T> result = make_uninitialized_matrix<T>(arena, rows, cols);
+
+	memset(result.array, 0, (size_type)rows * cols * sizeof(T));
+
+	return result;
+}
+
+/**
+ *  Views the contiguous v as a row-major rows x cols matrix.
+ *
+ *  Preconditions:
+ *  (1) v.stride == 1
+ *  (2) length(v) >= rows * cols
+ */
+template <typename T>
+inline
+matrix<T> as_matrix(vector<T> v, index_type rows, index_type cols) {
+	matrix<T> result;
+
+	assert(v.stride == 1);
+	assert(rows >= 0 && cols >= 0 && length(v) >= rows * cols);
+
+	result.array = v.array;
+	result.rows = rows;
+	result.cols = cols;
+	result.row_stride = cols;
+	result.col_stride = 1;
+
+	return result;
+}
+
+template <typename T>
+inline
+index_type row_count(matrix<T> m) {
+	return m.rows;
+}
+
+template <typename T>
+inline
+index_type column_count(matrix<T> m) {
+	return m.cols;
+}
+
+template <typename T>
+inline
+vector<T> row(matrix<T> m, index_type index) {
+	vector<T> result;
+
+	assert(index >= 0 && index < m.rows);
+
+	result.array = m.array + index * m.row_stride;
+	result.count = m.cols;
+	result.stride = m.col_stride;
+
+	return result;
+}
+
+template <typename T>
+inline
+vector<T> column(matrix<T> m, index_type index) {
+	vector<T> result;
+
+	assert(index >= 0 && index < m.cols);
+
+	result.array = m.array + index * m.col_stride;
+	result.count = m.rows;
+	result.stride = m.row_stride;
+
+	return result;
+}
+
+/**
+ *  The transpose as a view: the strides swap, no element moves.
+ *  gather.h has the kernel that moves the elements.
+ */
+template <typename T>
+inline
+matrix<T> transpose(matrix<T> m) {
+	matrix<T> result;
+
+	result.array = m.array;
+	result.rows = m.cols;
+	result.cols = m.rows;
+	result.row_stride = m.col_stride;
+	result.col_stride = m.row_stride;
+
+	return result;
+}
+
+/**
+ *  The rows x cols block starting at (row, col).
+ */
+template <typename T>
+inline
+matrix<T> submatrix(matrix<T> m, index_type row, index_type col, index_type rows, index_type cols) {
+	assert(row >= 0 && col >= 0 && rows >= 0 && cols >= 0);
+	assert(row + rows <= m.rows && col + cols <= m.cols);
+
+	m.array += row * m.row_stride + col * m.col_stride;
+	m.rows = rows;
+	m.cols = cols;
+
+	return m;
+}
+
+//
+//  GEMM
+//
+//  The product is computed block by block: a kc x nc block of B and an
+//  mc x kc block of A are packed into scratch, laid out so that the
+//  micro kernel reads both with unit stride whatever the strides of
+//  the operands are. The micro kernel keeps an mr x nr block of C in
+//  registers over the whole kc loop. Blocks are sized for a kc x nr
+//  panel of B to stay in L1, the packed A block in L2 and the packed B
+//  block in L3.
+//
+
+namespace detail {
+	const index_type gemm_mr = 4;
+	const index_type gemm_nr = 8;
+	const index_type gemm_kc = 256;
+	const index_type gemm_mc = 128;
+	const index_type gemm_nc = 2048;
+
+	/**
+	 *  Packs the mc x kc block of A at a into panels of mr rows, each
+	 *  stored column by column. Rows past mc are zero.
+	 */
+	template <typename T>
+	inline
+	void pack_a(matrix<T> a, T* packed) {
+		for(index_type i = 0; i < a.rows; i += gemm_mr) {
+			index_type mr = minimum(gemm_mr, a.rows - i);
+
+			for(index_type k = 0; k < a.cols; ++k) {
+				const T* from = a.array + i * a.row_stride + k * a.col_stride;
+				index_type r = 0;
+				for(; r < mr; ++r)
+					packed[r] = from[r * a.row_stride];
+				for(; r < gemm_mr; ++r)
+					packed[r] = T();
+				packed += gemm_mr;
+			}
+		}
+	}
+
+	/**
+	 *  Packs the kc x nc block of B at b into panels of nr columns, each
+	 *  stored row by row. Columns past nc are zero.
+	 */
+	template <typename T>
+	inline
+	void pack_b(matrix<T> b, T* packed) {
+		for(index_type j = 0; j < b.cols; j += gemm_nr) {
+			index_type nr = minimum(gemm_nr, b.cols - j);
+
+			for(index_type k = 0; k < b.rows; ++k) {
+				const T* from = b.array + k * b.row_stride + j * b.col_stride;
+				index_type c = 0;
+				if(b.col_stride == 1) {
+					for(; c < nr; ++c)
+						packed[c] = from[c];
+				} else {
+					for(; c < nr; ++c)
+						packed[c] = from[c * b.col_stride];
+				}
+				for(; c < gemm_nr; ++c)
+					packed[c] = T();
+				packed += gemm_nr;
+			}
+		}
+	}
+
+	/**
+	 *  acc = a_panel * b_panel over kc, mr x nr, written row-major.
+	 */
+	template <typename T>
+	inline
+	void gemm_micro_kernel(index_type kc, const T* a, const T* b, T* acc) {
+		T sum[gemm_mr][gemm_nr] = {};
+
+		for(index_type k = 0; k < kc; ++k) {
+			for(index_type r = 0; r < gemm_mr; ++r) {
+				T a_value = a[r];
+				for(index_type c = 0; c < gemm_nr; ++c)
+					sum[r][c] += a_value * b[c];
+			}
+			a += gemm_mr;
+			b += gemm_nr;
+		}
+
+		for(index_type r = 0; r < gemm_mr; ++r) {
+			for(index_type c = 0; c < gemm_nr; ++c)
+				acc[r * gemm_nr + c] = sum[r][c];
+		}
+	}
+
+#if defined(__AVX2__) && (defined(__FMA__) || defined(_MSC_VER))
+	//4 x 8 doubles in 8 registers, one broadcast and two FMAs per row
+	inline
+	void gemm_micro_kernel(index_type kc, const f64* a, const f64* b, f64* acc) {
+		__m256d c00 = _mm256_setzero_pd(), c01 = _mm256_setzero_pd();
+		__m256d c10 = _mm256_setzero_pd(), c11 = _mm256_setzero_pd();
+		__m256d c20 = _mm256_setzero_pd(), c21 = _mm256_setzero_pd();
+		__m256d c30 = _mm256_setzero_pd(), c31 = _mm256_setzero_pd();
+
+		for(index_type k = 0; k < kc; ++k) {
+			__m256d b0 = _mm256_loadu_pd(b);
+			__m256d b1 = _mm256_loadu_pd(b + 4);
+
+			__m256d a0 = _mm256_broadcast_sd(a);
+			c00 = _mm256_fmadd_pd(a0, b0, c00);
+			c01 = _mm256_fmadd_pd(a0, b1, c01);
+			__m256d a1 = _mm256_broadcast_sd(a + 1);
+			c10 = _mm256_fmadd_pd(a1, b0, c10);
+			c11 = _mm256_fmadd_pd(a1, b1, c11);
+			__m256d a2 = _mm256_broadcast_sd(a + 2);
+			c20 = _mm256_fmadd_pd(a2, b0, c20);
+			c21 = _mm256_fmadd_pd(a2, b1, c21);
+			__m256d a3 = _mm256_broadcast_sd(a + 3);
+			c30 = _mm256_fmadd_pd(a3, b0, c30);
+			c31 = _mm256_fmadd_pd(a3, b1, c31);
+
+			a += gemm_mr;
+			b += gemm_nr;
+		}
+
+		_mm256_storeu_pd(acc, c00);
+		_mm256_storeu_pd(acc + 4, c01);
+		_mm256_storeu_pd(acc + 8, c10);
+		_mm256_storeu_pd(acc + 12, c11);
+		_mm256_storeu_pd(acc + 16, c20);
+		_mm256_storeu_pd(acc + 20, c21);
+		_mm256_storeu_pd(acc + 24, c30);
+		_mm256_storeu_pd(acc + 28, c31);
+	}
+#endif
+
+	template <typename T>
+	inline
+	void scale_matrix(matrix<T> m, T beta) {
+		for(index_type i = 0; i < m.rows; ++i) {
+			for(index_type j = 0; j < m.cols; ++j) {
+				T& value = m(i, j);
+				//beta == 0 overwrites, so that NaN in C does not survive
+				value = (beta == T()) ? T() : beta * value;
+			}
+		}
+	}
+
+	/**
+	 *  C += alpha * packed A block * packed B block.
+	 */
+	template <typename T>
+	inline
+	void gemm_macro_kernel(index_type mc, index_type nc, index_type kc, T alpha,
+		const T* packed_a, const T* packed_b, matrix<T> c)
+	{
+		T acc[gemm_mr * gemm_nr];
+
+		for(index_type j = 0; j < nc; j += gemm_nr) {
+			index_type nr = minimum(gemm_nr, nc - j);
+
+			for(index_type i = 0; i < mc; i += gemm_mr) {
+				index_type mr = minimum(gemm_mr, mc - i);
+
+				gemm_micro_kernel(kc, packed_a + i * kc, packed_b + j * kc, acc);
+
+				T* to = c.array + i * c.row_stride + j * c.col_stride;
+				for(index_type r = 0; r < mr; ++r) {
+					for(index_type s = 0; s < nr; ++s)
+						to[r * c.row_stride + s * c.col_stride] += alpha * acc[r * gemm_nr + s];
+				}
+			}
+		}
+	}
+}
+
+/**
+ *  C = alpha * A * B + beta * C.
+ *
+ *  The operands may have any strides, e.g. transpose(a) multiplies by
+ *  the transpose without moving it. The packing scratch (about
+ *  (mc + nc) * kc elements) is allocated from arena, wrap the call in a
+ *  stack_arena_scope to release it.
+ *
+ *  Preconditions:
+ *  (1) a.cols == b.rows, c.rows == a.rows, c.cols == b.cols
+ *  (2) c does not overlap a or b
+ */
+template <typename T>
+inline
+void gemm(arena* arena, T alpha, matrix<T> a, matrix<T> b, T beta, matrix<T> c) {
+	assert(arena != nullptr);
+	assert(a.cols == b.rows && c.rows == a.rows && c.cols == b.cols);
+
+	if(beta != (T)1)
+		detail::scale_matrix(c, beta);
+
+	if(a.rows == 0 || b.cols == 0 || a.cols == 0)
+		return;
+
+	const index_type mr = detail::gemm_mr;
+	const index_type nr = detail::gemm_nr;
+
+	index_type kc_max = minimum(detail::gemm_kc, a.cols);
+	index_type mc_max = minimum(detail::gemm_mc, a.rows);
+	index_type nc_max = minimum(detail::gemm_nc, b.cols);
+
+	T* packed_a = allocate<T>(arena, ((mc_max + mr - 1) / mr) * mr * kc_max);
+	T* packed_b = allocate<T>(arena, ((nc_max + nr - 1) / nr) * nr * kc_max);
+
+	for(index_type jc = 0; jc < b.cols; jc += detail::gemm_nc) {
+		index_type nc = minimum(detail::gemm_nc, b.cols - jc);
+
+		for(index_type pc = 0; pc < a.cols; pc += detail::gemm_kc) {
+			index_type kc = minimum(detail::gemm_kc, a.cols - pc);
+
+			detail::pack_b(submatrix(b, pc, jc, kc, nc), packed_b);
+
+			for(index_type ic = 0; ic < a.rows; ic += detail::gemm_mc) {
+				index_type mc = minimum(detail::gemm_mc, a.rows - ic);
+
+				detail::pack_a(submatrix(a, ic, pc, mc, kc), packed_a);
+				detail::gemm_macro_kernel(mc, nc, kc, alpha, packed_a, packed_b, submatrix(c, ic, jc, mc, nc));
+			}
+		}
+	}
+}
+
+/**
+ *  Allocates C = A * B, row-major, from arena.
+ */
+template <typename T>
+inline
+matrix<T> gemm(arena* arena, matrix<T> a, matrix<T> b) {
+	matrix<T> result = make_uninitialized_matrix<T>(arena, a.rows, b.cols);
+	gemm(arena, (T)1, a, b, (T)0, result);
+	return result;
+}
+
+//
+//  GEMV
+//
+
+/**
+ *  y = alpha * A * x + beta * y.
+ *
+ *  Row-major A is done as dot products of rows with x, column-major A
+ *  as scaled column additions to y, so A is always read with unit
+ *  stride. x is packed into arena scratch when it is strided, wrap the
+ *  call in a stack_arena_scope to release it.
+ *
+ *  Preconditions:
+ *  (1) length(x) == a.cols, length(y) == a.rows
+ *  (2) y does not overlap a or x
+ */
+template <typename T>
+inline
+void gemv(arena* arena, T alpha, matrix<T> a, vector<T> x, T beta, vector<T> y) {
+	assert(arena != nullptr);
+	assert(length(x) == a.cols && length(y) == a.rows);
+
+	for(index_type i = 0; i < a.rows; ++i)
+		y[i] = (beta == T()) ? T() : beta * y[i];
+
+	if(a.cols == 0)
+		return;
+
+	const T* xs = x.array;
+	if(x.stride != 1) {
+		T* packed = allocate<T>(arena, a.cols);
+		for(index_type k = 0; k < a.cols; ++k)
+			packed[k] = x[k];
+		xs = packed;
+	}
+
+	if(a.col_stride == 1) {
+		for(index_type i = 0; i < a.rows; ++i)
+			y[i] += alpha * detail::dot_contiguous(a.array + i * a.row_stride, xs, a.cols);
+		return;
+	}
+
+	if(a.row_stride == 1 && y.stride == 1) {
+		for(index_type k = 0; k < a.cols; ++k) {
+			const T* col = a.array + k * a.col_stride;
+			T scaled = alpha * xs[k];
+			for(index_type i = 0; i < a.rows; ++i)
+				y.array[i] += scaled * col[i];
+		}
+		return;
+	}
+
+	for(index_type i = 0; i < a.rows; ++i) {
+		T sum = T();
+		for(index_type k = 0; k < a.cols; ++k)
+			sum += a(i, k) * xs[k];
+		y[i] += alpha * sum;
+	}
+}
+}
+
+// LIBAXL_MATRIX_GUARD
+#endif
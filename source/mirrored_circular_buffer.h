@@ -0,0 +1,283 @@
+
+#ifndef LIBAXL_MIRRORED_CIRCULAR_BUFFER_GUARD
+#define LIBAXL_MIRRORED_CIRCULAR_BUFFER_GUARD
+
+#include "util.h"
+#include "vectors.h"
+#include "circular_buffer.h"
+
+#if defined(_WIN32)
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+namespace libaxl {
+
+/**
+ *  A circular buffer whose storage is mapped twice, back to back, in
+ *  virtual memory: element count + i is the same memory as element i.
+ *
+ *  Every read or write window, also one that crosses the wrap point,
+ *  is therefore a single contiguous vector<T> and any kernel can run
+ *  directly on the ring contents.
+ *
+ *  The storage is not arena memory, it is obtained from the OS by
+ *  make_mirrored_circular_buffer and released by
+ *  destroy_mirrored_circular_buffer.
+ */
+template <typename T>
+struct mirrored_circular_buffer {
+	vector<T> buf_vector;
+	index_type tail;
+};
+
+namespace detail {
+	inline
+	size_type mirror_granularity() {
+#if defined(_WIN32)
+		SYSTEM_INFO info;
+		GetSystemInfo(&info);
+		return (size_type)info.dwAllocationGranularity;
+#else
+		return (size_type)sysconf(_SC_PAGESIZE);
+#endif
+	}
+
+	/**
+	 *  Maps size bytes of zeroed memory twice, at base and base + size.
+	 *  size must be a multiple of mirror_granularity().
+	 *  Returns nullptr on failure.
+	 */
+	inline
+	unsigned char* map_mirrored(size_type size) {
+#if defined(_WIN32)
+		HANDLE section = CreateFileMappingW(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE,
+			(DWORD)((unsigned long long)size >> 32), (DWORD)size, nullptr);
+		if(!section)
+			return nullptr;
+
+		unsigned char* result = nullptr;
+
+		//Find a free range of 2 * size bytes and map both views into it.
+		//Another thread may grab the range in between, so retry a few times.
+		for(int attempt = 0; attempt < 16 && !result; ++attempt) {
+			void* range = VirtualAlloc(nullptr, 2 * size, MEM_RESERVE, PAGE_NOACCESS);
+			if(!range)
+				break;
+			VirtualFree(range, 0, MEM_RELEASE);
+
+			auto base = (unsigned char*)range;
+			void* first_view = MapViewOfFileEx(section, FILE_MAP_ALL_ACCESS, 0, 0, size, base);
+			void* second_view = MapViewOfFileEx(section, FILE_MAP_ALL_ACCESS, 0, 0, size, base + size);
+
+			if(first_view == base && second_view == base + size) {
+				result = base;
+			} else {
+				if(first_view)
+					UnmapViewOfFile(first_view);
+				if(second_view)
+					UnmapViewOfFile(second_view);
+			}
+		}
+
+		//The views keep the section alive
+		CloseHandle(section);
+
+		return result;
+#else
+		int fd = memfd_create("libaxl_mirrored_circular_buffer", MFD_CLOEXEC);
+		if(fd < 0)
+			return nullptr;
+
+		if(ftruncate(fd, (off_t)size) != 0) {
+			::close(fd);
+			return nullptr;
+		}
+
+		//Reserve the whole range first so that both halves are adjacent
+		void* range = mmap(nullptr, 2 * size, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		if(range == MAP_FAILED) {
+			::close(fd);
+			return nullptr;
+		}
+
+		auto base = (unsigned char*)range;
+		void* first_view = mmap(base, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0);
+		void* second_view = mmap(base + size, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0);
+
+		//The mappings keep the memory object alive
+		::close(fd);
+
+		if(first_view != base || second_view != base + size) {
+			munmap(base, 2 * size);
+			return nullptr;
+		}
+
+		return base;
+#endif
+	}
+
+	inline
+	void unmap_mirrored(unsigned char* base, size_type size) {
+#if defined(_WIN32)
+		UnmapViewOfFile(base);
+		UnmapViewOfFile(base + size);
+#else
+		munmap(base, 2 * size);
+#endif
+	}
+}
+
+/**
+ *  Creates a zero filled mirrored circular buffer of at least count
+ *  elements. The count is rounded up so that the storage is a whole
+ *  number of pages (allocation granules on Windows), use length()
+ *  for the actual size.
+ *
+ *  Preconditions:
+ *  (1) count >= 1
+ *  (2) sizeof(T) divides the page size
+ *
+ *  On failure the returned buffer has buf_vector.array == nullptr.
+ */
+template <typename T>
+inline
+mirrored_circular_buffer<T> make_mirrored_circular_buffer(index_type count) {
+	mirrored_circular_buffer<T> result;
+
+	assert(count >= 1);
+
+	size_type granularity = detail::mirror_granularity();
+	assert(granularity % sizeof(T) == 0);
+
+	size_type size = (size_type)count * sizeof(T);
+	size = ((size + granularity - 1) / granularity) * granularity;
+
+	result.buf_vector.array = (T*)detail::map_mirrored(size);
+	result.buf_vector.count = result.buf_vector.array ? (index_type)(size / sizeof(T)) : 0;
+	result.buf_vector.stride = 1;
+	result.tail = 0;
+
+	return result;
+}
+
+template <typename T>
+inline
+void destroy_mirrored_circular_buffer(mirrored_circular_buffer<T>& c) {
+	if(c.buf_vector.array) {
+		detail::unmap_mirrored((unsigned char*)c.buf_vector.array, (size_type)c.buf_vector.count * sizeof(T));
+	}
+
+	c.buf_vector.array = nullptr;
+	c.buf_vector.count = 0;
+	c.tail = 0;
+}
+
+template <typename T>
+inline
+index_type length(mirrored_circular_buffer<T> c) {
+	return length(c.buf_vector);
+}
+
+/**
+ *  The same ring as a regular circular_buffer over the first mapping,
+ *  for code that expects vector_pair windows.
+ */
+template <typename T>
+inline
+circular_buffer<T> to_circular_buffer(mirrored_circular_buffer<T> c) {
+	circular_buffer<T> result;
+
+	result.buf_vector = c.buf_vector;
+	result.tail = c.tail;
+
+	return result;
+}
+
+/**
+ *  Rotates the circular buffer to the left, see rotate_left in
+ *  circular_buffer.h.
+ */
+template <typename T>
+inline
+mirrored_circular_buffer<T> rotate_left(mirrored_circular_buffer<T> c, index_type count) {
+	index_type size = length(c);
+
+	index_type new_tail = c.tail + count;
+	if(new_tail >= size)
+		new_tail -= size;
+
+	c.tail = new_tail;
+	return c;
+}
+
+/**
+ *  Rotates the circular buffer to the right, see rotate_right in
+ *  circular_buffer.h.
+ */
+template <typename T>
+inline
+mirrored_circular_buffer<T> rotate_right(mirrored_circular_buffer<T> c, index_type count) {
+	index_type size = length(c);
+
+	index_type new_tail = c.tail - count;
+	if(new_tail < 0)
+		new_tail += size;
+
+	c.tail = new_tail;
+	return c;
+}
+
+namespace detail {
+	template <typename T>
+	inline
+	vector<T> mirrored_window(mirrored_circular_buffer<T> c, index_type start, index_type count) {
+		vector<T> result;
+
+		result.array = c.buf_vector.array + start;
+		result.count = count;
+		result.stride = 1;
+
+		return result;
+	}
+}
+
+template <typename T>
+inline
+vector<T> write(mirrored_circular_buffer<T> c, index_type count) {
+	index_type size = length(c);
+	assert(count >= 0);
+	assert(count <= size);
+
+	return detail::mirrored_window(c, c.tail, count);
+}
+
+template <typename T>
+inline
+vector<T> read(mirrored_circular_buffer<T> c, index_type count, index_type offset) {
+	index_type size = length(c);
+	assert(count >= 0);
+	assert(offset >= 0);
+	assert(count + offset <= size);
+
+	index_type read_tail = c.tail - (count + offset);
+	if(read_tail < 0)
+		read_tail += size;
+
+	return detail::mirrored_window(c, read_tail, count);
+}
+
+template <typename T>
+inline
+vector<T> read(mirrored_circular_buffer<T> c, index_type count) {
+	return read(c, count, 0);
+}
+}
+
+// LIBAXL_MIRRORED_CIRCULAR_BUFFER_GUARD
+#endif
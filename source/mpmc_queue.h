@@ -0,0 +1,362 @@
+
+#ifndef LIBAXL_MPMC_QUEUE_GUARD
+#define LIBAXL_MPMC_QUEUE_GUARD
+
+#include <atomic>
+#include <new>
+#include <thread>
+
+#include "util.h"
+#include "arena.h"
+#include "vectors.h"
+#include "circular_buffer.h"
+#include "spsc_ring_buffer.h"
+
+#if defined(_WIN32)
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#pragma comment(lib, "Synchronization.lib")
+#elif defined(__linux__)
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define LIBAXL_SPIN_PAUSE() _mm_pause()
+#elif defined(__x86_64__) || defined(__i386__)
+#define LIBAXL_SPIN_PAUSE() __builtin_ia32_pause()
+#else
+#define LIBAXL_SPIN_PAUSE() ((void)0)
+#endif
+
+namespace libaxl {
+
+/**
+ *  A slot of the queue. sequence tells which position the slot is
+ *  ready for: position when it is free for the producer of that
+ *  position, position + 1 when it holds the value of that position.
+ */
+template <typename T>
+struct mpmc_slot {
+	std::atomic<size_type> sequence;
+	T value;
+};
+
+/**
+ *  Bounded multi-producer/multi-consumer queue (Vyukov style).
+ *
+ *  Producers and consumers claim positions with a CAS on
+ *  enqueue_position/dequeue_position; the per-slot sequence numbers
+ *  tell whether the claimed slot has been released by the other side,
+ *  so there is no lock and no shared count of the contents. Batch
+ *  operations claim several consecutive positions with one CAS.
+ *
+ *  Intended for handing out work items such as vector<T> chunks; T
+ *  is copied in and out of the slots.
+ *
+ *  The blocking variants spin for a while and then sleep on a futex
+ *  (WaitOnAddress on Windows) keyed on epoch, which is advanced after
+ *  each successful operation while there are sleeping threads.
+ */
+template <typename T>
+struct mpmc_queue {
+	alignas(detail::cache_line_size) std::atomic<size_type> enqueue_position;
+	alignas(detail::cache_line_size) std::atomic<size_type> dequeue_position;
+
+	alignas(detail::cache_line_size) std::atomic<uint32_t> epoch;
+	std::atomic<uint32_t> waiters;
+
+	alignas(detail::cache_line_size) mpmc_slot<T>* slots;
+	index_type count;
+};
+
+/**
+ *  Allocates a queue with room for count items, and the queue state
+ *  itself, from arena.
+ *
+ *  A queue of one slot is made with two: with a single slot, the
+ *  sequence a producer leaves behind (position + 1) is also the one
+ *  the next producer waits for, and it would overwrite the unread
+ *  item. Use length() for the actual size.
+ *
+ *  Preconditions:
+ *  (1) count >= 1
+ */
+template <typename T>
+inline
+mpmc_queue<T>* make_mpmc_queue(arena* arena, index_type count) {
+	assert(arena != nullptr);
+	assert(count >= 1);
+
+	count = maximum(count, (index_type)2);
+
+	auto memory = arena->alloc(sizeof(mpmc_queue<T>), detail::cache_line_size);
+	auto result = new (memory) mpmc_queue<T>();
+
+	auto slot_memory = arena->alloc((size_type)count * sizeof(mpmc_slot<T>), detail::cache_line_size);
+	result->slots = (mpmc_slot<T>*)slot_memory;
+	result->count = count;
+
+	for(index_type i = 0; i < count; ++i) {
+		auto slot = new (&result->slots[i]) mpmc_slot<T>();
+		slot->sequence.store((size_type)i, std::memory_order_relaxed);
+	}
+
+	result->enqueue_position.store(0, std::memory_order_relaxed);
+	result->dequeue_position.store(0, std::memory_order_relaxed);
+	result->epoch.store(0, std::memory_order_relaxed);
+	result->waiters.store(0, std::memory_order_relaxed);
+
+	return result;
+}
+
+template <typename T>
+inline
+index_type length(const mpmc_queue<T>& q) {
+	return q.count;
+}
+
+namespace detail {
+	//Failed attempts of a blocking operation before it goes to sleep
+	const int mpmc_spin_count = 256;
+
+	inline
+	void futex_wait(std::atomic<uint32_t>* address, uint32_t expected) {
+#if defined(_WIN32)
+		WaitOnAddress((volatile VOID*)address, &expected, sizeof(expected), INFINITE);
+#elif defined(__linux__)
+		syscall(SYS_futex, (uint32_t*)address, FUTEX_WAIT_PRIVATE, expected, nullptr, nullptr, 0);
+#else
+		if(address->load(std::memory_order_relaxed) == expected)
+			std::this_thread::yield();
+#endif
+	}
+
+	inline
+	void futex_wake_all(std::atomic<uint32_t>* address) {
+#if defined(_WIN32)
+		WakeByAddressAll((PVOID)address);
+#elif defined(__linux__)
+		syscall(SYS_futex, (uint32_t*)address, FUTEX_WAKE_PRIVATE, 0x7fffffff, nullptr, nullptr, 0);
+#else
+		(void)address;
+#endif
+	}
+
+	/**
+	 *  Wakes the sleepers after a slot was handed over.
+	 *
+	 *  The slot handover is a release store and would be allowed to
+	 *  move after the waiters load: the notifier could read 0 waiters
+	 *  while a waiter that just registered still sees the old slot,
+	 *  and that waiter would sleep forever. The fence here pairs with
+	 *  the one in mpmc_wait after the registration, so at least one
+	 *  side sees the other.
+	 */
+	template <typename T>
+	inline
+	void mpmc_notify(mpmc_queue<T>& q) {
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+
+		if(q.waiters.load(std::memory_order_seq_cst) != 0) {
+			q.epoch.fetch_add(1, std::memory_order_seq_cst);
+			futex_wake_all(&q.epoch);
+		}
+	}
+
+	/**
+	 *  Claims up to max_count consecutive positions whose slots have
+	 *  sequence == position + ready_offset, with a single CAS on
+	 *  position_counter. Returns the number of positions claimed,
+	 *  the first one in *first_position.
+	 */
+	template <typename T>
+	inline
+	index_type mpmc_claim(mpmc_queue<T>& q, std::atomic<size_type>& position_counter,
+		size_type ready_offset, index_type max_count, size_type* first_position)
+	{
+		size_type position = position_counter.load(std::memory_order_relaxed);
+
+		for(;;) {
+			index_type claimable = 0;
+			while(claimable < max_count) {
+				size_type slot_position = position + (size_type)claimable;
+				auto& slot = q.slots[ring_index(slot_position, q.count)];
+				size_type sequence = slot.sequence.load(std::memory_order_acquire);
+
+				if(sequence != slot_position + ready_offset)
+					break;
+				++claimable;
+			}
+
+			if(claimable == 0) {
+				auto& slot = q.slots[ring_index(position, q.count)];
+				size_type sequence = slot.sequence.load(std::memory_order_acquire);
+				auto difference = (std::ptrdiff_t)(sequence - (position + ready_offset));
+
+				//The slot has not been released by the other side yet: full/empty
+				if(difference < 0)
+					return 0;
+
+				//Another thread claimed the position, catch up
+				position = position_counter.load(std::memory_order_relaxed);
+				continue;
+			}
+
+			if(position_counter.compare_exchange_weak(position, position + (size_type)claimable,
+				std::memory_order_relaxed))
+			{
+				*first_position = position;
+				return claimable;
+			}
+		}
+	}
+}
+
+//
+//  Non-blocking operations
+//
+
+/**
+ *  Enqueues the leading items of items, as many as there is room for.
+ *  Returns the number of items enqueued.
+ */
+template <typename T>
+inline
+index_type enqueue(mpmc_queue<T>& q, vector<T> items) {
+	size_type position;
+	index_type claimed = detail::mpmc_claim(q, q.enqueue_position, 0, length(items), &position);
+
+	for(index_type i = 0; i < claimed; ++i) {
+		auto& slot = q.slots[ring_index(position + (size_type)i, q.count)];
+		slot.value = items[i];
+		slot.sequence.store(position + (size_type)i + 1, std::memory_order_release);
+	}
+
+	if(claimed > 0)
+		detail::mpmc_notify(q);
+
+	return claimed;
+}
+
+template <typename T>
+inline
+bool enqueue(mpmc_queue<T>& q, T item) {
+	vector<T> items;
+
+	items.array = &item;
+	items.count = 1;
+	items.stride = 1;
+
+	return enqueue(q, items) == 1;
+}
+
+/**
+ *  Dequeues up to length(out) items into out.
+ *  Returns the number of items dequeued.
+ */
+template <typename T>
+inline
+index_type dequeue(mpmc_queue<T>& q, vector<T> out) {
+	size_type position;
+	index_type claimed = detail::mpmc_claim(q, q.dequeue_position, 1, length(out), &position);
+
+	for(index_type i = 0; i < claimed; ++i) {
+		auto& slot = q.slots[ring_index(position + (size_type)i, q.count)];
+		out[i] = slot.value;
+		slot.sequence.store(position + (size_type)i + (size_type)q.count, std::memory_order_release);
+	}
+
+	if(claimed > 0)
+		detail::mpmc_notify(q);
+
+	return claimed;
+}
+
+template <typename T>
+inline
+bool dequeue(mpmc_queue<T>& q, T* item) {
+	vector<T> out;
+
+	assert(item != nullptr);
+
+	out.array = item;
+	out.count = 1;
+	out.stride = 1;
+
+	return dequeue(q, out) == 1;
+}
+
+//
+//  Blocking operations
+//
+
+namespace detail {
+	template <typename T, typename Op>
+	inline
+	index_type mpmc_wait(mpmc_queue<T>& q, Op op) {
+		for(int spin = 0; spin < mpmc_spin_count; ++spin) {
+			index_type result = op();
+			if(result > 0)
+				return result;
+			LIBAXL_SPIN_PAUSE();
+		}
+
+		q.waiters.fetch_add(1, std::memory_order_seq_cst);
+		//Pairs with the fence in mpmc_notify, see there
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+
+		index_type result;
+		for(;;) {
+			uint32_t epoch = q.epoch.load(std::memory_order_seq_cst);
+
+			result = op();
+			if(result > 0)
+				break;
+
+			futex_wait(&q.epoch, epoch);
+		}
+
+		q.waiters.fetch_sub(1, std::memory_order_seq_cst);
+
+		return result;
+	}
+}
+
+/**
+ *  Enqueues at least one of items, waiting for room if the queue is
+ *  full. Returns the number of items enqueued.
+ *
+ *  Preconditions:
+ *  (1) length(items) >= 1
+ */
+template <typename T>
+inline
+index_type enqueue_wait(mpmc_queue<T>& q, vector<T> items) {
+	assert(length(items) >= 1);
+
+	return detail::mpmc_wait(q, [&q, items]() -> index_type { return enqueue(q, items); });
+}
+
+/**
+ *  Dequeues at least one item into out, waiting for one if the queue
+ *  is empty. Returns the number of items dequeued.
+ *
+ *  Preconditions:
+ *  (1) length(out) >= 1
+ */
+template <typename T>
+inline
+index_type dequeue_wait(mpmc_queue<T>& q, vector<T> out) {
+	assert(length(out) >= 1);
+
+	return detail::mpmc_wait(q, [&q, out]() -> index_type { return dequeue(q, out); });
+}
+}
+
+// LIBAXL_MPMC_QUEUE_GUARD
+#endif
@@ -0,0 +1,280 @@
+
+#ifndef LIBAXL_RESAMPLER_GUARD
+#define LIBAXL_RESAMPLER_GUARD
+
+#include <cmath>
+
+#include "util.h"
+#include "arena.h"
+#include "vectors.h"
+#include "vector_pair.h"
+
+namespace libaxl {
+
+/**
+ *  resample_linear:    2 point linear interpolation, delay 1 input sample
+ *  resample_cubic:     4 point Catmull-Rom interpolation, delay 2 samples
+ *  resample_polyphase: windowed sinc L/M polyphase FIR, band limited,
+ *                      delay (taps_per_phase - 1) / 2 samples
+ */
+enum resample_mode {
+	resample_linear,
+	resample_cubic,
+	resample_polyphase
+};
+
+namespace detail {
+	//Input samples staged per pass
+	const index_type resample_tile = 4096;
+	//Polyphase cutoff as a fraction of the lower Nyquist frequency
+	const f64 resample_rolloff = 0.9;
+	const f64 resample_pi = 3.14159265358979323846;
+
+	inline
+	index_type greatest_common_divisor(index_type a, index_type b) {
+		while(b != 0) {
+			index_type t = a % b;
+			a = b;
+			b = t;
+		}
+		return a;
+	}
+}
+
+/**
+ *  Streaming sample rate conversion by up / down, a generalization of
+ *  linear_blend to arbitrary ratios.
+ *
+ *  Every mode is a table of up phases with taps_per_phase weights each:
+ *  output j is at input time j * down / up, and is the dot product of
+ *  the weights of its phase with the taps_per_phase inputs ending at
+ *  that time. The table is stored with the weights of each phase
+ *  reversed, so the inner loop is a contiguous dot product.
+ *
+ *  Input blocks are staged into work behind the last
+ *  taps_per_phase - 1 samples of the stream, so blocks of any size and
+ *  the segments of a circular_buffer window continue one stream.
+ */
+template <typename T>
+struct resampler {
+	index_type up;
+	index_type down;
+	resample_mode mode;
+	index_type taps_per_phase;
+	vector<T> coefficients;
+
+	//Time of the next output relative to the next input, in 1 / up samples
+	index_type position;
+	vector<T> work;
+};
+
+namespace detail {
+	/**
+	 *  Weights of one phase, weights[k] applies to x[n - k].
+	 */
+	inline
+	void resample_phase_weights(resample_mode mode, index_type taps_per_phase,
+		index_type up, index_type down, index_type phase, f64* weights)
+	{
+		f64 f = (f64)phase / (f64)up;
+
+		if(mode == resample_linear) {
+			weights[0] = f;
+			weights[1] = 1.0 - f;
+			return;
+		}
+
+		if(mode == resample_cubic) {
+			f64 f2 = f * f;
+			f64 f3 = f2 * f;
+			weights[0] = 0.5 * (f3 - f2);
+			weights[1] = 0.5 * (-3.0 * f3 + 4.0 * f2 + f);
+			weights[2] = 0.5 * (3.0 * f3 - 5.0 * f2 + 2.0);
+			weights[3] = 0.5 * (-f3 + 2.0 * f2 - f);
+			return;
+		}
+
+		//Tap k of the phase is tap k * up + phase of the prototype, a
+		//Blackman windowed sinc at the upsampled rate
+		index_type length = taps_per_phase * up;
+		f64 center = 0.5 * (f64)(length - 1);
+		f64 cutoff = resample_rolloff * 0.5 / (f64)maximum(up, down);
+		f64 sum = 0.0;
+
+		for(index_type k = 0; k < taps_per_phase; ++k) {
+			index_type m = k * up + phase;
+			f64 x = 2.0 * cutoff * ((f64)m - center);
+			f64 sinc = (x == 0.0) ? 1.0 : std::sin(resample_pi * x) / (resample_pi * x);
+			f64 window = 0.42 - 0.5 * std::cos(2.0 * resample_pi * ((f64)m + 0.5) / (f64)length)
+				+ 0.08 * std::cos(4.0 * resample_pi * ((f64)m + 0.5) / (f64)length);
+
+			weights[k] = sinc * window;
+			sum += weights[k];
+		}
+
+		//Unit gain at DC for every phase
+		for(index_type k = 0; k < taps_per_phase; ++k)
+			weights[k] /= sum;
+	}
+}
+
+/**
+ *  Creates a resampler producing up output samples per down input
+ *  samples. taps_per_phase only applies to resample_polyphase, the
+ *  interpolating modes use 2 and 4.
+ *
+ *  Preconditions:
+ *  (1) up >= 1, down >= 1
+ *  (2) taps_per_phase >= 1
+ */
+template <typename T>
+inline
+resampler<T> make_resampler(arena* arena, index_type up, index_type down, resample_mode mode,
+	index_type taps_per_phase = 24)
+{
+	resampler<T> result;
+
+	assert(arena != nullptr);
+	assert(up >= 1 && down >= 1);
+	assert(taps_per_phase >= 1);
+
+	index_type divisor = detail::greatest_common_divisor(up, down);
+	up /= divisor;
+	down /= divisor;
+
+	if(mode == resample_linear)
+		taps_per_phase = 2;
+	else if(mode == resample_cubic)
+		taps_per_phase = 4;
+
+	result.up = up;
+	result.down = down;
+	result.mode = mode;
+	result.taps_per_phase = taps_per_phase;
+	result.position = 0;
+
+	result.coefficients = make_uninitialized_vector<T>(arena, up * taps_per_phase);
+	f64* weights = allocate<f64>(arena, taps_per_phase);
+
+	for(index_type phase = 0; phase < up; ++phase) {
+		detail::resample_phase_weights(mode, taps_per_phase, up, down, phase, weights);
+
+		T* table = result.coefficients.array + phase * taps_per_phase;
+		for(index_type k = 0; k < taps_per_phase; ++k)
+			table[taps_per_phase - 1 - k] = (T)weights[k];
+	}
+
+	result.work = zeros<T>(arena, taps_per_phase - 1 + detail::resample_tile);
+
+	return result;
+}
+
+/**
+ *  The most output samples process can produce from count inputs.
+ */
+template <typename T>
+inline
+index_type output_length(const resampler<T>& r, index_type count) {
+	return (index_type)(((int64_t)count * r.up + r.down - 1) / r.down);
+}
+
+/**
+ *  Forgets the stream (as if all past input was zero).
+ */
+template <typename T>
+inline
+void reset(resampler<T>& r) {
+	r.position = 0;
+	memset(r.work.array, 0, length(r.work) * sizeof(T));
+}
+
+namespace detail {
+	/**
+	 *  Resamples one staged tile of count inputs into out, returns the
+	 *  number of outputs written.
+	 */
+	template <typename T>
+	inline
+	index_type resample_tile_pass(resampler<T>& r, index_type count, T* out) {
+		index_type taps = r.taps_per_phase;
+		index_type up = r.up;
+		index_type down = r.down;
+		index_type limit = count * up;
+		const T* table = r.coefficients.array;
+		const T* x = r.work.array;
+
+		index_type position = r.position;
+		index_type produced = 0;
+
+		//The window of an output at input n starts at work[n]
+		for(; position < limit; position += down) {
+			index_type n = position / up;
+			index_type phase = position - n * up;
+			out[produced++] = dot_contiguous(table + phase * taps, x + n, taps);
+		}
+
+		r.position = position - limit;
+
+		//Keep the last taps - 1 samples in front of the next tile
+		memmove(r.work.array, r.work.array + count, (taps - 1) * sizeof(T));
+
+		return produced;
+	}
+
+	template <typename T>
+	inline
+	index_type resample_block(resampler<T>& r, vector<T> in, T* out) {
+		index_type produced = 0;
+		index_type taps = r.taps_per_phase;
+
+		while(!is_empty(in)) {
+			vector<T> tile = take_at_most(in, resample_tile);
+			index_type count = length(tile);
+
+			vector<T> staged = drop(r.work, taps - 1);
+			staged.count = count;
+			copy_to(tile, staged);
+
+			produced += resample_tile_pass(r, count, out + produced);
+			in = drop(in, count);
+		}
+
+		return produced;
+	}
+}
+
+/**
+ *  Resamples the next block of the stream into out.
+ *  Returns the number of outputs written, at most
+ *  output_length(r, length(in)).
+ *
+ *  Preconditions:
+ *  (1) out is contiguous (stride 1)
+ *  (2) length(out) >= output_length(r, length(in))
+ */
+template <typename T>
+inline
+index_type process(resampler<T>& r, vector<T> in, vector<T> out) {
+	assert(out.stride == 1);
+	assert(length(out) >= output_length(r, length(in)));
+
+	return detail::resample_block(r, in, out.array);
+}
+
+/**
+ *  Resamples a circular_buffer window, e.g. read(cb, count), segment by
+ *  segment. Same preconditions as above.
+ */
+template <typename T>
+inline
+index_type process(resampler<T>& r, vector_pair<T> in, vector<T> out) {
+	assert(out.stride == 1);
+	assert(length(out) >= output_length(r, length(in)));
+
+	index_type produced = detail::resample_block(r, first(in), out.array);
+	return produced + detail::resample_block(r, second(in), out.array + produced);
+}
+}
+
+// LIBAXL_RESAMPLER_GUARD
+#endif
@@ -0,0 +1,411 @@
+
+#ifndef LIBAXL_SLIDING_WINDOW_STATS_GUARD
+#define LIBAXL_SLIDING_WINDOW_STATS_GUARD
+
+#include "util.h"
+#include "arena.h"
+#include "vectors.h"
+#include "vector_pair.h"
+#include "circular_buffer.h"
+
+namespace libaxl {
+
+/**
+ *  Running statistics over the last window samples of a stream.
+ *
+ *  Every update is O(1) amortized:
+ *  - mean and variance come from running sums of (x - shift) and
+ *    (x - shift)^2 with compensated (Neumaier) summation. Once per
+ *    window samples the sums are rebased: shift is moved to the
+ *    current mean and the sums are recomputed from the history, which
+ *    bounds the accumulated rounding error and the cancellation in
+ *    the variance.
+ *  - min and max come from monotonic deques of sample sequence
+ *    numbers, whose values are looked up in the history.
+ *  - the exponential average covers every sample pushed, not only
+ *    the window.
+ *
+ *  The history is a circular_buffer whose tail is the slot of the
+ *  next sample, sample number s lives in slot ring_index(s, window).
+ */
+template <typename T>
+struct sliding_window_stats {
+	circular_buffer<T> history;
+	index_type filled;
+	size_type sequence;
+
+	f64 shift;
+	f64 sum;
+	f64 sum_compensation;
+	f64 sum_squares;
+	f64 sum_squares_compensation;
+	index_type since_rebase;
+
+	f64 ema_alpha;
+	f64 ema_value;
+
+	//Monotonic deques, rings of window sequence numbers
+	size_type* max_queue;
+	index_type max_front;
+	index_type max_count;
+	size_type* min_queue;
+	index_type min_front;
+	index_type min_count;
+};
+
+/**
+ *  Preconditions:
+ *  (1) window >= 1
+ *  (2) 0 < ema_alpha <= 1
+ */
+template <typename T>
+inline
+sliding_window_stats<T> make_sliding_window_stats(arena* arena, index_type window, f64 ema_alpha) {
+	sliding_window_stats<T> result;
+
+	assert(arena != nullptr);
+	assert(window >= 1);
+	assert(ema_alpha > 0.0 && ema_alpha <= 1.0);
+
+	result.history = make_circular_buffer<T>(arena, window);
+	result.filled = 0;
+	result.sequence = 0;
+
+	result.shift = 0.0;
+	result.sum = 0.0;
+	result.sum_compensation = 0.0;
+	result.sum_squares = 0.0;
+	result.sum_squares_compensation = 0.0;
+	result.since_rebase = 0;
+
+	result.ema_alpha = ema_alpha;
+	result.ema_value = 0.0;
+
+	result.max_queue = allocate<size_type>(arena, window);
+	result.max_front = 0;
+	result.max_count = 0;
+	result.min_queue = allocate<size_type>(arena, window);
+	result.min_front = 0;
+	result.min_count = 0;
+
+	return result;
+}
+
+/**
+ *  The number of samples currently in the window.
+ */
+template <typename T>
+inline
+index_type length(const sliding_window_stats<T>& s) {
+	return s.filled;
+}
+
+template <typename T>
+inline
+index_type window_size(const sliding_window_stats<T>& s) {
+	return length(s.history);
+}
+
+namespace detail {
+	//Neumaier's variant of Kahan summation
+	inline
+	void compensated_add(f64& sum, f64& compensation, f64 value) {
+		f64 t = sum + value;
+
+		if((sum >= 0.0 ? sum : -sum) >= (value >= 0.0 ? value : -value))
+			compensation += (sum - t) + value;
+		else
+			compensation += (value - t) + sum;
+
+		sum = t;
+	}
+
+	/**
+	 *  Adds sign * sum(v - shift) and sign * sum((v - shift)^2) to the
+	 *  running sums. The block sums are formed without compensation and
+	 *  then folded into the compensated totals. The contiguous loop keeps
+	 *  four independent partial sums, a single f64 accumulator is a
+	 *  serial chain of adds that is not reordered without -ffast-math.
+	 */
+	template <typename T>
+	inline
+	void window_accumulate(sliding_window_stats<T>& s, vector<T> v, f64 sign) {
+		f64 shift = s.shift;
+		f64 block_sum = 0.0;
+		f64 block_squares = 0.0;
+
+		auto len = length(v);
+		auto array = v.array;
+		auto stride = v.stride;
+
+		if(stride == 1) {
+			f64 s0 = 0.0, s1 = 0.0, s2 = 0.0, s3 = 0.0;
+			f64 q0 = 0.0, q1 = 0.0, q2 = 0.0, q3 = 0.0;
+			index_type i = 0;
+
+			for(; i + 4 <= len; i += 4) {
+				f64 d0 = (f64)array[i] - shift;
+				f64 d1 = (f64)array[i + 1] - shift;
+				f64 d2 = (f64)array[i + 2] - shift;
+				f64 d3 = (f64)array[i + 3] - shift;
+				s0 += d0;
+				s1 += d1;
+				s2 += d2;
+				s3 += d3;
+				q0 += d0 * d0;
+				q1 += d1 * d1;
+				q2 += d2 * d2;
+				q3 += d3 * d3;
+			}
+			for(; i < len; ++i) {
+				f64 d = (f64)array[i] - shift;
+				s0 += d;
+				q0 += d * d;
+			}
+
+			block_sum = (s0 + s1) + (s2 + s3);
+			block_squares = (q0 + q1) + (q2 + q3);
+		} else {
+			for(index_type i = 0; i < len; ++i) {
+				f64 d = (f64)array[i * stride] - shift;
+				block_sum += d;
+				block_squares += d * d;
+			}
+		}
+
+		compensated_add(s.sum, s.sum_compensation, sign * block_sum);
+		compensated_add(s.sum_squares, s.sum_squares_compensation, sign * block_squares);
+	}
+
+	template <typename T>
+	inline
+	T window_value(const sliding_window_stats<T>& s, size_type sequence) {
+		auto& buf = s.history.buf_vector;
+		return buf.array[ring_index(sequence, buf.count) * buf.stride];
+	}
+
+	/**
+	 *  The sample with the given sequence number while block, starting
+	 *  at sequence number s.sequence, is being pushed.
+	 */
+	template <typename T>
+	inline
+	T window_sample(const sliding_window_stats<T>& s, vector<T> block, size_type sequence) {
+		if(sequence >= s.sequence)
+			return block[(index_type)(sequence - s.sequence)];
+		return window_value(s, sequence);
+	}
+
+	/**
+	 *  Pushes the sequence number of x onto a monotonic deque, first
+	 *  dropping the front entries that leave the window with x and the
+	 *  back entries that can no longer be the extremum (keep_back(back, x)
+	 *  is false for them).
+	 *
+	 *  The expired entries go first: the deque has window slots, and with
+	 *  a monotonic input all window entries are still queued when x comes.
+	 */
+	template <typename T, typename KeepBack>
+	inline
+	void monotonic_push(const sliding_window_stats<T>& s, vector<T> block,
+		size_type* queue, index_type& front, index_type& count,
+		size_type sequence, T x, KeepBack keep_back)
+	{
+		index_type window = length(s.history);
+
+		while(count > 0 && queue[front] + (size_type)window <= sequence) {
+			front = ring_index((size_type)front + 1, window);
+			--count;
+		}
+
+		while(count > 0) {
+			size_type back = queue[ring_index((size_type)(front + count - 1), window)];
+			if(keep_back(window_sample(s, block, back), x))
+				break;
+			--count;
+		}
+
+		queue[ring_index((size_type)(front + count), window)] = sequence;
+		++count;
+	}
+
+	template <typename T>
+	inline
+	void window_rebase(sliding_window_stats<T>& s) {
+		f64 mean_value = (s.filled > 0) ? s.shift + (s.sum + s.sum_compensation) / s.filled : 0.0;
+
+		s.shift = mean_value;
+		s.sum = 0.0;
+		s.sum_compensation = 0.0;
+		s.sum_squares = 0.0;
+		s.sum_squares_compensation = 0.0;
+		s.since_rebase = 0;
+
+		vector_pair<T> contents = read(s.history, s.filled);
+		window_accumulate(s, first(contents), 1.0);
+		window_accumulate(s, second(contents), 1.0);
+	}
+
+	/**
+	 *  Preconditions:
+	 *  (1) length(block) <= window_size(s)
+	 */
+	template <typename T>
+	inline
+	void window_push_block(sliding_window_stats<T>& s, vector<T> block) {
+		index_type window = length(s.history);
+		index_type count = length(block);
+
+		assert(count <= window);
+
+		//Center the sums on the data from the start
+		if(s.sequence == 0 && count > 0)
+			s.shift = (f64)block[0];
+
+		//The slots about to be overwritten, the first window - filled
+		//of them have never held a sample
+		vector_pair<T> slots = write(s.history, count);
+		index_type evicted = s.filled + count - window;
+		if(evicted > 0) {
+			vector_pair<T> old = drop(slots, count - evicted);
+			window_accumulate(s, first(old), -1.0);
+			window_accumulate(s, second(old), -1.0);
+		}
+
+		window_accumulate(s, block, 1.0);
+
+		//Deques and average first, the history still holds the samples
+		//the deque entries refer to
+		f64 alpha = s.ema_alpha;
+		f64 ema_value = s.ema_value;
+
+		for(index_type i = 0; i < count; ++i) {
+			T x = block[i];
+			size_type sequence = s.sequence + (size_type)i;
+
+			ema_value = (sequence == 0) ? (f64)x : ema_value + alpha * ((f64)x - ema_value);
+
+			monotonic_push(s, block, s.max_queue, s.max_front, s.max_count, sequence, x,
+				[](T back, T value) -> bool { return back > value; });
+			monotonic_push(s, block, s.min_queue, s.min_front, s.min_count, sequence, x,
+				[](T back, T value) -> bool { return back < value; });
+		}
+
+		s.ema_value = ema_value;
+
+		copy_to(block, first(slots));
+		copy_to(drop(block, length(first(slots))), second(slots));
+		s.history = rotate_left(s.history, count);
+		s.filled = minimum(window, s.filled + count);
+		s.sequence += (size_type)count;
+
+		s.since_rebase += count;
+		if(s.since_rebase >= window)
+			window_rebase(s);
+	}
+}
+
+//
+//  Updates
+//
+
+/**
+ *  Appends a block of samples. The running sums of the block are
+ *  formed in bulk, one window sized piece at a time.
+ */
+template <typename T>
+inline
+void push(sliding_window_stats<T>& s, vector<T> block) {
+	index_type window = length(s.history);
+
+	while(!is_empty(block)) {
+		auto piece = take_at_most(block, window);
+		detail::window_push_block(s, piece);
+		block = drop(block, length(piece));
+	}
+}
+
+template <typename T>
+inline
+void push(sliding_window_stats<T>& s, T x) {
+	vector<T> block;
+
+	block.array = &x;
+	block.count = 1;
+	block.stride = 1;
+
+	detail::window_push_block(s, block);
+}
+
+//
+//  Queries
+//
+
+/**
+ *  Preconditions:
+ *  (1) length(s) >= 1
+ */
+template <typename T>
+inline
+f64 mean(const sliding_window_stats<T>& s) {
+	assert(s.filled >= 1);
+
+	return s.shift + (s.sum + s.sum_compensation) / s.filled;
+}
+
+/**
+ *  The population variance of the samples in the window.
+ *
+ *  Preconditions:
+ *  (1) length(s) >= 1
+ */
+template <typename T>
+inline
+f64 variance(const sliding_window_stats<T>& s) {
+	assert(s.filled >= 1);
+
+	f64 n = (f64)s.filled;
+	f64 sum = s.sum + s.sum_compensation;
+	f64 sum_squares = s.sum_squares + s.sum_squares_compensation;
+	f64 result = (sum_squares - sum * sum / n) / n;
+
+	return result > 0.0 ? result : 0.0;
+}
+
+/**
+ *  Preconditions:
+ *  (1) length(s) >= 1
+ */
+template <typename T>
+inline
+T window_max(const sliding_window_stats<T>& s) {
+	assert(s.max_count >= 1);
+
+	return detail::window_value(s, s.max_queue[s.max_front]);
+}
+
+/**
+ *  Preconditions:
+ *  (1) length(s) >= 1
+ */
+template <typename T>
+inline
+T window_min(const sliding_window_stats<T>& s) {
+	assert(s.min_count >= 1);
+
+	return detail::window_value(s, s.min_queue[s.min_front]);
+}
+
+/**
+ *  The exponential moving average of all samples pushed,
+ *  ema = ema + alpha * (x - ema), started at the first sample.
+ */
+template <typename T>
+inline
+f64 ema(const sliding_window_stats<T>& s) {
+	return s.ema_value;
+}
+}
+
+// LIBAXL_SLIDING_WINDOW_STATS_GUARD
+#endif
@@ -0,0 +1,597 @@
+
+#ifndef LIBAXL_SORT_GUARD
+#define LIBAXL_SORT_GUARD
+
+#include <cstring>
+#include <new>
+#include <thread>
+#include <utility>
+
+#include "util.h"
+#include "arena.h"
+#include "vectors.h"
+#include "gather.h"
+#include "bit_vector.h"
+
+#if defined(__AVX512F__)
+#include <immintrin.h>
+#endif
+
+namespace libaxl {
+
+/**
+ *  Sorting and selection for numeric vectors.
+ *
+ *  sort is an LSD radix sort on 11 bit digits. Keys are mapped to
+ *  unsigned integers that order the same way: the sign bit of signed
+ *  integers is flipped, and floats have the sign bit flipped when
+ *  positive and all bits flipped when negative. -0.0 sorts before 0.0.
+ *  NaNs sort by their bit pattern, so positive NaNs come after +inf and
+ *  negative NaNs come before -inf. Passes where all keys share a digit
+ *  are skipped.
+ *
+ *  With thread_count > 1, the threads take equal parts of the input.
+ *  Each builds the histogram of its part, and then scatters that part
+ *  to the offsets computed from all the histograms. The sort is stable
+ *  either way.
+ *
+ *  partition and nth_element compare against a pivot and compress each
+ *  side with VPCOMPRESS under AVX-512.
+ */
+
+namespace detail {
+	/**
+	 *  key: an unsigned integer with the same order as T
+	 */
+	template <typename T>
+	struct radix_key;
+
+	template <>
+	struct radix_key<uint32_t> {
+		using type = uint32_t;
+		static type get(uint32_t v) { return v; }
+	};
+
+	template <>
+	struct radix_key<int32_t> {
+		using type = uint32_t;
+		static type get(int32_t v) { return (uint32_t)v ^ 0x80000000U; }
+	};
+
+	template <>
+	struct radix_key<uint64_t> {
+		using type = uint64_t;
+		static type get(uint64_t v) { return v; }
+	};
+
+	template <>
+	struct radix_key<int64_t> {
+		using type = uint64_t;
+		static type get(int64_t v) { return (uint64_t)v ^ 0x8000000000000000ULL; }
+	};
+
+	template <>
+	struct radix_key<f32> {
+		using type = uint32_t;
+		static type get(f32 v) {
+			uint32_t bits;
+			std::memcpy(&bits, &v, sizeof(bits));
+			return bits ^ ((uint32_t)(-(int32_t)(bits >> 31)) | 0x80000000U);
+		}
+	};
+
+	template <>
+	struct radix_key<f64> {
+		using type = uint64_t;
+		static type get(f64 v) {
+			uint64_t bits;
+			std::memcpy(&bits, &v, sizeof(bits));
+			return bits ^ ((uint64_t)(-(int64_t)(bits >> 63)) | 0x8000000000000000ULL);
+		}
+	};
+
+	//3 passes for 32 bit keys, 6 for 64 bit keys
+	const int radix_bits = 11;
+	const index_type radix_buckets = 1 << radix_bits;
+	//Fewer elements than this per thread are sorted by fewer threads
+	const index_type radix_min_per_thread = 1 << 16;
+	//Ranges this short are finished by insertion sort in nth_element
+	const index_type select_small = 32;
+
+	/**
+	 *  Runs f(thread) for thread in [0, thread_count), the calling
+	 *  thread takes thread 0. Returns when all are done.
+	 */
+	template <typename F>
+	inline
+	void run_threads(arena* arena, int thread_count, F f) {
+		if(thread_count <= 1) {
+			f(0);
+			return;
+		}
+
+		std::thread* threads = allocate<std::thread>(arena, thread_count - 1);
+		for(int t = 1; t < thread_count; ++t)
+			new (&threads[t - 1]) std::thread(f, t);
+
+		f(0);
+
+		for(int t = 1; t < thread_count; ++t) {
+			threads[t - 1].join();
+			threads[t - 1].~thread();
+		}
+	}
+
+	/**
+	 *  counts[pass * radix_buckets + digit] for passes [first_pass, passes)
+	 *  of in[begin, end)
+	 */
+	template <typename T>
+	inline
+	void radix_histogram(const T* in, index_type begin, index_type end,
+		int first_pass, int passes, index_type* counts)
+	{
+		using key = radix_key<T>;
+
+		for(index_type d = first_pass * radix_buckets; d < passes * radix_buckets; ++d)
+			counts[d] = 0;
+
+		for(index_type i = begin; i < end; ++i) {
+			auto k = key::get(in[i]);
+			for(int pass = first_pass; pass < passes; ++pass)
+				++counts[pass * radix_buckets + ((k >> (pass * radix_bits)) & (radix_buckets - 1))];
+		}
+	}
+
+	/**
+	 *  Moves in[begin, end) (and payload_in alongside, if not nullptr)
+	 *  to the positions in offsets, which are advanced.
+	 */
+	template <typename T, typename P>
+	inline
+	void radix_scatter(const T* in, T* out, const P* payload_in, P* payload_out,
+		index_type begin, index_type end, int shift, index_type* offsets)
+	{
+		using key = radix_key<T>;
+
+		if(payload_in == nullptr) {
+			for(index_type i = begin; i < end; ++i) {
+				index_type d = (key::get(in[i]) >> shift) & (radix_buckets - 1);
+				out[offsets[d]++] = in[i];
+			}
+		} else {
+			for(index_type i = begin; i < end; ++i) {
+				index_type d = (key::get(in[i]) >> shift) & (radix_buckets - 1);
+				index_type to = offsets[d]++;
+				out[to] = in[i];
+				payload_out[to] = payload_in[i];
+			}
+		}
+	}
+
+	/**
+	 *  Sorts data[0, count) with payload (may be nullptr) moved alongside.
+	 *  scratch and payload_scratch hold count elements each.
+	 *
+	 *  The histograms of all passes are made in one read. Their totals
+	 *  tell which passes can be skipped, and with one thread they give
+	 *  the offsets of every pass. With more threads, the histogram of
+	 *  each part is made again before each later pass, because the
+	 *  scatter moves elements between the parts.
+	 */
+	template <typename T, typename P>
+	inline
+	void radix_sort(arena* arena, T* data, T* scratch, P* payload, P* payload_scratch,
+		index_type count, int thread_count)
+	{
+		const int passes = ((int)sizeof(typename radix_key<T>::type) * 8 + radix_bits - 1) / radix_bits;
+		const index_type stride = passes * radix_buckets;
+
+		thread_count = (int)maximum<index_type>(1, minimum<index_type>(thread_count, count / radix_min_per_thread));
+		index_type part = (count + thread_count - 1) / thread_count;
+
+		index_type* counts = allocate<index_type>(arena, thread_count * stride);
+
+		T* from = data;
+		T* to = scratch;
+		P* payload_from = payload;
+		P* payload_to = payload_scratch;
+
+		run_threads(arena, thread_count, [=](int t) {
+			index_type begin = minimum(count, t * part);
+			radix_histogram(from, begin, minimum(count, begin + part), 0, passes, counts + t * stride);
+		});
+
+		bool first = true;
+		for(int pass = 0; pass < passes; ++pass) {
+			index_type* pass_counts = counts + pass * radix_buckets;
+
+			bool single_digit = false;
+			for(index_type d = 0; d < radix_buckets && !single_digit; ++d) {
+				index_type total = 0;
+				for(int t = 0; t < thread_count; ++t)
+					total += pass_counts[t * stride + d];
+				single_digit = total == count;
+			}
+
+			if(single_digit)
+				continue;
+
+			if(!first && thread_count > 1) {
+				run_threads(arena, thread_count, [=](int t) {
+					index_type begin = minimum(count, t * part);
+					radix_histogram(from, begin, minimum(count, begin + part), pass, pass + 1, counts + t * stride);
+				});
+			}
+			first = false;
+
+			//Offsets by digit, then by thread within a digit
+			index_type offset = 0;
+			for(index_type d = 0; d < radix_buckets; ++d) {
+				for(int t = 0; t < thread_count; ++t) {
+					index_type n = pass_counts[t * stride + d];
+					pass_counts[t * stride + d] = offset;
+					offset += n;
+				}
+			}
+
+			int shift = pass * radix_bits;
+			run_threads(arena, thread_count, [=](int t) {
+				index_type begin = minimum(count, t * part);
+				radix_scatter(from, to, payload_from, payload_to,
+					begin, minimum(count, begin + part), shift, pass_counts + t * stride);
+			});
+
+			std::swap(from, to);
+			std::swap(payload_from, payload_to);
+		}
+
+		if(from != data) {
+			std::memcpy(data, from, (size_t)count * sizeof(T));
+			if(payload != nullptr)
+				std::memcpy(payload, payload_from, (size_t)count * sizeof(P));
+		}
+	}
+
+	/**
+	 *  Moves the elements of data[0, count) that are < pivot (<= pivot if
+	 *  inclusive) to the front of data and the others to high, both in
+	 *  order. Returns the number moved to the front.
+	 */
+	template <bool inclusive, typename T>
+	inline
+	index_type partition_kernel(T* data, index_type count, T pivot, T* high) {
+		index_type low = 0;
+		index_type high_count = 0;
+
+		for(index_type i = 0; i < count; ++i) {
+			T v = data[i];
+			if(inclusive ? v <= pivot : v < pivot)
+				data[low++] = v;
+			else
+				high[high_count++] = v;
+		}
+
+		return low;
+	}
+
+#if defined(__AVX512F__)
+	//Compare to a mask, then compress both sides with VPCOMPRESS and
+	//store them with masked stores. The front is written behind the
+	//reads, so the stores never overtake unread elements
+
+	template <typename T>
+	struct partition_lanes;
+
+	template <>
+	struct partition_lanes<f64> {
+		using reg = __m512d;
+		using mask = __mmask8;
+		static const index_type count = 8;
+
+		static reg load(const f64* p) { return _mm512_loadu_pd(p); }
+		static mask compare(reg v, f64 pivot, bool inclusive) {
+			return inclusive ? _mm512_cmp_pd_mask(v, _mm512_set1_pd(pivot), _CMP_LE_OQ)
+				: _mm512_cmp_pd_mask(v, _mm512_set1_pd(pivot), _CMP_LT_OQ);
+		}
+		static void store(f64* p, mask m, index_type n, reg v) {
+			_mm512_mask_storeu_pd(p, (mask)((1U << n) - 1), _mm512_maskz_compress_pd(m, v));
+		}
+	};
+
+	template <>
+	struct partition_lanes<f32> {
+		using reg = __m512;
+		using mask = __mmask16;
+		static const index_type count = 16;
+
+		static reg load(const f32* p) { return _mm512_loadu_ps(p); }
+		static mask compare(reg v, f32 pivot, bool inclusive) {
+			return inclusive ? _mm512_cmp_ps_mask(v, _mm512_set1_ps(pivot), _CMP_LE_OQ)
+				: _mm512_cmp_ps_mask(v, _mm512_set1_ps(pivot), _CMP_LT_OQ);
+		}
+		static void store(f32* p, mask m, index_type n, reg v) {
+			_mm512_mask_storeu_ps(p, (mask)((1U << n) - 1), _mm512_maskz_compress_ps(m, v));
+		}
+	};
+
+	template <>
+	struct partition_lanes<int64_t> {
+		using reg = __m512i;
+		using mask = __mmask8;
+		static const index_type count = 8;
+
+		static reg load(const int64_t* p) { return _mm512_loadu_si512((const void*)p); }
+		static mask compare(reg v, int64_t pivot, bool inclusive) {
+			return inclusive ? _mm512_cmple_epi64_mask(v, _mm512_set1_epi64(pivot))
+				: _mm512_cmplt_epi64_mask(v, _mm512_set1_epi64(pivot));
+		}
+		static void store(int64_t* p, mask m, index_type n, reg v) {
+			_mm512_mask_storeu_epi64(p, (mask)((1U << n) - 1), _mm512_maskz_compress_epi64(m, v));
+		}
+	};
+
+	template <>
+	struct partition_lanes<uint32_t> {
+		using reg = __m512i;
+		using mask = __mmask16;
+		static const index_type count = 16;
+
+		static reg load(const uint32_t* p) { return _mm512_loadu_si512((const void*)p); }
+		static mask compare(reg v, uint32_t pivot, bool inclusive) {
+			return inclusive ? _mm512_cmple_epu32_mask(v, _mm512_set1_epi32((int)pivot))
+				: _mm512_cmplt_epu32_mask(v, _mm512_set1_epi32((int)pivot));
+		}
+		static void store(uint32_t* p, mask m, index_type n, reg v) {
+			_mm512_mask_storeu_epi32(p, (mask)((1U << n) - 1), _mm512_maskz_compress_epi32(m, v));
+		}
+	};
+
+	template <bool inclusive, typename T>
+	inline
+	index_type partition_simd(T* data, index_type count, T pivot, T* high) {
+		using lanes = partition_lanes<T>;
+		const index_type width = lanes::count;
+
+		index_type low = 0;
+		index_type high_count = 0;
+		index_type i = 0;
+
+		for(; i + width <= count; i += width) {
+			auto v = lanes::load(data + i);
+			auto m = lanes::compare(v, pivot, inclusive);
+			index_type n = popcount64((uint64_t)m);
+
+			lanes::store(data + low, m, n, v);
+			lanes::store(high + high_count, (typename lanes::mask)~m, width - n, v);
+			low += n;
+			high_count += width - n;
+		}
+
+		for(; i < count; ++i) {
+			T v = data[i];
+			if(inclusive ? v <= pivot : v < pivot)
+				data[low++] = v;
+			else
+				high[high_count++] = v;
+		}
+
+		return low;
+	}
+#endif
+
+	template <bool inclusive, typename T>
+	inline
+	index_type partition_block(T* data, index_type count, T pivot, T* high) {
+		return partition_kernel<inclusive>(data, count, pivot, high);
+	}
+
+#if defined(__AVX512F__)
+	template <bool inclusive>
+	inline
+	index_type partition_block(f64* data, index_type count, f64 pivot, f64* high) {
+		return partition_simd<inclusive>(data, count, pivot, high);
+	}
+
+	template <bool inclusive>
+	inline
+	index_type partition_block(f32* data, index_type count, f32 pivot, f32* high) {
+		return partition_simd<inclusive>(data, count, pivot, high);
+	}
+
+	template <bool inclusive>
+	inline
+	index_type partition_block(int64_t* data, index_type count, int64_t pivot, int64_t* high) {
+		return partition_simd<inclusive>(data, count, pivot, high);
+	}
+
+	template <bool inclusive>
+	inline
+	index_type partition_block(uint32_t* data, index_type count, uint32_t pivot, uint32_t* high) {
+		return partition_simd<inclusive>(data, count, pivot, high);
+	}
+#endif
+
+	template <bool inclusive, typename T>
+	inline
+	index_type partition_in_place(T* data, index_type count, T pivot, T* high) {
+		index_type low = partition_block<inclusive>(data, count, pivot, high);
+		std::memcpy(data + low, high, (size_t)(count - low) * sizeof(T));
+		return low;
+	}
+
+	template <typename T>
+	inline
+	void insertion_sort(T* data, index_type count) {
+		for(index_type i = 1; i < count; ++i) {
+			T v = data[i];
+			index_type j = i;
+			for(; j > 0 && v < data[j - 1]; --j)
+				data[j] = data[j - 1];
+			data[j] = v;
+		}
+	}
+
+	template <typename T>
+	inline
+	T median_of_three(T a, T b, T c) {
+		if(b < a)
+			std::swap(a, b);
+		if(c < b)
+			b = c < a ? a : c;
+		return b;
+	}
+}
+
+//
+//  Radix sort
+//
+
+/**
+ *  Sorts v in ascending order. count elements of scratch are allocated
+ *  from arena, wrap the call in a stack_arena_scope to release them.
+ *
+ *  Preconditions:
+ *  (1) thread_count >= 1
+ */
+template <typename T>
+inline
+void sort(arena* arena, vector<T> v, int thread_count = 1) {
+	assert(arena != nullptr);
+	assert(thread_count >= 1);
+
+	index_type count = length(v);
+	if(count < 2)
+		return;
+
+	if(v.stride != 1) {
+		vector<T> packed = gather(v, make_uninitialized_vector<T>(arena, count));
+		sort(arena, packed, thread_count);
+		scatter(packed, v);
+		return;
+	}
+
+	T* scratch = allocate<T>(arena, count);
+	detail::radix_sort<T, T>(arena, v.array, scratch, nullptr, nullptr, count, thread_count);
+}
+
+/**
+ *  Writes in, sorted in ascending order, to the front of out and returns
+ *  the written part of out. Scratch as for sort(arena, v).
+ *
+ *  Preconditions:
+ *  (1) length(out) >= length(in)
+ *  (2) in and out do not overlap
+ */
+template <typename T>
+inline
+vector<T> sort(arena* arena, vector<T> in, vector<T> out, int thread_count = 1) {
+	assert(length(out) >= length(in));
+
+	out.count = length(in);
+	copy_to(in, out);
+	sort(arena, out, thread_count);
+
+	return out;
+}
+
+/**
+ *  Returns the permutation p for which v[p[0]], v[p[1]], ... is in
+ *  ascending order, equal elements keep their order. v is not changed.
+ *
+ *  Preconditions:
+ *  (1) thread_count >= 1
+ */
+template <typename T>
+inline
+vector<index_type> argsort(arena* arena, vector<T> v, int thread_count = 1) {
+	assert(arena != nullptr);
+	assert(thread_count >= 1);
+
+	index_type count = length(v);
+	vector<index_type> result = make_uninitialized_vector<index_type>(arena, count);
+
+	for(index_type i = 0; i < count; ++i)
+		result.array[i] = i;
+
+	if(count < 2)
+		return result;
+
+	T* keys = allocate<T>(arena, count);
+	T* scratch = allocate<T>(arena, count);
+	index_type* index_scratch = allocate<index_type>(arena, count);
+
+	detail::gather_kernel(v.array, v.stride, keys, count);
+	detail::radix_sort(arena, keys, scratch, result.array, index_scratch, count, thread_count);
+
+	return result;
+}
+
+//
+//  Partition and selection
+//
+
+/**
+ *  Moves the elements of v that are < pivot to the front, both groups
+ *  keeping their order, and returns their number. length(v) - that
+ *  number elements of scratch are allocated from arena.
+ *
+ *  Preconditions:
+ *  (1) v is contiguous (stride 1)
+ */
+template <typename T>
+inline
+index_type partition(arena* arena, vector<T> v, T pivot) {
+	assert(arena != nullptr);
+	assert(v.stride == 1);
+
+	T* high = allocate<T>(arena, length(v));
+	return detail::partition_in_place<false>(v.array, length(v), pivot, high);
+}
+
+/**
+ *  Reorders v so that v[n] is the element a sort would put there, with
+ *  no greater element before it and no smaller element after it, and
+ *  returns v[n]. length(v) elements of scratch are allocated from arena.
+ *
+ *  Preconditions:
+ *  (1) v is contiguous (stride 1)
+ *  (2) 0 <= n < length(v)
+ *  (3) v holds no NaN
+ */
+template <typename T>
+inline
+T nth_element(arena* arena, vector<T> v, index_type n) {
+	assert(arena != nullptr);
+	assert(v.stride == 1);
+	assert(n >= 0 && n < length(v));
+
+	T* data = v.array;
+	T* high = allocate<T>(arena, length(v));
+	index_type begin = 0;
+	index_type end = length(v);
+
+	while(end - begin > detail::select_small) {
+		T pivot = detail::median_of_three(data[begin], data[begin + (end - begin) / 2], data[end - 1]);
+
+		index_type less = begin + detail::partition_in_place<false>(data + begin, end - begin, pivot, high);
+		if(n < less) {
+			end = less;
+			continue;
+		}
+
+		//The pivot is in the range, so this takes at least one element
+		index_type equal = less + detail::partition_in_place<true>(data + less, end - less, pivot, high);
+		if(n < equal)
+			return pivot;
+
+		begin = equal;
+	}
+
+	detail::insertion_sort(data + begin, end - begin);
+	return data[n];
+}
+}
+
+// LIBAXL_SORT_GUARD
+#endif
@@ -0,0 +1,176 @@
+
+#ifndef LIBAXL_SPSC_RING_BUFFER_GUARD
+#define LIBAXL_SPSC_RING_BUFFER_GUARD
+
+#include <atomic>
+#include <new>
+
+#include "util.h"
+#include "arena.h"
+#include "vectors.h"
+#include "vector_pair.h"
+#include "circular_buffer.h"
+
+namespace libaxl {
+
+namespace detail {
+	const size_type cache_line_size = 64;
+}
+
+/**
+ *  Lock-free single-producer/single-consumer ring buffer.
+ *
+ *  head counts the elements ever committed by the producer and tail
+ *  the elements ever released by the consumer; each is written by one
+ *  side only and sits on its own cache line, together with that side's
+ *  cached copy of the other counter so that the shared line is only
+ *  touched when the cached value no longer suffices.
+ *
+ *  Producer:  reserve_write -> fill the vector_pair -> commit_write
+ *  Consumer:  peek_read -> process the vector_pair -> release_read
+ *
+ *  The windows are views into the ring storage (a circular_buffer),
+ *  so handing data between the threads copies nothing. Commit/release
+ *  use release stores and the refreshes of the cached counters acquire
+ *  loads, which orders the element accesses against the handoff.
+ */
+template <typename T>
+struct spsc_ring_buffer {
+	//Producer line
+	alignas(detail::cache_line_size) std::atomic<size_type> head;
+	size_type cached_tail;
+
+	//Consumer line
+	alignas(detail::cache_line_size) std::atomic<size_type> tail;
+	size_type cached_head;
+
+	//Read-only after construction
+	alignas(detail::cache_line_size) circular_buffer<T> storage;
+};
+
+/**
+ *  Allocates a ring of count elements, and the ring state itself,
+ *  from arena.
+ *
+ *  Preconditions:
+ *  (1) count >= 1
+ */
+template <typename T>
+inline
+spsc_ring_buffer<T>* make_spsc_ring_buffer(arena* arena, index_type count) {
+	assert(arena != nullptr);
+	assert(count >= 1);
+
+	auto memory = arena->alloc(sizeof(spsc_ring_buffer<T>), detail::cache_line_size);
+	auto result = new (memory) spsc_ring_buffer<T>();
+
+	result->head.store(0, std::memory_order_relaxed);
+	result->cached_tail = 0;
+	result->tail.store(0, std::memory_order_relaxed);
+	result->cached_head = 0;
+	result->storage = make_circular_buffer<T>(arena, count);
+
+	return result;
+}
+
+template <typename T>
+inline
+index_type length(const spsc_ring_buffer<T>& rb) {
+	return length(rb.storage);
+}
+
+namespace detail {
+	template <typename T>
+	inline
+	circular_buffer<T> spsc_storage_at(const spsc_ring_buffer<T>& rb, size_type position) {
+		circular_buffer<T> result = rb.storage;
+
+		result.tail = ring_index(position, length(rb.storage));
+
+		return result;
+	}
+}
+
+//
+//  Producer side
+//
+
+/**
+ *  Returns a window of at most count free elements to write into.
+ *  The window is shorter (possibly empty) if the ring is that full.
+ *  Nothing becomes visible to the consumer before commit_write.
+ */
+template <typename T>
+inline
+vector_pair<T> reserve_write(spsc_ring_buffer<T>& rb, index_type count) {
+	assert(count >= 0);
+
+	size_type capacity = (size_type)length(rb);
+	size_type head = rb.head.load(std::memory_order_relaxed);
+
+	if(capacity - (head - rb.cached_tail) < (size_type)count)
+		rb.cached_tail = rb.tail.load(std::memory_order_acquire);
+
+	size_type free_count = capacity - (head - rb.cached_tail);
+	index_type result_count = (index_type)minimum((size_type)count, free_count);
+
+	return write(detail::spsc_storage_at(rb, head), result_count);
+}
+
+/**
+ *  Publishes the first count elements of the last reserved window.
+ */
+template <typename T>
+inline
+void commit_write(spsc_ring_buffer<T>& rb, index_type count) {
+	assert(count >= 0);
+
+	size_type head = rb.head.load(std::memory_order_relaxed);
+	assert(head + (size_type)count - rb.cached_tail <= (size_type)length(rb));
+
+	rb.head.store(head + (size_type)count, std::memory_order_release);
+}
+
+//
+//  Consumer side
+//
+
+/**
+ *  Returns a window of at most count committed elements, oldest first.
+ *  The window is shorter (possibly empty) if fewer are available.
+ */
+template <typename T>
+inline
+vector_pair<T> peek_read(spsc_ring_buffer<T>& rb, index_type count) {
+	assert(count >= 0);
+
+	size_type tail = rb.tail.load(std::memory_order_relaxed);
+
+	if(rb.cached_head - tail < (size_type)count)
+		rb.cached_head = rb.head.load(std::memory_order_acquire);
+
+	size_type available = rb.cached_head - tail;
+	index_type result_count = (index_type)minimum((size_type)count, available);
+
+	//read() yields the elements just before the tail of the ring
+	return read(detail::spsc_storage_at(rb, tail + (size_type)result_count), result_count);
+}
+
+/**
+ *  Returns the first count elements of the last peeked window to
+ *  the producer.
+ */
+template <typename T>
+inline
+void release_read(spsc_ring_buffer<T>& rb, index_type count) {
+	assert(count >= 0);
+
+	size_type tail = rb.tail.load(std::memory_order_relaxed);
+	assert(tail + (size_type)count <= rb.cached_head);
+
+	rb.tail.store(tail + (size_type)count, std::memory_order_release);
+}
+}
+
+// LIBAXL_SPSC_RING_BUFFER_GUARD
+#endif
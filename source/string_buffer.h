@@ -15,7 +15,7 @@ struct string_buffer {
 };
 
 inline
-void space(string_buffer& buf, int count);
+void space(string_buffer& buf, index_type count);
 
 inline
 index_type push(string_buffer& sb) {
@@ -83,7 +83,7 @@ string_buffer& append(string_buffer& buf, const char* str) {
 }
 
 inline
-string_buffer& append(string_buffer& buf, const char* str, int length) {
+string_buffer& append(string_buffer& buf, const char* str, index_type length) {
 	auto state = push(buf);
 	append(buf, str);
 	auto appended_length = buf.used - state;
@@ -94,9 +94,9 @@ string_buffer& append(string_buffer& buf, const char* str, int length) {
 /*
 inline
 string_buffer& append(string_buffer& buf, const_string str) {
-	int slen = length(str);
-	int read_index = 0;
-	for(int i = 0; i < slen; ++i) {
+	index_type slen = length(str);
+	index_type read_index = 0;
+	for(index_type i = 0; i < slen; ++i) {
 		buf.memory[buf.used++] = str.array[read_index];
 		read_index += str.stride;
 	}
@@ -122,7 +122,7 @@ void space(string_buffer& buf) {
 }
 
 inline
-void space(string_buffer& buf, int count) {
+void space(string_buffer& buf, index_type count) {
 	while(count--) {
 		append(buf, " ");
 	}
@@ -134,7 +134,7 @@ void newline(string_buffer& buf) {
 }
 
 inline
-void newline(string_buffer& buf, int indent) {
+void newline(string_buffer& buf, index_type indent) {
 	append(buf, "\n");
 	space(buf, indent);
 }
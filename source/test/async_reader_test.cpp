@@ -0,0 +1,110 @@
+
+#include "../vectors.h"
+#include "../async_reader.h"
+#include "../stack_arena.h"
+#include <cstdio>
+#include <iostream>
+
+namespace {
+using namespace libaxl;
+
+const char* path = "async_reader_test.bin";
+
+//Element i of the test file is i, followed by extra_bytes stray bytes
+bool write_test_file(int64_t count, size_t extra_bytes) {
+	FILE* file = fopen(path, "wb");
+	if(!file)
+		return false;
+
+	for(int64_t i = 0; i < count; ++i)
+		fwrite(&i, sizeof(i), 1, file);
+
+	const unsigned char stray[8] = {};
+	fwrite(stray, 1, extra_bytes, file);
+
+	return fclose(file) == 0;
+}
+
+const char* backend_name(async_backend backend) {
+	return backend == async_auto ? "auto" : (backend == async_io_uring ? "io_uring" : "threads");
+}
+
+//Streams the file and checks that every element arrives once, in order.
+//Releases whole windows, or one chunk at a time when one_chunk is set
+void stream(arena* arena, async_backend backend, index_type chunk, index_type depth, int64_t count, bool one_chunk) {
+	stack_arena_scope scope{ (stack_arena*)arena };
+
+	async_reader<int64_t>* r = make_async_reader<int64_t>(arena, path, chunk, depth, backend, 3);
+	std::cout << "  " << backend_name(backend) << ", chunk " << chunk << ", depth " << depth
+		<< (one_chunk ? ", chunk by chunk" : ", whole windows") << ": ";
+	if(!r) {
+		std::cout << "not available" << std::endl;
+		return;
+	}
+
+	int64_t expected = 0;
+	index_type errors = 0;
+
+	for(;;) {
+		vector_pair<int64_t> window = peek_read(*r);
+		if(is_empty(first(window)) && is_empty(second(window)))
+			break;
+
+		index_type used = one_chunk ? minimum(chunk, length(window)) : length(window);
+		for(index_type i = 0; i < used; ++i) {
+			errors += (window[i] != expected) ? 1 : 0;
+			++expected;
+		}
+
+		release_read(*r, used);
+	}
+
+	std::cout << expected << "/" << count << " elements, errors " << errors
+		<< ", failed " << failed(*r) << std::endl;
+
+	destroy_async_reader(r);
+}
+}
+
+int main(int argc, char** argv) {
+	using namespace libaxl;
+
+	const size_type arena_size = 4U << 20;
+	dynamic_stack_arena arena{ new unsigned char[arena_size], arena_size };
+
+	//Not a multiple of any chunk below
+	const int64_t count = 100003;
+	if(!write_test_file(count, 0)) {
+		std::cout << "could not write " << path << std::endl;
+		return 1;
+	}
+
+	for(async_backend backend : { async_io_uring, async_threads, async_auto }) {
+		stream(&arena, backend, 1000, 4, count, false);
+		stream(&arena, backend, 4096, 1, count, false);
+		stream(&arena, backend, 777, 8, count, true);
+	}
+
+	{
+		stack_arena_scope scope{ &arena };
+
+		write_test_file(count, 3);
+		async_reader<int64_t>* partial = make_async_reader<int64_t>(&arena, path, 1000, 4, async_threads);
+		async_reader<int64_t>* missing = make_async_reader<int64_t>(&arena, "async_reader_test_missing.bin", 1000, 4);
+		std::cout << "trailing partial element refused: " << (partial == nullptr)
+			<< ", missing file refused: " << (missing == nullptr) << std::endl;
+
+		write_test_file(0, 0);
+		async_reader<int64_t>* empty = make_async_reader<int64_t>(&arena, path, 1000, 4);
+		std::cout << "empty file: " << (empty ? length(first(peek_read(*empty))) : -1) << " elements" << std::endl;
+		if(empty)
+			destroy_async_reader(empty);
+	}
+
+	remove(path);
+
+	int in;
+	std::cin >> in;
+
+	return 0;
+}
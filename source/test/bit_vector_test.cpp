@@ -0,0 +1,140 @@
+
+#include "../vectors.h"
+#include "../vector_f64.h"
+#include "../bit_vector.h"
+#include "../lazy_eval/lazy_eval.h"
+#include "../stack_arena.h"
+#include <iostream>
+
+namespace {
+using namespace libaxl;
+
+//Element i is i
+template <typename T>
+vector<T> make_values(arena* arena, index_type count) {
+	vector<T> result = make_uninitialized_vector<T>(arena, count);
+	for(index_type i = 0; i < count; ++i)
+		result[i] = (T)i;
+	return result;
+}
+
+//Set where a hash of i, out of 256, falls below density
+bool hashed_bit(index_type i, unsigned density) {
+	uint32_t h = (uint32_t)i * 2654435761U;
+	return ((h >> 24) & 255) < density;
+}
+
+//Compress of a contiguous and a strided view of elements of type T
+template <typename T>
+index_type compress_mismatches(arena* arena, bit_vector mask) {
+	stack_arena_scope scope{ (stack_arena*)arena };
+
+	index_type count = length(mask);
+	index_type errors = 0;
+
+	vector<T> values = make_values<T>(arena, 2 * count);
+	for(index_type pass = 0; pass < 2; ++pass) {
+		//Pass 0 is contiguous (the SIMD path), pass 1 every other element
+		vector<T> in = pass == 0 ? take(values, count) : drop_odd(values);
+		index_type step = pass == 0 ? 1 : 2;
+
+		vector<T> out = compress(arena, in, mask);
+		errors += (length(out) != popcount(mask)) ? 1 : 0;
+
+		index_type written = 0;
+		for(index_type i = 0; i < count; ++i) {
+			if(!test(mask, i))
+				continue;
+			errors += (written >= length(out) || out[written] != (T)(i * step)) ? 1 : 0;
+			++written;
+		}
+	}
+
+	return errors;
+}
+
+void check(arena* arena, index_type count, unsigned density) {
+	stack_arena_scope scope{ (stack_arena*)arena };
+
+	//Built from a mask expression and bit by bit, both must agree
+	vector<f64> hashed = make_uninitialized_vector<f64>(arena, count);
+	for(index_type i = 0; i < count; ++i)
+		hashed[i] = hashed_bit(i, density) ? 1.0 : 0.0;
+	bit_vector mask = to_bit_vector(arena, hashed > constant(0.5));
+
+	bit_vector expected = make_bit_vector(arena, count);
+	index_type set_count = 0;
+	for(index_type i = 0; i < count; ++i) {
+		if(hashed_bit(i, density)) {
+			set(expected, i);
+			++set_count;
+		}
+	}
+
+	index_type errors = 0;
+	for(index_type w = 0; w < detail::word_count(count); ++w)
+		errors += (mask.words[w] != expected.words[w]) ? 1 : 0;
+	errors += (popcount(mask) != set_count) ? 1 : 0;
+
+	bit_rank_directory directory = make_rank_directory(arena, mask);
+	index_type running = 0;
+	for(index_type i = 0; i <= count; ++i) {
+		errors += (rank(mask, i) != running) ? 1 : 0;
+		errors += (rank(mask, directory, i) != running) ? 1 : 0;
+		if(i < count && test(mask, i)) {
+			errors += (select(mask, running) != i) ? 1 : 0;
+			errors += (select(mask, directory, running) != i) ? 1 : 0;
+			++running;
+		}
+	}
+	errors += (select(mask, set_count) != -1) ? 1 : 0;
+	errors += (select(mask, directory, set_count) != -1) ? 1 : 0;
+	errors += (select(mask, directory, set_count + 100) != -1) ? 1 : 0;
+
+	bit_vector inverted = logical_not(arena, mask);
+	errors += (popcount(inverted) != count - set_count) ? 1 : 0;
+	errors += (popcount(logical_and(arena, mask, inverted)) != 0) ? 1 : 0;
+	errors += (popcount(logical_or(arena, mask, inverted)) != count) ? 1 : 0;
+
+	index_type compress_errors = compress_mismatches<f64>(arena, mask)
+		+ compress_mismatches<f32>(arena, mask) + compress_mismatches<int32_t>(arena, mask);
+
+	//Masked fill of a strided view, masked copy into a contiguous one
+	vector<f64> filled = make_values<f64>(arena, 2 * count);
+	fill(drop_even(filled), mask, -1.0);
+	vector<f64> copied = make_uninitialized_vector<f64>(arena, count);
+	for(index_type i = 0; i < count; ++i)
+		copied[i] = -2.0;
+	copy_to(drop_odd(make_values<f64>(arena, 2 * count)), copied, mask);
+
+	index_type masked_errors = 0;
+	for(index_type i = 0; i < count; ++i) {
+		bool bit = test(mask, i);
+		masked_errors += (filled[2 * i] != (f64)(2 * i)) ? 1 : 0;
+		masked_errors += (filled[2 * i + 1] != (bit ? -1.0 : (f64)(2 * i + 1))) ? 1 : 0;
+		masked_errors += (copied[i] != (bit ? (f64)(2 * i) : -2.0)) ? 1 : 0;
+	}
+
+	std::cout << "  " << count << " bits, density " << density << "/256: " << set_count
+		<< " set, bits/rank/select errors " << errors << ", compress errors " << compress_errors
+		<< ", masked fill/copy errors " << masked_errors << std::endl;
+}
+}
+
+int main(int argc, char** argv) {
+	using namespace libaxl;
+
+	const size_type arena_size = 4U << 20;
+	dynamic_stack_arena arena{ new unsigned char[arena_size], arena_size };
+
+	//Around the word (64) and directory block (512) boundaries
+	for(index_type count : { 0, 1, 63, 64, 65, 511, 512, 513, 4000 }) {
+		for(unsigned density : { 0U, 3U, 128U, 256U })
+			check(&arena, count, density);
+	}
+
+	int in;
+	std::cin >> in;
+
+	return 0;
+}
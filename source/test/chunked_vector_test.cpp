@@ -0,0 +1,66 @@
+
+#include "../vectors.h"
+#include "../vector_f64.h"
+#include "../chunked_vector.h"
+#include "../lazy_eval/lazy_eval.h"
+#include "../stack_arena.h"
+#include <iostream>
+
+int main(int argc, char** argv) {
+	using namespace libaxl;
+
+	const size_type arena_size = 1U << 20;
+	dynamic_stack_arena arena{ new unsigned char[arena_size], arena_size };
+
+	std::cout << "default chunk_size<f64>: " << chunk_size(make_chunked_vector<f64>(&arena)) << std::endl;
+
+	chunked_vector<f64> cv = make_chunked_vector<f64>(&arena, 8);
+
+	//Singles, then a block that fills the last chunk and spans more
+	for(index_type i = 0; i < 5; ++i)
+		append(cv, (f64)i);
+	f64* first_element = &cv[0];
+
+	vector_f64 block = iota_f64(&arena, 100);
+	append(cv, drop(block, 5));
+	//A strided block, every other element of 100..139
+	append(cv, drop_odd(drop(iota_f64(&arena, 140), 100)));
+
+	index_type mismatches = 0;
+	for(index_type i = 0; i < 100; ++i)
+		mismatches += (cv[i] != (f64)i) ? 1 : 0;
+	for(index_type i = 0; i < 20; ++i)
+		mismatches += (cv[100 + i] != (f64)(100 + 2 * i)) ? 1 : 0;
+
+	std::cout << "length " << length(cv) << ", mismatches " << mismatches
+		<< ", element 0 did not move: " << (&cv[0] == first_element) << std::endl;
+
+	std::cout << "segments " << segment_count(cv) << ":";
+	for(index_type s = 0; s < segment_count(cv); ++s)
+		std::cout << " " << length(segment(cv, s));
+	std::cout << std::endl;
+
+	{
+		stack_arena_scope scope{ &arena };
+
+		//Lazy expressions over the chunks, split at the chunk boundaries
+		vector_list<f64> list = to_vector_list(&arena, cv);
+		vector_f64 doubled = eval(list * constant(2.0), &arena);
+		std::cout << "eval(list * 2): " << length(doubled) << " elements, [7] " << doubled[7]
+			<< ", [8] " << doubled[8] << ", [119] " << doubled[119] << std::endl;
+
+		vector_list<f64> written = assign(list, take(ones_f64(&arena, 150), 13) * constant(-1.0), &arena);
+		std::cout << "assign 13 ones * -1: written " << length(written) << " in " << segment_count(written)
+			<< " segments, cv[12] " << cv[12] << ", cv[13] " << cv[13] << std::endl;
+	}
+
+	clear(cv);
+	append(cv, (f64)42);
+	std::cout << "after clear and append: length " << length(cv) << ", segments " << segment_count(cv)
+		<< ", chunk reused: " << (&cv[0] == first_element) << ", cv[0] " << cv[0] << std::endl;
+
+	int in;
+	std::cin >> in;
+
+	return 0;
+}
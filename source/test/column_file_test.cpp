@@ -0,0 +1,172 @@
+
+#include "../vectors.h"
+#include "../column_file.h"
+#include "../stack_arena.h"
+#include <cstdio>
+#include <iostream>
+
+namespace {
+using namespace libaxl;
+
+const char* path = "column_file_test.bin";
+const char* corrupt_path = "column_file_test_corrupt.bin";
+
+bool write_test_file(arena* arena) {
+	stack_arena_scope scope{ (stack_arena*)arena };
+
+	vector<f64> prices = make_uninitialized_vector<f64>(arena, 1000);
+	for(index_type i = 0; i < length(prices); ++i)
+		prices[i] = (f64)((i * 37) % 101) - 50.0;
+
+	vector<int32_t> ids = make_uninitialized_vector<int32_t>(arena, 14);
+	for(index_type i = 0; i < length(ids); ++i)
+		ids[i] = (int32_t)(i * i);
+
+	vector<uint8_t> flags = make_uninitialized_vector<uint8_t>(arena, 3);
+	flags[0] = 1;
+	flags[1] = 0;
+	flags[2] = 255;
+
+	column_file_writer w = create_column_file(path, arena, 4);
+	//prices is written strided, through the staging buffer
+	bool ok = add_column(w, "prices", prices, 128);
+	ok = add_column(w, "even_ids", drop_odd(ids)) && ok;
+	ok = add_column(w, "flags", flags, 2) && ok;
+
+	return close_column_file(w) && ok;
+}
+
+//Reads the file, lets patch change the bytes, writes corrupt_path
+template <typename Patch>
+bool write_corrupt_copy(Patch patch) {
+	FILE* in = fopen(path, "rb");
+	if(!in)
+		return false;
+
+	unsigned char bytes[16384];
+	size_t size = fread(bytes, 1, sizeof(bytes), in);
+	fclose(in);
+
+	auto header = (column_file_header*)bytes;
+	auto columns = (column_entry*)(bytes + header->directory_offset);
+	patch(*header, columns);
+
+	FILE* out = fopen(corrupt_path, "wb");
+	if(!out)
+		return false;
+	fwrite(bytes, 1, size, out);
+	return fclose(out) == 0;
+}
+
+template <typename Patch>
+void expect_rejected(const char* what, Patch patch) {
+	if(!write_corrupt_copy(patch)) {
+		std::cout << "  " << what << ": could not write the copy" << std::endl;
+		return;
+	}
+
+	column_file f = open_column_file(corrupt_path);
+	std::cout << "  " << what << ": " << (f.header == nullptr ? "rejected" : "opened") << std::endl;
+	if(f.header)
+		close_column_file(f);
+}
+}
+
+int main(int argc, char** argv) {
+	using namespace libaxl;
+
+	dynamic_stack_arena arena{ new unsigned char[1 << 16], 1 << 16 };
+
+	if(!write_test_file(&arena)) {
+		std::cout << "could not write " << path << std::endl;
+		return 1;
+	}
+
+	{
+		column_file f = open_column_file(path);
+		if(!f.header) {
+			std::cout << "could not open " << path << std::endl;
+			return 1;
+		}
+
+		std::cout << column_count(f) << " columns:";
+		for(index_type i = 0; i < column_count(f); ++i)
+			std::cout << " " << column_name(f, i) << " (type " << type_of_column(f, i) << ")";
+		std::cout << std::endl;
+
+		index_type price_column = find_column(f, "prices");
+		vector<f64> prices = column<f64>(f, price_column);
+		index_type price_mismatches = 0;
+		for(index_type i = 0; i < length(prices); ++i)
+			price_mismatches += (prices[i] != (f64)((i * 37) % 101) - 50.0) ? 1 : 0;
+
+		index_type verified = 0;
+		for(index_type c = 0; c < chunk_count(f, price_column); ++c)
+			verified += verify_chunk<f64>(f, price_column, c) ? 1 : 0;
+
+		column_chunk_stats last = chunk_stats(f, price_column, chunk_count(f, price_column) - 1);
+		std::cout << "prices: " << length(prices) << " elements, mismatches " << price_mismatches
+			<< ", chunks verified " << verified << "/" << chunk_count(f, price_column)
+			<< ", last chunk " << length(column_chunk<f64>(f, price_column, chunk_count(f, price_column) - 1))
+			<< " elements in [" << last.min << ", " << last.max << "]" << std::endl;
+
+		vector<int32_t> ids = column<int32_t>(f, find_column(f, "even_ids"));
+		std::cout << "even_ids:";
+		for(index_type i = 0; i < length(ids); ++i)
+			std::cout << " " << ids[i];
+		std::cout << std::endl;
+
+		vector<uint8_t> flags = column<uint8_t>(f, find_column(f, "flags"));
+		std::cout << "flags: " << (int)flags[0] << " " << (int)flags[1] << " " << (int)flags[2]
+			<< ", chunks " << chunk_count(f, find_column(f, "flags"))
+			<< ", find_column(missing) " << find_column(f, "missing") << std::endl;
+
+		close_column_file(f);
+	}
+
+	std::cout << "corrupted copies:" << std::endl;
+	expect_rejected("unchanged copy (opens)", [](column_file_header&, column_entry*) {});
+	expect_rejected("bad magic", [](column_file_header& h, column_entry*) { h.magic[0] = 'X'; });
+	expect_rejected("file size", [](column_file_header& h, column_entry*) { h.file_size += 64; });
+	expect_rejected("directory past the end", [](column_file_header& h, column_entry*) { h.column_count = 1000; });
+	expect_rejected("payload past the end", [](column_file_header&, column_entry* c) { c[0].count = 100000; });
+	//Only reaches the overflow check with LIBAXL_INDEX_64, 4 * (2^62 + 1) wraps to 4
+	expect_rejected("count * element_size wraps", [](column_file_header&, column_entry* c) { c[1].count = ((uint64_t)1 << 62) + 1; });
+	expect_rejected("element_size does not match type", [](column_file_header&, column_entry* c) { c[1].element_size = 8; });
+	expect_rejected("unknown type", [](column_file_header&, column_entry* c) { c[2].type = 99; });
+	expect_rejected("chunk_count too small", [](column_file_header&, column_entry* c) { c[0].chunk_count -= 1; });
+	expect_rejected("chunk_count without chunk_size", [](column_file_header&, column_entry* c) { c[0].chunk_size = 0; });
+	expect_rejected("name without terminator", [](column_file_header& h, column_entry*) { h.string_table_size -= 1; });
+	expect_rejected("name offset past the table", [](column_file_header& h, column_entry* c) { c[1].name = (uint32_t)h.string_table_size; });
+
+#if !defined(_WIN32)
+	{
+		//Padded with a sparse hole to more bytes than a 32-bit
+		//index_type counts, the columns still open in place
+		const uint64_t large_size = ((uint64_t)1 << 31) + 4096;
+		bool written = write_corrupt_copy([=](column_file_header& h, column_entry*) { h.file_size = large_size; })
+			&& truncate(corrupt_path, (off_t)large_size) == 0;
+
+		column_file f = open_column_file(corrupt_path);
+		bool opened = f.header != nullptr;
+		index_type price_mismatches = -1;
+		if(opened) {
+			vector<f64> prices = column<f64>(f, find_column(f, "prices"));
+			price_mismatches = 0;
+			for(index_type i = 0; i < length(prices); ++i)
+				price_mismatches += (prices[i] != (f64)((i * 37) % 101) - 50.0) ? 1 : 0;
+			close_column_file(f);
+		}
+		std::cout << "file over 2 GiB: " << (!written ? "could not write" : (!opened ? "rejected" : "opened"))
+			<< ", prices mismatches " << price_mismatches << " (0)" << std::endl;
+	}
+#endif
+
+	remove(path);
+	remove(corrupt_path);
+
+	int in;
+	std::cin >> in;
+
+	return 0;
+}
@@ -0,0 +1,170 @@
+
+#include "../vectors.h"
+#include "../complex.h"
+#include "../stack_arena.h"
+#include <cmath>
+#include <complex>
+#include <iostream>
+
+namespace {
+using namespace libaxl;
+
+//Small multiples of 0.25, products are exact in f32 and f64
+template <typename T>
+std::complex<T> value_at(index_type i, index_type seed) {
+	return std::complex<T>((T)((i * 5 + seed) % 13 - 6) * (T)0.25, (T)((i * 3 + 2 * seed) % 11 - 5) * (T)0.25);
+}
+
+//Element i of a contiguous or, with stride 2, every other element view
+template <typename T>
+vector<complex<T>> make_interleaved(arena* arena, index_type count, index_type stride, index_type seed) {
+	vector<complex<T>> storage = make_uninitialized_vector<complex<T>>(arena, count * stride);
+	vector<complex<T>> result = { storage.array, count, stride };
+	for(index_type i = 0; i < count; ++i) {
+		std::complex<T> v = value_at<T>(i, seed);
+		result[i] = complex<T>{ v.real(), v.imag() };
+	}
+	return result;
+}
+
+template <typename T>
+split_complex<T> make_split(arena* arena, index_type count, index_type stride, index_type seed) {
+	split_complex<T> result;
+	vector<T> re = make_uninitialized_vector<T>(arena, count * stride);
+	vector<T> im = make_uninitialized_vector<T>(arena, count * stride);
+	result.re = { re.array, count, stride };
+	result.im = { im.array, count, stride };
+	for(index_type i = 0; i < count; ++i) {
+		std::complex<T> v = value_at<T>(i, seed);
+		result.re[i] = v.real();
+		result.im[i] = v.imag();
+	}
+	return result;
+}
+
+template <typename T>
+bool same(complex<T> a, std::complex<T> b) {
+	return a.re == b.real() && a.im == b.imag();
+}
+
+template <typename T>
+bool close(T a, T b) {
+	T tolerance = sizeof(T) == 4 ? (T)1e-6 : (T)1e-14;
+	return std::fabs(a - b) <= tolerance * (std::fabs(b) + 1);
+}
+
+//Every kernel in both layouts, contiguous or strided, into separate
+//outputs and in place
+template <typename T>
+index_type check(arena* arena, index_type count, index_type stride) {
+	stack_arena_scope scope{ (stack_arena*)arena };
+
+	index_type errors = 0;
+
+	//Views
+	vector<complex<T>> a = make_interleaved<T>(arena, count, stride, 1);
+	vector<complex<T>> b = make_interleaved<T>(arena, count, stride, 4);
+	for(index_type i = 0; i < count; ++i) {
+		errors += (real(a)[i] != value_at<T>(i, 1).real()) ? 1 : 0;
+		errors += (imag(a)[i] != value_at<T>(i, 1).imag()) ? 1 : 0;
+	}
+
+	vector<T> raw = make_uninitialized_vector<T>(arena, 2 * count);
+	for(index_type i = 0; i < count; ++i) {
+		raw[2 * i] = value_at<T>(i, 2).real();
+		raw[2 * i + 1] = value_at<T>(i, 2).imag();
+	}
+	vector<complex<T>> viewed = as_complex(raw);
+	errors += (length(viewed) != count) ? 1 : 0;
+	for(index_type i = 0; i < count; ++i)
+		errors += !same(viewed[i], value_at<T>(i, 2)) ? 1 : 0;
+
+	//Interleaved -> split -> interleaved
+	split_complex<T> split_out = make_split<T>(arena, count, stride, 0);
+	split_complex<T> split = deinterleave(a, split_out);
+	vector<complex<T>> round_trip = interleave(split, make_interleaved<T>(arena, count, stride, 0));
+	errors += (length(split) != count || length(round_trip) != count) ? 1 : 0;
+	for(index_type i = 0; i < count; ++i) {
+		errors += (split.re[i] != value_at<T>(i, 1).real() || split.im[i] != value_at<T>(i, 1).imag()) ? 1 : 0;
+		errors += !same(round_trip[i], value_at<T>(i, 1)) ? 1 : 0;
+	}
+	vector<complex<T>> allocated = interleave(deinterleave(a, arena), arena);
+	for(index_type i = 0; i < count; ++i)
+		errors += !same(allocated[i], value_at<T>(i, 1)) ? 1 : 0;
+
+	//Interleaved kernels
+	vector<complex<T>> product = make_interleaved<T>(arena, count, stride, 0);
+	vector<complex<T>> conjugated = make_interleaved<T>(arena, count, stride, 0);
+	vector<T> magnitudes = make_uninitialized_vector<T>(arena, count);
+	multiply(a, b, product);
+	conjugate(a, conjugated);
+	magnitude(a, magnitudes);
+	for(index_type i = 0; i < count; ++i) {
+		std::complex<T> x = value_at<T>(i, 1), y = value_at<T>(i, 4);
+		errors += !same(product[i], x * y) ? 1 : 0;
+		errors += !same(conjugated[i], std::conj(x)) ? 1 : 0;
+		errors += !close(magnitudes[i], std::abs(x)) ? 1 : 0;
+	}
+
+	multiply(a, b, a);
+	conjugate(b, b);
+	for(index_type i = 0; i < count; ++i) {
+		errors += !same(a[i], value_at<T>(i, 1) * value_at<T>(i, 4)) ? 1 : 0;
+		errors += !same(b[i], std::conj(value_at<T>(i, 4))) ? 1 : 0;
+	}
+
+	//Split kernels
+	split_complex<T> c = make_split<T>(arena, count, stride, 3);
+	split_complex<T> d = make_split<T>(arena, count, stride, 7);
+	split_complex<T> split_product = make_split<T>(arena, count, stride, 0);
+	split_complex<T> split_conjugated = make_split<T>(arena, count, stride, 0);
+	vector<T> split_magnitudes = make_uninitialized_vector<T>(arena, count);
+	multiply(c, d, split_product);
+	conjugate(c, split_conjugated);
+	magnitude(c, split_magnitudes);
+	for(index_type i = 0; i < count; ++i) {
+		std::complex<T> x = value_at<T>(i, 3), y = value_at<T>(i, 7);
+		std::complex<T> p = x * y, q = std::conj(x);
+		errors += (split_product.re[i] != p.real() || split_product.im[i] != p.imag()) ? 1 : 0;
+		errors += (split_conjugated.re[i] != q.real() || split_conjugated.im[i] != q.imag()) ? 1 : 0;
+		errors += !close(split_magnitudes[i], std::abs(x)) ? 1 : 0;
+	}
+
+	multiply(c, d, c);
+	conjugate(d, d);
+	for(index_type i = 0; i < count; ++i) {
+		std::complex<T> p = value_at<T>(i, 3) * value_at<T>(i, 7), q = std::conj(value_at<T>(i, 7));
+		errors += (c.re[i] != p.real() || c.im[i] != p.imag()) ? 1 : 0;
+		errors += (d.re[i] != q.real() || d.im[i] != q.imag()) ? 1 : 0;
+	}
+
+	return errors;
+}
+
+template <typename T>
+void check_all(arena* arena, const char* type_name) {
+	for(index_type stride : { 1, 2 }) {
+		index_type errors = 0;
+		for(index_type count : { 0, 1, 7, 100, 1001 })
+			errors += check<T>(arena, count, stride);
+
+		std::cout << "complex<" << type_name << ">, " << (stride == 1 ? "contiguous" : "strided")
+			<< ": mismatches " << errors << " (0)" << std::endl;
+	}
+}
+}
+
+int main(int argc, char** argv) {
+	using namespace libaxl;
+
+	const size_type arena_size = 4U << 20;
+	dynamic_stack_arena arena{ new unsigned char[arena_size], arena_size };
+
+	check_all<f32>(&arena, "f32");
+	check_all<f64>(&arena, "f64");
+
+	int in;
+	std::cin >> in;
+
+	return 0;
+}
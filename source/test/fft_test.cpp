@@ -0,0 +1,142 @@
+
+#include "../vectors.h"
+#include "../complex.h"
+#include "../fft.h"
+#include "../stack_arena.h"
+#include <cmath>
+#include <iostream>
+
+namespace {
+using namespace libaxl;
+
+const f64 pi = 3.14159265358979323846;
+
+void naive_dft(vector_f64 in_re, vector_f64 in_im, vector_f64 out_re, vector_f64 out_im) {
+	index_type n = length(in_re);
+
+	for(index_type k = 0; k < n; ++k) {
+		f64 re = 0.0, im = 0.0;
+		for(index_type j = 0; j < n; ++j) {
+			f64 angle = -2.0 * pi * (f64)((j * k) % n) / (f64)n;
+			re += in_re[j] * std::cos(angle) - in_im[j] * std::sin(angle);
+			im += in_re[j] * std::sin(angle) + in_im[j] * std::cos(angle);
+		}
+		out_re[k] = re;
+		out_im[k] = im;
+	}
+}
+
+f64 max_difference(vector_f64 a, vector_f64 b) {
+	f64 result = 0.0;
+	for(index_type i = 0; i < length(a); ++i)
+		result = maximum(result, std::fabs(a[i] - b[i]));
+	return result;
+}
+
+//A view of n elements with the given stride into fresh arena memory
+vector_f64 strided_signal(arena* arena, index_type n, index_type stride, f64 phase) {
+	vector_f64 storage = make_uninitialized_vector<f64>(arena, n * stride);
+	fill(storage, -1000.0);
+
+	vector_f64 result = storage;
+	result.count = n;
+	result.stride = stride;
+	for(index_type i = 0; i < n; ++i)
+		result[i] = std::sin(0.7 * (f64)i + phase) + 0.1 * (f64)(i % 5);
+
+	return result;
+}
+
+//fft against the naive DFT and ifft(fft(x)) against x, relative to n
+bool check_fft(arena* arena, index_type n, index_type stride) {
+	stack_arena_scope scope{ (stack_arena*)arena };
+
+	fft_plan plan = make_fft_plan(arena, n);
+	vector_f64 in_re = strided_signal(arena, n, stride, 0.0);
+	vector_f64 in_im = strided_signal(arena, n, stride, 1.0);
+	vector_f64 out_re = make_uninitialized_vector<f64>(arena, n);
+	vector_f64 out_im = make_uninitialized_vector<f64>(arena, n);
+	vector_f64 expected_re = make_uninitialized_vector<f64>(arena, n);
+	vector_f64 expected_im = make_uninitialized_vector<f64>(arena, n);
+	vector_f64 back_re = make_uninitialized_vector<f64>(arena, n);
+	vector_f64 back_im = make_uninitialized_vector<f64>(arena, n);
+
+	fft(plan, in_re, in_im, out_re, out_im);
+	naive_dft(in_re, in_im, expected_re, expected_im);
+	ifft(plan, out_re, out_im, back_re, back_im);
+
+	f64 tolerance = 1e-12 * (f64)n;
+	return max_difference(out_re, expected_re) < tolerance && max_difference(out_im, expected_im) < tolerance
+		&& max_difference(back_re, in_re) < tolerance && max_difference(back_im, in_im) < tolerance;
+}
+
+//rfft against the first n / 2 + 1 bins of the naive DFT and irfft(rfft(x)) against x
+bool check_rfft(arena* arena, index_type n, index_type stride) {
+	stack_arena_scope scope{ (stack_arena*)arena };
+
+	rfft_plan plan = make_rfft_plan(arena, n);
+	vector_f64 in = strided_signal(arena, n, stride, 0.5);
+	vector_f64 zero = make_uninitialized_vector<f64>(arena, n);
+	fill(zero, 0.0);
+	vector_f64 out_re = make_uninitialized_vector<f64>(arena, n / 2 + 1);
+	vector_f64 out_im = make_uninitialized_vector<f64>(arena, n / 2 + 1);
+	vector_f64 expected_re = make_uninitialized_vector<f64>(arena, n);
+	vector_f64 expected_im = make_uninitialized_vector<f64>(arena, n);
+	vector_f64 back = make_uninitialized_vector<f64>(arena, n);
+
+	rfft(plan, in, out_re, out_im);
+	naive_dft(in, zero, expected_re, expected_im);
+
+	f64 tolerance = 1e-12 * (f64)n;
+	bool forward_ok = max_difference(out_re, take(expected_re, n / 2 + 1)) < tolerance
+		&& max_difference(out_im, take(expected_im, n / 2 + 1)) < tolerance;
+
+	//irfft overwrites out_re/out_im
+	irfft(plan, out_re, out_im, back);
+
+	return forward_ok && max_difference(back, in) < tolerance;
+}
+}
+
+int main(int argc, char** argv) {
+	using namespace libaxl;
+
+	const size_type arena_size = 16U << 20;
+	dynamic_stack_arena arena{ new unsigned char[arena_size], arena_size };
+
+	//Powers of two, odd leaves, mixed and prime sizes
+	std::cout << "fft/ifft:" << std::endl;
+	for(index_type n : { 1, 2, 4, 64, 1024, 3, 9, 15, 12, 40, 96, 7, 13, 97, 251 }) {
+		std::cout << "  " << n << ": " << (check_fft(&arena, n, 1) ? "ok" : "wrong")
+			<< ", stride 3: " << (check_fft(&arena, n, 3) ? "ok" : "wrong") << std::endl;
+	}
+
+	std::cout << "rfft/irfft:" << std::endl;
+	for(index_type n : { 2, 4, 6, 14, 64, 1024, 26, 194, 1000 }) {
+		std::cout << "  " << n << ": " << (check_rfft(&arena, n, 1) ? "ok" : "wrong")
+			<< ", stride 2: " << (check_rfft(&arena, n, 2) ? "ok" : "wrong") << std::endl;
+	}
+
+	{
+		stack_arena_scope scope{ &arena };
+
+		//Interleaved input through the split_complex form
+		fft_plan plan = make_fft_plan(&arena, 6);
+		vector_c64 in = make_uninitialized_vector<complex<f64>>(&arena, 6);
+		for(index_type i = 0; i < 6; ++i)
+			in[i] = complex<f64>{ (f64)i, 0.0 };
+		split_complex<f64> out = make_split_complex<f64>(&arena, 6);
+		fft(plan, in, out);
+
+		std::cout << "fft([0, 1, 2, 3, 4, 5]):";
+		for(index_type k = 0; k < 6; ++k)
+			std::cout << " " << std::round(out.re[k] * 1000.0) / 1000.0 << (out.im[k] < 0 ? "" : "+")
+				<< std::round(out.im[k] * 1000.0) / 1000.0 << "i";
+		std::cout << std::endl;
+	}
+
+	int in_char;
+	std::cin >> in_char;
+
+	return 0;
+}
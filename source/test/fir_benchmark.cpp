@@ -0,0 +1,86 @@
+
+#include "../vectors.h"
+#include "../circular_buffer.h"
+#include "../fir_filter.h"
+#include "../stack_arena.h"
+#include <chrono>
+#include <iostream>
+
+namespace {
+using namespace libaxl;
+
+double seconds_since(std::chrono::steady_clock::time_point start) {
+	std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+	return elapsed.count();
+}
+
+//Per sample: push into the ring, then convolve read(cb, taps) with the taps
+void naive_fir(circular_buffer<f64>& cb, vector_f64 taps, vector_f64 in, vector_f64 out) {
+	index_type tap_count = length(taps);
+
+	for(index_type n = 0; n < length(in); ++n) {
+		first(write(cb, 1))[0] = in[n];
+		cb = rotate_left(cb, 1);
+
+		vector_pair<f64> window = read(cb, tap_count);
+		f64 acc = 0.0;
+		for(index_type k = 0; k < tap_count; ++k) {
+			acc += taps[k] * window[tap_count - 1 - k];
+		}
+		out[n] = acc;
+	}
+}
+}
+
+int main(int argc, char** argv) {
+	using namespace libaxl;
+
+	const index_type block_size = 4096;
+	const index_type block_count = 64;
+	const size_type arena_size = 64U << 20;
+
+	dynamic_stack_arena arena{ new unsigned char[arena_size], arena_size };
+
+	vector_f64 in = make_uninitialized_vector<f64>(&arena, block_size * block_count);
+	vector_f64 out = make_uninitialized_vector<f64>(&arena, length(in));
+	for(index_type i = 0; i < length(in); ++i)
+		in.array[i] = (f64)((i * 7919) % 1000) / 1000.0 - 0.5;
+
+	index_type tap_counts[] = { 8, 32, 64, 128, 512, 2048 };
+
+	for(index_type tap_count : tap_counts) {
+		stack_arena_scope scope{ &arena };
+
+		vector_f64 taps = make_uninitialized_vector<f64>(&arena, tap_count);
+		for(index_type k = 0; k < tap_count; ++k)
+			taps.array[k] = 1.0 / (f64)(k + 1);
+
+		circular_buffer<f64> cb = make_circular_buffer<f64>(&arena, tap_count);
+		auto start = std::chrono::steady_clock::now();
+		naive_fir(cb, taps, in, out);
+		double naive_time = seconds_since(start);
+
+		std::cout << "taps " << tap_count << ": naive " << (f64)length(in) / naive_time * 1e-6 << " MS/s";
+
+		fir_mode modes[] = { fir_direct, fir_overlap_save };
+		const char* names[] = { "direct", "overlap-save" };
+
+		for(int m = 0; m < 2; ++m) {
+			fir_filter<f64> f = make_fir_filter(&arena, taps, modes[m]);
+
+			start = std::chrono::steady_clock::now();
+			for(index_type b = 0; b < block_count; ++b) {
+				process(f, take(drop(in, b * block_size), block_size), drop(out, b * block_size));
+			}
+			double time = seconds_since(start);
+
+			std::cout << ", " << names[m] << " " << (f64)length(in) / time * 1e-6 << " MS/s";
+		}
+		std::cout << std::endl;
+	}
+
+	int in_char;
+	std::cin >> in_char;
+
+	return 0;
+}
@@ -0,0 +1,117 @@
+
+#include "../vectors.h"
+#include "../circular_buffer.h"
+#include "../fir_filter.h"
+#include "../stack_arena.h"
+#include <cmath>
+#include <iostream>
+
+namespace {
+using namespace libaxl;
+
+//y[n] = sum_k taps[k] * x[n - k] over the whole stream, x[n < 0] = 0,
+//summed in f64 whatever T is
+template <typename T>
+void naive_convolution(vector<T> taps, vector<T> in, vector_f64 out) {
+	for(index_type n = 0; n < length(in); ++n) {
+		f64 acc = 0.0;
+		for(index_type k = 0; k < length(taps) && k <= n; ++k)
+			acc += (f64)taps[k] * (f64)in[n - k];
+		out[n] = acc;
+	}
+}
+
+//Streams in through f in blocks of the given sizes (cycled) and
+//returns the largest difference to the naive convolution
+template <typename T>
+f64 max_error(arena* arena, fir_filter<T>& f, vector<T> taps, vector<T> in,
+	const index_type* block_sizes, index_type block_size_count)
+{
+	stack_arena_scope scope{ (stack_arena*)arena };
+
+	vector_f64 expected = make_uninitialized_vector<f64>(arena, length(in));
+	vector<T> out = make_uninitialized_vector<T>(arena, length(in));
+	naive_convolution(taps, in, expected);
+
+	reset(f);
+	index_type position = 0;
+	for(index_type b = 0; position < length(in); ++b) {
+		index_type n = minimum(block_sizes[b % block_size_count], length(in) - position);
+		process(f, take(drop(in, position), n), drop(out, position));
+		position += n;
+	}
+
+	f64 result = 0.0;
+	for(index_type i = 0; i < length(in); ++i)
+		result = maximum(result, std::fabs((f64)out[i] - expected[i]));
+
+	return result;
+}
+
+//Both modes for each filter length, in T
+template <typename T>
+void check_modes(arena* arena, const char* type_name, f64 tolerance) {
+	vector<T> in = make_uninitialized_vector<T>(arena, 5000);
+	for(index_type i = 0; i < length(in); ++i)
+		in.array[i] = (T)((f64)((i * 7919) % 1000) / 1000.0 - 0.5);
+
+	//Uneven, including empty blocks and blocks shorter than the filter
+	const index_type block_sizes[] = { 1, 17, 0, 333, 4, 1024, 2, 77, 3001 };
+	const index_type block_size_count = sizeof(block_sizes) / sizeof(block_sizes[0]);
+
+	for(index_type tap_count : { 1, 2, 3, 4, 7, 64, 65, 300, 1000 }) {
+		stack_arena_scope scope{ (stack_arena*)arena };
+
+		vector<T> taps = make_uninitialized_vector<T>(arena, tap_count);
+		for(index_type k = 0; k < tap_count; ++k)
+			taps.array[k] = (T)(std::sin(0.3 * (f64)k) / (f64)(k + 1));
+
+		fir_filter<T> direct = make_fir_filter(arena, taps, fir_direct);
+		fir_filter<T> overlap_save = make_fir_filter(arena, taps, fir_overlap_save);
+
+		f64 direct_error = max_error(arena, direct, taps, in, block_sizes, block_size_count);
+		f64 overlap_save_error = max_error(arena, overlap_save, taps, in, block_sizes, block_size_count);
+
+		std::cout << type_name << ", " << tap_count << " taps: direct " << (direct_error < tolerance ? "ok" : "wrong")
+			<< ", overlap-save " << (overlap_save_error < tolerance ? "ok" : "wrong")
+			<< " (max errors " << direct_error << ", " << overlap_save_error << ")" << std::endl;
+	}
+}
+}
+
+int main(int argc, char** argv) {
+	using namespace libaxl;
+
+	const size_type arena_size = 16U << 20;
+	dynamic_stack_arena arena{ new unsigned char[arena_size], arena_size };
+
+	check_modes<f64>(&arena, "f64", 1e-9);
+	check_modes<f32>(&arena, "f32", 1e-4);
+
+	{
+		stack_arena_scope scope{ &arena };
+
+		//A circular_buffer window through the vector_pair overload
+		vector_f64 taps = make_uninitialized_vector<f64>(&arena, 5);
+		fill(taps, 0.2);
+		fir_filter<f64> f = make_fir_filter(&arena, taps);
+
+		circular_buffer<f64> cb = make_circular_buffer<f64>(&arena, 8);
+		for(index_type i = 0; i < 8; ++i)
+			cb.buf_vector[i] = (f64)i;
+		cb = rotate_left(cb, 5);
+
+		vector_f64 out = make_uninitialized_vector<f64>(&arena, 8);
+		process(f, read(cb, 8), out);
+
+		std::cout << "moving average of ring [5, 6, 7, 0, 1, 2, 3, 4]:";
+		for(index_type i = 0; i < 8; ++i)
+			std::cout << " " << out[i];
+		std::cout << std::endl;
+	}
+
+	int in_char;
+	std::cin >> in_char;
+
+	return 0;
+}
@@ -0,0 +1,140 @@
+
+#include "../vectors.h"
+#include "../gather.h"
+#include "../lazy_eval/lazy_eval.h"
+#include "../stack_arena.h"
+#include <chrono>
+#include <iostream>
+
+namespace {
+using namespace libaxl;
+
+double seconds_since(std::chrono::steady_clock::time_point start) {
+	std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+	return elapsed.count();
+}
+
+void naive_transpose(const f64* in, f64* out, index_type rows, index_type cols) {
+	for(index_type i = 0; i < rows; ++i) {
+		for(index_type j = 0; j < cols; ++j)
+			out[j * rows + i] = in[i * cols + j];
+	}
+}
+
+void run_transpose(arena* arena, index_type rows, index_type cols, index_type repetitions) {
+	stack_arena_scope scope{ (stack_arena*)arena };
+
+	vector_f64 in = make_uninitialized_vector<f64>(arena, rows * cols);
+	vector_f64 out = make_uninitialized_vector<f64>(arena, rows * cols);
+	fill(in, 1.0);
+	fill(out, 0.0);
+
+	f64 check = 0.0;
+	f64 elements = (f64)rows * (f64)cols * (f64)repetitions * 1e-6;
+
+	auto start = std::chrono::steady_clock::now();
+	for(index_type r = 0; r < repetitions; ++r) {
+		naive_transpose(in.array, out.array, rows, cols);
+		check += out.array[r];
+	}
+	f64 naive_rate = elements / seconds_since(start);
+
+	start = std::chrono::steady_clock::now();
+	for(index_type r = 0; r < repetitions; ++r) {
+		transpose(in.array, cols, out.array, rows, rows, cols);
+		check += out.array[r];
+	}
+	f64 blocked_rate = elements / seconds_since(start);
+
+	std::cout << "transpose " << rows << " x " << cols
+		<< ": naive " << naive_rate << " M/s"
+		<< ", blocked " << blocked_rate << " M/s"
+		<< " (" << check << ")" << std::endl;
+}
+
+void run_column(arena* arena, index_type rows, index_type cols, index_type repetitions) {
+	stack_arena_scope scope{ (stack_arena*)arena };
+
+	vector_f64 matrix = make_uninitialized_vector<f64>(arena, rows * cols);
+	vector_f64 dest = make_uninitialized_vector<f64>(arena, rows);
+	vector_f64 expected = make_uninitialized_vector<f64>(arena, rows);
+	for(index_type i = 0; i < rows * cols; ++i)
+		matrix[i] = (f64)(i % 7);
+
+	vector_f64 column = { matrix.array, rows, cols };
+
+	f64 check = 0.0;
+	f64 elements = (f64)rows * (f64)repetitions * 1e-6;
+
+	auto start = std::chrono::steady_clock::now();
+	for(index_type r = 0; r < repetitions; ++r) {
+		assign(dest, shift(column, -1) + column * column + shift(column, 1));
+		check += dest.array[r];
+	}
+	f64 strided_rate = elements / seconds_since(start);
+	assign(expected, dest);
+
+	//Tiles shared by the three uses, reset by every assign
+	auto packed = pack(column, arena);
+	start = std::chrono::steady_clock::now();
+	for(index_type r = 0; r < repetitions; ++r) {
+		assign(dest, shift(packed, -1) + packed * packed + shift(packed, 1));
+		check += dest.array[r];
+	}
+	f64 packed_rate = elements / seconds_since(start);
+
+	index_type mismatches = 0;
+	for(index_type i = 0; i < rows; ++i)
+		mismatches += (dest[i] != expected[i]) ? 1 : 0;
+
+	std::cout << "column stencil, stride " << cols
+		<< ": strided " << strided_rate << " M/s"
+		<< ", packed " << packed_rate << " M/s"
+		<< ", mismatches " << mismatches
+		<< " (" << check << ")" << std::endl;
+
+	//Two uses more than a tile apart, each reads its own tile
+	start = std::chrono::steady_clock::now();
+	for(index_type r = 0; r < repetitions; ++r) {
+		assign(dest, shift(column, -300) + column);
+		check += dest.array[r];
+	}
+	strided_rate = elements / seconds_since(start);
+	assign(expected, dest);
+
+	start = std::chrono::steady_clock::now();
+	for(index_type r = 0; r < repetitions; ++r) {
+		assign(dest, shift(packed, -300) + packed);
+		check += dest.array[r];
+	}
+	packed_rate = elements / seconds_since(start);
+
+	mismatches = 0;
+	for(index_type i = 0; i < rows; ++i)
+		mismatches += (dest[i] != expected[i]) ? 1 : 0;
+
+	std::cout << "column shift(-300) + column, stride " << cols
+		<< ": strided " << strided_rate << " M/s"
+		<< ", packed " << packed_rate << " M/s"
+		<< ", mismatches " << mismatches
+		<< " (" << check << ")" << std::endl;
+}
+}
+
+int main(int argc, char** argv) {
+	using namespace libaxl;
+
+	const size_type arena_size = 1U << 30;
+	dynamic_stack_arena arena{ new unsigned char[arena_size], arena_size };
+
+	run_transpose(&arena, 4096, 4096, 4);
+	run_transpose(&arena, 1000, 3000, 4);
+
+	run_column(&arena, 1 << 20, 16, 4);
+	run_column(&arena, 1 << 16, 512, 4);
+
+	int in_char;
+	std::cin >> in_char;
+
+	return 0;
+}
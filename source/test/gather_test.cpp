@@ -0,0 +1,179 @@
+
+#include "../vectors.h"
+#include "../gather.h"
+#include "../lazy_eval/lazy_eval.h"
+#include "../stack_arena.h"
+#include <iostream>
+
+namespace {
+using namespace libaxl;
+
+template <typename T>
+T value_at(index_type i) {
+	return (T)((i * 13) % 1009) * (T)0.5;
+}
+
+//Every stride-th element of a buffer holding value_at(k) at k
+template <typename T>
+vector<T> make_strided(arena* arena, index_type count, index_type stride) {
+	index_type span = count > 0 ? (count - 1) * stride + 1 : 0;
+	vector<T> storage = make_uninitialized_vector<T>(arena, span);
+	for(index_type k = 0; k < span; ++k)
+		storage[k] = value_at<T>(k);
+
+	vector<T> result = { storage.array, count, stride };
+	return result;
+}
+
+//gather and scatter, forwards and through reverse (negative stride),
+//around the 4/8 element hardware gather steps
+template <typename T>
+index_type check_gather_scatter(arena* arena) {
+	index_type errors = 0;
+
+	for(index_type stride : { 1, 3, 16, 600 }) {
+		for(index_type count : { 0, 1, 3, 4, 7, 8, 9, 17, 1000 }) {
+			for(bool reversed : { false, true }) {
+				stack_arena_scope scope{ (stack_arena*)arena };
+
+				vector<T> in = make_strided<T>(arena, count, stride);
+				if(reversed && count > 0)
+					in = reverse(in);
+
+				vector<T> packed = make_uninitialized_vector<T>(arena, count + 1);
+				packed[count] = (T)-1;
+				vector<T> written = gather(in, packed);
+				errors += (length(written) != count || packed[count] != (T)-1) ? 1 : 0;
+				for(index_type i = 0; i < count; ++i)
+					errors += (written[i] != in[i]) ? 1 : 0;
+
+				//Back into a zeroed copy of the strided layout
+				vector<T> out = make_strided<T>(arena, count, stride);
+				for(index_type k = 0; k < (count > 0 ? (count - 1) * stride + 1 : 0); ++k)
+					out.array[k] = (T)0;
+				if(reversed && count > 0)
+					out = reverse(out);
+				scatter(written, out);
+				for(index_type i = 0; i < count; ++i)
+					errors += (out[i] != in[i]) ? 1 : 0;
+
+				//The elements between the strided ones are left alone
+				T* first = reversed && count > 0 ? out.array + (count - 1) * out.stride : out.array;
+				for(index_type k = 0; k < (count > 0 ? (count - 1) * stride + 1 : 0); ++k)
+					errors += (k % stride != 0 && first[k] != (T)0) ? 1 : 0;
+			}
+		}
+	}
+
+	return errors;
+}
+
+//Around the 4 x 4 register blocks and the 32 x 32 tiles, with row
+//strides wider than the rows; the padding of out must stay untouched
+template <typename T>
+index_type check_transpose(arena* arena) {
+	const index_type shapes[][2] = { { 0, 5 }, { 5, 0 }, { 1, 1 }, { 3, 5 }, { 4, 4 }, { 4, 9 }, { 33, 65 }, { 100, 37 } };
+
+	index_type errors = 0;
+
+	for(auto& shape : shapes) {
+		stack_arena_scope scope{ (stack_arena*)arena };
+
+		index_type rows = shape[0];
+		index_type cols = shape[1];
+		index_type in_row_stride = cols + 3;
+		index_type out_row_stride = rows + 2;
+
+		vector<T> in = make_uninitialized_vector<T>(arena, rows * in_row_stride);
+		vector<T> out = make_uninitialized_vector<T>(arena, cols * out_row_stride);
+		for(index_type k = 0; k < length(in); ++k)
+			in[k] = value_at<T>(k);
+		for(index_type k = 0; k < length(out); ++k)
+			out[k] = (T)-1;
+
+		transpose(in.array, in_row_stride, out.array, out_row_stride, rows, cols);
+
+		for(index_type j = 0; j < cols; ++j) {
+			for(index_type i = 0; i < out_row_stride; ++i) {
+				T expected = i < rows ? in[i * in_row_stride + j] : (T)-1;
+				errors += (out[j * out_row_stride + i] != expected) ? 1 : 0;
+			}
+		}
+	}
+
+	return errors;
+}
+
+//Packed expressions against the same expressions on the strided
+//leaf, the arithmetic is the same so the results are equal
+template <typename T>
+index_type check_pack(arena* arena) {
+	stack_arena_scope scope{ (stack_arena*)arena };
+
+	index_type errors = 0;
+
+	for(index_type count : { 1, 255, 256, 257, 5000 }) {
+		vector<T> column = make_strided<T>(arena, count, 9);
+		auto p = pack(column, arena);
+		vector<T> expected = make_uninitialized_vector<T>(arena, count);
+		vector<T> dest = make_uninitialized_vector<T>(arena, count);
+
+		auto compare = [&]() {
+			for(index_type i = 0; i < count; ++i)
+				errors += (dest[i] != expected[i]) ? 1 : 0;
+		};
+
+		//A stencil, uses one tile apart
+		assign(expected, shift(column, -1) + column * column + shift(column, 1));
+		assign(dest, shift(p, -1) + p * p + shift(p, 1));
+		compare();
+
+		assign(expected, shift(column, -300) + column);
+		assign(dest, shift(p, -300) + p);
+		compare();
+
+		//Uses spanning more tiles than are kept
+		assign(expected, shift(column, -1000) + shift(column, -600) + shift(column, -300) + column
+			+ shift(column, 300) + shift(column, 700));
+		assign(dest, shift(p, -1000) + shift(p, -600) + shift(p, -300) + p + shift(p, 300) + shift(p, 700));
+		compare();
+
+		//Periodic reads jump back to the first tiles
+		assign(expected, shift<boundary_wrap>(column, 7) - shift<boundary_wrap>(column, -290));
+		assign(dest, shift<boundary_wrap>(p, 7) - shift<boundary_wrap>(p, -290));
+		compare();
+
+		//assign drops the gathered tiles, changes to the source are seen
+		for(index_type i = 0; i < count; i += 2)
+			column[i] = (T)i;
+		assign(expected, shift(column, 5) * column);
+		assign(dest, shift(p, 5) * p);
+		compare();
+	}
+
+	return errors;
+}
+
+template <typename T>
+void check_all(arena* arena, const char* type_name) {
+	std::cout << type_name << ": gather/scatter mismatches " << check_gather_scatter<T>(arena)
+		<< ", transpose " << check_transpose<T>(arena)
+		<< ", pack " << check_pack<T>(arena) << " (0)" << std::endl;
+}
+}
+
+int main(int argc, char** argv) {
+	using namespace libaxl;
+
+	const size_type arena_size = 16U << 20;
+	dynamic_stack_arena arena{ new unsigned char[arena_size], arena_size };
+
+	check_all<f64>(&arena, "f64");
+	check_all<f32>(&arena, "f32");
+	check_all<int32_t>(&arena, "s32");
+
+	int in;
+	std::cin >> in;
+
+	return 0;
+}
@@ -0,0 +1,98 @@
+
+#include "../vectors.h"
+#include "../matrix.h"
+#include "../stack_arena.h"
+#include <chrono>
+#include <iostream>
+
+namespace {
+using namespace libaxl;
+
+double seconds_since(std::chrono::steady_clock::time_point start) {
+	std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+	return elapsed.count();
+}
+
+void naive_gemm(matrix<f64> a, matrix<f64> b, matrix<f64> c) {
+	for(index_type i = 0; i < a.rows; ++i) {
+		for(index_type j = 0; j < b.cols; ++j) {
+			f64 sum = 0.0;
+			for(index_type k = 0; k < a.cols; ++k)
+				sum += a(i, k) * b(k, j);
+			c(i, j) = sum;
+		}
+	}
+}
+
+void run(arena* arena, index_type size, index_type repetitions) {
+	stack_arena_scope scope{ (stack_arena*)arena };
+
+	matrix<f64> a = make_uninitialized_matrix<f64>(arena, size, size);
+	matrix<f64> b = make_uninitialized_matrix<f64>(arena, size, size);
+	matrix<f64> c = zeros_matrix<f64>(arena, size, size);
+	vector_f64 x = make_uninitialized_vector<f64>(arena, size);
+	vector_f64 y = make_uninitialized_vector<f64>(arena, size);
+
+	for(index_type i = 0; i < size * size; ++i) {
+		a.array[i] = (f64)(i % 7) * 0.25;
+		b.array[i] = (f64)(i % 5) * 0.5;
+	}
+	fill(x, 1.0);
+
+	f64 check = 0.0;
+	f64 flops = 2.0 * (f64)size * (f64)size * (f64)size * (f64)repetitions * 1e-9;
+
+	auto start = std::chrono::steady_clock::now();
+	for(index_type r = 0; r < repetitions; ++r) {
+		naive_gemm(a, b, c);
+		check += c.array[r];
+	}
+	f64 naive_rate = flops / seconds_since(start);
+
+	start = std::chrono::steady_clock::now();
+	for(index_type r = 0; r < repetitions; ++r) {
+		stack_arena_scope scratch{ (stack_arena*)arena };
+		gemm(arena, 1.0, a, b, 0.0, c);
+		check += c.array[r];
+	}
+	f64 gemm_rate = flops / seconds_since(start);
+
+	start = std::chrono::steady_clock::now();
+	for(index_type r = 0; r < repetitions; ++r) {
+		stack_arena_scope scratch{ (stack_arena*)arena };
+		gemm(arena, 1.0, transpose(a), b, 0.0, c);
+		check += c.array[r];
+	}
+	f64 transposed_rate = flops / seconds_since(start);
+
+	start = std::chrono::steady_clock::now();
+	for(index_type r = 0; r < repetitions * size; ++r) {
+		gemv(arena, 1.0, a, x, 0.0, y);
+		check += y.array[r % size];
+	}
+	f64 gemv_rate = flops / seconds_since(start);
+
+	std::cout << "size " << size
+		<< ": naive " << naive_rate << " GFLOP/s"
+		<< ", gemm " << gemm_rate << " GFLOP/s"
+		<< ", gemm A^T " << transposed_rate << " GFLOP/s"
+		<< ", gemv " << gemv_rate << " GFLOP/s"
+		<< " (" << check << ")" << std::endl;
+}
+}
+
+int main(int argc, char** argv) {
+	using namespace libaxl;
+
+	const size_type arena_size = 1U << 28;
+	dynamic_stack_arena arena{ new unsigned char[arena_size], arena_size };
+
+	run(&arena, 32, 2000);
+	run(&arena, 128, 40);
+	run(&arena, 512, 2);
+
+	int in_char;
+	std::cin >> in_char;
+
+	return 0;
+}
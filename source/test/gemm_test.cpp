@@ -0,0 +1,180 @@
+
+#include "../vectors.h"
+#include "../matrix.h"
+#include "../stack_arena.h"
+#include <cmath>
+#include <iostream>
+
+namespace {
+using namespace libaxl;
+
+//Small multiples of 0.5, so every product and sum below is exact and
+//any summation order gives the same result
+template <typename T>
+void fill_pattern(matrix<T> m, index_type seed) {
+	for(index_type i = 0; i < m.rows; ++i) {
+		for(index_type j = 0; j < m.cols; ++j)
+			m(i, j) = (T)((i * 7 + j * 3 + seed) % 11 - 5) * (T)0.5;
+	}
+}
+
+//A strided view: a row-major matrix of twice the columns, every other
+//column, so neither stride is 1
+template <typename T>
+matrix<T> make_strided_matrix(arena* arena, index_type rows, index_type cols) {
+	matrix<T> result = make_uninitialized_matrix<T>(arena, rows, 2 * cols);
+	result.cols = cols;
+	result.col_stride = 2;
+	return result;
+}
+
+template <typename T>
+void naive_gemm(T alpha, matrix<T> a, matrix<T> b, T beta, matrix<T> c) {
+	for(index_type i = 0; i < a.rows; ++i) {
+		for(index_type j = 0; j < b.cols; ++j) {
+			T sum = 0;
+			for(index_type k = 0; k < a.cols; ++k)
+				sum += a(i, k) * b(k, j);
+			c(i, j) = alpha * sum + ((beta == T()) ? T() : beta * c(i, j));
+		}
+	}
+}
+
+template <typename T>
+index_type mismatches(matrix<T> result, matrix<T> expected) {
+	index_type count = 0;
+	for(index_type i = 0; i < result.rows; ++i) {
+		for(index_type j = 0; j < result.cols; ++j)
+			count += (result(i, j) != expected(i, j)) ? 1 : 0;
+	}
+	return count;
+}
+
+//A is m x k, B is k x n, each stored row-major or as the transpose of
+//a row-major matrix; C is a strided view holding NaN when beta is 0
+template <typename T>
+index_type check_gemm(arena* arena, index_type m, index_type n, index_type k,
+	bool transpose_a, bool transpose_b, T alpha, T beta)
+{
+	stack_arena_scope scope{ (stack_arena*)arena };
+
+	matrix<T> a = transpose_a ? transpose(make_uninitialized_matrix<T>(arena, k, m)) : make_uninitialized_matrix<T>(arena, m, k);
+	matrix<T> b = transpose_b ? transpose(make_uninitialized_matrix<T>(arena, n, k)) : make_uninitialized_matrix<T>(arena, k, n);
+	matrix<T> c = make_strided_matrix<T>(arena, m, n);
+	matrix<T> expected = make_uninitialized_matrix<T>(arena, m, n);
+
+	fill_pattern(a, 1);
+	fill_pattern(b, 4);
+	fill_pattern(c, 9);
+	fill_pattern(expected, 9);
+	if(beta == T() && m > 0 && n > 0)
+		c(0, 0) = (T)NAN;
+
+	naive_gemm(alpha, a, b, beta, expected);
+	gemm(arena, alpha, a, b, beta, c);
+
+	return mismatches(c, expected);
+}
+
+template <typename T>
+void check_gemm_shapes(arena* arena, const char* type_name) {
+	//Around the micro kernel (4 x 8) and the kc (256), mc (128) and
+	//nc (2048) blocks
+	const index_type shapes[][3] = {
+		{ 0, 5, 3 }, { 3, 0, 5 }, { 4, 8, 0 }, { 1, 1, 1 }, { 3, 5, 7 }, { 4, 8, 16 },
+		{ 13, 17, 257 }, { 129, 9, 31 }, { 5, 2051, 3 }, { 130, 33, 300 }
+	};
+
+	index_type errors = 0;
+	index_type runs = 0;
+
+	for(auto& shape : shapes) {
+		for(int layout = 0; layout < 4; ++layout) {
+			errors += check_gemm<T>(arena, shape[0], shape[1], shape[2], (layout & 1) != 0, (layout & 2) != 0, (T)1, (T)0);
+			errors += check_gemm<T>(arena, shape[0], shape[1], shape[2], (layout & 1) != 0, (layout & 2) != 0, (T)0.5, (T)2);
+			runs += 2;
+		}
+	}
+
+	std::cout << "gemm<" << type_name << ">: " << runs << " products, mismatches " << errors << " (0)" << std::endl;
+}
+
+//A in the three layouts gemv tells apart, x and y contiguous or strided
+template <typename T>
+index_type check_gemv(arena* arena, index_type m, index_type n, int layout, bool strided, T alpha, T beta) {
+	stack_arena_scope scope{ (stack_arena*)arena };
+
+	matrix<T> a = layout == 0 ? make_uninitialized_matrix<T>(arena, m, n)
+		: (layout == 1 ? transpose(make_uninitialized_matrix<T>(arena, n, m)) : make_strided_matrix<T>(arena, m, n));
+	fill_pattern(a, 2);
+
+	index_type step = strided ? 3 : 1;
+	vector<T> x_storage = make_uninitialized_vector<T>(arena, n * step);
+	vector<T> y_storage = make_uninitialized_vector<T>(arena, m * step);
+	vector<T> x = { x_storage.array, n, step };
+	vector<T> y = { y_storage.array, m, step };
+
+	matrix<T> x_column = { x.array, n, 1, step, 1 };
+	matrix<T> y_column = { y.array, m, 1, step, 1 };
+	matrix<T> expected = make_uninitialized_matrix<T>(arena, m, 1);
+	fill_pattern(x_column, 5);
+	fill_pattern(y_column, 6);
+	fill_pattern(expected, 6);
+
+	naive_gemm(alpha, a, x_column, beta, expected);
+	gemv(arena, alpha, a, x, beta, y);
+
+	return mismatches(y_column, expected);
+}
+
+template <typename T>
+void check_gemv_shapes(arena* arena, const char* type_name) {
+	const index_type shapes[][2] = { { 0, 4 }, { 4, 0 }, { 1, 1 }, { 3, 5 }, { 17, 33 }, { 130, 257 } };
+
+	index_type errors = 0;
+	index_type runs = 0;
+
+	for(auto& shape : shapes) {
+		for(int layout = 0; layout < 3; ++layout) {
+			for(bool strided : { false, true }) {
+				errors += check_gemv<T>(arena, shape[0], shape[1], layout, strided, (T)1, (T)0);
+				errors += check_gemv<T>(arena, shape[0], shape[1], layout, strided, (T)-0.5, (T)1.5);
+				runs += 2;
+			}
+		}
+	}
+
+	std::cout << "gemv<" << type_name << ">: " << runs << " products, mismatches " << errors << " (0)" << std::endl;
+}
+}
+
+int main(int argc, char** argv) {
+	using namespace libaxl;
+
+	const size_type arena_size = 1U << 26;
+	dynamic_stack_arena arena{ new unsigned char[arena_size], arena_size };
+
+	check_gemm_shapes<f64>(&arena, "f64");
+	check_gemm_shapes<f32>(&arena, "f32");
+	check_gemv_shapes<f64>(&arena, "f64");
+	check_gemv_shapes<f32>(&arena, "f32");
+
+	{
+		stack_arena_scope scope{ &arena };
+
+		matrix<f64> a = make_uninitialized_matrix<f64>(&arena, 6, 10);
+		matrix<f64> b = make_uninitialized_matrix<f64>(&arena, 10, 7);
+		matrix<f64> expected = make_uninitialized_matrix<f64>(&arena, 6, 7);
+		fill_pattern(a, 0);
+		fill_pattern(b, 3);
+		naive_gemm(1.0, a, b, 0.0, expected);
+
+		matrix<f64> c = gemm(&arena, a, b);
+		std::cout << "allocating gemm: " << c.rows << " x " << c.cols << ", mismatches " << mismatches(c, expected) << " (0)" << std::endl;
+	}
+
+	int in;
+	std::cin >> in;
+
+	return 0;
+}
@@ -0,0 +1,85 @@
+
+//Build twice, with and without LIBAXL_INDEX_64, and compare the rates.
+
+#include "../vectors.h"
+#include "../vector_f64.h"
+#include "../lazy_eval/lazy_eval.h"
+#include "../circular_buffer.h"
+#include "../stack_arena.h"
+#include <chrono>
+#include <iostream>
+
+namespace {
+using namespace libaxl;
+
+double seconds_since(std::chrono::steady_clock::time_point start) {
+	std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+	return elapsed.count();
+}
+
+f64 strided_sum(vector_f64 v) {
+	f64 result = 0.0;
+	for(index_type i = 0; i < length(v); ++i)
+		result += v[i];
+	return result;
+}
+
+f64 ring_sum(circular_buffer<f64> cb, index_type window) {
+	vector_pair<f64> contents = read(cb, window);
+	return strided_sum(first(contents)) + strided_sum(second(contents));
+}
+
+void run(arena* arena, index_type count, index_type repetitions) {
+	stack_arena_scope scope{ (stack_arena*)arena };
+
+	vector_f64 a = ramp_f64(arena, count);
+	vector_f64 b = ones_f64(arena, count);
+	vector_f64 c = ramp_f64(arena, count);
+	vector_f64 dest = make_uninitialized_vector<f64>(arena, count);
+	circular_buffer<f64> cb = rotate_left(make_circular_buffer(c, 0), count / 3);
+
+	f64 check = 0.0;
+	f64 elements = (f64)count * (f64)repetitions * 1e-6;
+
+	auto start = std::chrono::steady_clock::now();
+	for(index_type r = 0; r < repetitions; ++r) {
+		assign(dest, a * b + c);
+		check += dest.array[r % count];
+	}
+	f64 eval_rate = elements / seconds_since(start);
+
+	start = std::chrono::steady_clock::now();
+	for(index_type r = 0; r < repetitions; ++r)
+		check += strided_sum(drop_odd(a)) + strided_sum(drop_even(a));
+	f64 strided_rate = elements / seconds_since(start);
+
+	start = std::chrono::steady_clock::now();
+	for(index_type r = 0; r < repetitions; ++r)
+		check += ring_sum(cb, count);
+	f64 ring_rate = elements / seconds_since(start);
+
+	std::cout << "count " << count
+		<< ": eval " << eval_rate << " M/s"
+		<< ", strided " << strided_rate << " M/s"
+		<< ", ring " << ring_rate << " M/s"
+		<< " (" << check << ")" << std::endl;
+}
+}
+
+int main(int argc, char** argv) {
+	using namespace libaxl;
+
+	const size_type arena_size = 1U << 30;
+	dynamic_stack_arena arena{ new unsigned char[arena_size], arena_size };
+
+	std::cout << "sizeof(index_type) = " << sizeof(index_type) << std::endl;
+
+	//Cache resident, then memory bound
+	run(&arena, 4096, 20000);
+	run(&arena, 16 << 20, 4);
+
+	int in_char;
+	std::cin >> in_char;
+
+	return 0;
+}
@@ -0,0 +1,79 @@
+
+//Build twice, with and without LIBAXL_INDEX_64.
+
+#include "../vectors.h"
+#include "../vector_f64.h"
+#include "../lazy_eval/lazy_eval.h"
+#include "../circular_buffer.h"
+#include "../stack_arena.h"
+#include <iostream>
+
+#if defined(LIBAXL_INDEX_64) && !defined(_WIN32)
+#include <sys/mman.h>
+#endif
+
+template <typename T>
+void print_vector(libaxl::vector<T> v) {
+	std::cout << "[";
+	for(libaxl::index_type i = 0; i < libaxl::length(v); ++i)
+		std::cout << (i > 0 ? ", " : "") << v[i];
+	std::cout << "]" << std::endl;
+}
+
+int main(int argc, char** argv) {
+	using namespace libaxl;
+
+	fixed_stack_arena<4096> arena;
+
+	std::cout << "sizeof(index_type) = " << sizeof(index_type)
+		<< ", sizeof(vector<f64>) = " << sizeof(vector<f64>)
+		<< ", index_type_max = " << (int64_t)index_type_max << std::endl;
+
+	//The same results in both modes
+	vector_f64 v = iota_f64(&arena, 7);
+	print_vector(reverse(drop_even(v)));
+	print_vector(eval(take(v, 4) * constant(2.0) + drop(v, 3), &arena));
+
+	circular_buffer<f64> cb = rotate_left(make_circular_buffer(v, 0), 5);
+	std::cout << "read(cb, 3): ";
+	print_vector(first(read(cb, 3)));
+	std::cout << "ring_index(2^40 + 3, 7) = " << ring_index(((size_type)1 << 40) + 3, 7)
+		<< " (" << (((int64_t)1 << 40) + 3) % 7 << ")" << std::endl;
+
+#if defined(LIBAXL_INDEX_64) && !defined(_WIN32)
+	{
+		//A vector of 5 * 2^30 bytes, only the touched pages get memory
+		const index_type count = (index_type)5 << 30;
+		void* memory = mmap(nullptr, (size_type)count, PROT_READ | PROT_WRITE,
+			MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+
+		if(memory == MAP_FAILED) {
+			std::cout << "large mapping failed, skipped" << std::endl;
+		} else {
+			vector<unsigned char> big;
+			big.array = (unsigned char*)memory;
+			big.count = count;
+			big.stride = 1;
+
+			index_type far = count - 3;
+			big[far] = 42;
+			big[(index_type)1 << 32] = 7;
+
+			vector<unsigned char> tail = drop(big, far);
+			vector<unsigned char> strided = drop_odd(big);
+			std::cout << "length " << length(big)
+				<< ", drop(big, count - 3)[0] = " << (int)tail[0]
+				<< ", reverse(big)[2] = " << (int)reverse(big)[2]
+				<< ", drop_odd(big)[2^31] = " << (int)strided[(index_type)1 << 31]
+				<< ", length(drop_odd(big)) = " << length(strided) << std::endl;
+
+			munmap(memory, (size_type)count);
+		}
+	}
+#endif
+
+	int in;
+	std::cin >> in;
+
+	return 0;
+}
@@ -0,0 +1,246 @@
+
+#include "../vectors.h"
+#include "../io_vec.h"
+#include "../stack_arena.h"
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <thread>
+#include <vector>
+#include <pthread.h>
+#include <signal.h>
+
+namespace {
+using namespace libaxl;
+
+//Interrupts a writev blocked on a full pipe, which then returns the
+//bytes written so far
+void on_signal(int) {}
+
+//Element i of every test stream is i * 3 + 1
+int32_t value_at(index_type i) {
+	return (int32_t)(i * 3 + 1);
+}
+
+//count elements as a vector_list of segments of 1, 2, ... 9 elements,
+//each in its own arena block
+vector_list<int32_t> make_segments(arena* arena, index_type count) {
+	index_type segment_total = 0;
+	for(index_type covered = 0; covered < count; ++segment_total)
+		covered += segment_total % 9 + 1;
+
+	vector_list<int32_t> result = make_vector_list<int32_t>(arena, segment_total);
+	index_type covered = 0;
+	for(index_type i = 0; i < segment_total; ++i) {
+		index_type n = minimum(i % 9 + 1, count - covered);
+		result.v[i] = make_uninitialized_vector<int32_t>(arena, n);
+		covered += n;
+	}
+	return result;
+}
+
+void fill_values(vector_list<int32_t> vl) {
+	index_type at = 0;
+	for(index_type i = 0; i < segment_count(vl); ++i) {
+		for(index_type j = 0; j < length(segment(vl, i)); ++j)
+			segment(vl, i)[j] = value_at(at++);
+	}
+}
+
+index_type mismatches(vector_list<int32_t> vl) {
+	index_type result = 0;
+	index_type at = 0;
+	for(index_type i = 0; i < segment_count(vl); ++i) {
+		for(index_type j = 0; j < length(segment(vl, i)); ++j)
+			result += (segment(vl, i)[j] != value_at(at++)) ? 1 : 0;
+	}
+	return result;
+}
+
+bool same_segments(io_vec io, const std::vector<io_segment>& saved) {
+	for(index_type i = 0; i < io.count; ++i) {
+		if(io.segments[i].iov_base != saved[(size_t)i].iov_base || io.segments[i].iov_len != saved[(size_t)i].iov_len)
+			return false;
+	}
+	return true;
+}
+
+//Reads from a pipe fed three bytes at a time, so every readv returns
+//short, most of them inside an element
+void check_short_reads(arena* arena) {
+	stack_arena_scope scope{ (stack_arena*)arena };
+
+	const index_type count = 200;
+	std::vector<int32_t> source((size_t)count);
+	for(index_type i = 0; i < count; ++i)
+		source[(size_t)i] = value_at(i);
+
+	int fds[2];
+	if(pipe(fds) != 0) {
+		std::cout << "short reads: no pipe" << std::endl;
+		return;
+	}
+
+	std::thread feeder([&]() {
+		auto bytes = (const unsigned char*)source.data();
+		size_type size = (size_type)count * sizeof(int32_t);
+		for(size_type at = 0; at < size; at += 3) {
+			if(write(fds[1], bytes + at, (size_t)minimum<size_type>(3, size - at)) < 0)
+				break;
+			usleep(100);
+		}
+		close(fds[1]);
+	});
+
+	vector_list<int32_t> vl = make_segments(arena, count);
+	io_vec io = make_io_vec(arena, vl);
+	std::vector<io_segment> saved(io.segments, io.segments + io.count);
+
+	int64_t bytes = read_segments(fds[0], io);
+	feeder.join();
+
+	//The pipe is drained and closed, another read is at the end
+	io_segment one = { io.segments[0].iov_base, io.segments[0].iov_len };
+	io_vec more = { &one, 1, 1 };
+	int64_t after_end = read_segments(fds[0], more);
+	close(fds[0]);
+
+	std::cout << "short reads into " << segment_count(vl) << " segments: " << bytes << " bytes ("
+		<< count * (index_type)sizeof(int32_t) << "), mismatches " << mismatches(vl)
+		<< ", segments restored " << same_segments(io, saved) << ", read after the end " << after_end << " (0)" << std::endl;
+}
+
+//Writes more than a pipe holds while a slow reader drains it and the
+//writing thread is interrupted, so writev returns short
+void check_short_writes(arena* arena) {
+	stack_arena_scope scope{ (stack_arena*)arena };
+
+	struct sigaction action = {};
+	struct sigaction previous;
+	action.sa_handler = on_signal;
+	sigemptyset(&action.sa_mask);
+	sigaction(SIGUSR1, &action, &previous);
+
+	const index_type count = 1 << 18;
+	vector_list<int32_t> vl = make_segments(arena, count);
+	fill_values(vl);
+	io_vec io = make_io_vec(arena, vl);
+	std::vector<io_segment> saved(io.segments, io.segments + io.count);
+
+	int fds[2];
+	if(pipe(fds) != 0) {
+		std::cout << "short writes: no pipe" << std::endl;
+		return;
+	}
+
+	std::vector<unsigned char> received;
+	std::atomic<bool> writing{ true };
+	pthread_t writer = pthread_self();
+
+	std::thread drain([&]() {
+		unsigned char chunk[4096];
+		for(;;) {
+			if(writing.load())
+				pthread_kill(writer, SIGUSR1);
+			usleep(200);
+			ssize_t got = read(fds[0], chunk, sizeof(chunk));
+			if(got <= 0)
+				break;
+			received.insert(received.end(), chunk, chunk + got);
+		}
+	});
+
+	bool ok = write_segments(fds[1], io);
+	writing.store(false);
+	close(fds[1]);
+	drain.join();
+	close(fds[0]);
+	sigaction(SIGUSR1, &previous, nullptr);
+
+	index_type errors = (received.size() != (size_t)count * sizeof(int32_t)) ? 1 : 0;
+	for(index_type i = 0; errors == 0 && i < count; ++i) {
+		int32_t value;
+		memcpy(&value, received.data() + (size_t)i * sizeof(int32_t), sizeof(value));
+		errors += (value != value_at(i)) ? 1 : 0;
+	}
+
+	std::cout << "short writes of " << segment_count(vl) << " segments: ok " << ok << ", " << received.size()
+		<< " bytes received, mismatches " << errors << ", segments restored " << same_segments(io, saved) << std::endl;
+}
+
+//Round trips through a temporary file with more segments than one
+//writev takes, and the reads that run into the end of the file
+void check_file(arena* arena) {
+	stack_arena_scope scope{ (stack_arena*)arena };
+
+	FILE* temporary = tmpfile();
+	if(!temporary) {
+		std::cout << "file: no tmpfile" << std::endl;
+		return;
+	}
+	int fd = fileno(temporary);
+
+	//Written at an offset, read back at the current position with a
+	//different segmentation
+	const index_type count = 8000;
+	vector_list<int32_t> out = make_segments(arena, count);
+	fill_values(out);
+	bool written = write_segments_at(fd, make_io_vec(arena, out), 0);
+
+	vector<int32_t> whole = make_uninitialized_vector<int32_t>(arena, count);
+	vector_list<int32_t> in = make_vector_list<int32_t>(arena, make_vector_pair(take(whole, 1234), drop(whole, 1234)));
+	int64_t bytes = read_segments(fd, make_io_vec(arena, in));
+	std::cout << "file, " << segment_count(out) << " segments: written " << written << ", read " << bytes
+		<< " bytes (" << count * (index_type)sizeof(int32_t) << "), mismatches " << mismatches(in) << std::endl;
+
+	//Ten elements and two stray bytes, read into a pair of eight each
+	const unsigned char stray[2] = { 0xAB, 0xCD };
+	vector_list<int32_t> ten = make_segments(arena, 10);
+	fill_values(ten);
+	io_vec tail = make_io_vec(arena, segment_count(ten) + 1);
+	add(tail, ten);
+	add(tail, stray, sizeof(stray));
+	bool rewritten = ftruncate(fd, 0) == 0 && write_segments_at(fd, tail, 0);
+
+	vector<int32_t> storage = make_uninitialized_vector<int32_t>(arena, 16);
+	vector_pair<int32_t> vp = make_vector_pair(take(storage, 8), drop(storage, 8));
+	size_type partial_bytes = 99;
+	lseek(fd, 0, SEEK_SET);
+	index_type elements = read_segments(fd, vp, &partial_bytes);
+
+	index_type errors = 0;
+	for(index_type i = 0; i < elements; ++i)
+		errors += (storage[i] != value_at(i)) ? 1 : 0;
+	errors += (memcmp(&storage[10], stray, sizeof(stray)) != 0) ? 1 : 0;
+
+	size_type at_end_partial = 99;
+	index_type at_end = read_segments(fd, vp, &at_end_partial);
+
+	io_segment one = { storage.array, sizeof(int32_t) };
+	io_vec past = { &one, 1, 1 };
+	int64_t past_end = read_segments_at(fd, past, 1 << 20);
+
+	std::cout << "file ending inside an element: rewritten " << rewritten << ", " << elements << " elements (10), "
+		<< partial_bytes << " partial bytes (2), mismatches " << errors << ", then " << at_end << " elements, "
+		<< at_end_partial << " partial bytes, past the end " << past_end << " bytes" << std::endl;
+
+	fclose(temporary);
+}
+}
+
+int main(int argc, char** argv) {
+	using namespace libaxl;
+
+	const size_type arena_size = 16U << 20;
+	dynamic_stack_arena arena{ new unsigned char[arena_size], arena_size };
+
+	check_short_reads(&arena);
+	check_short_writes(&arena);
+	check_file(&arena);
+
+	int in;
+	std::cin >> in;
+
+	return 0;
+}
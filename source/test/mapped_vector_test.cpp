@@ -0,0 +1,116 @@
+
+#include "../vectors.h"
+#include "../mapped_vector.h"
+#include <cstdio>
+#include <iostream>
+
+namespace {
+using namespace libaxl;
+
+const char* path = "mapped_vector_test.bin";
+
+//Element i of the test file is i * 0.5
+bool write_test_file(index_type count) {
+	FILE* file = fopen(path, "wb");
+	if(!file)
+		return false;
+
+	for(index_type i = 0; i < count; ++i) {
+		f64 value = (f64)i * 0.5;
+		fwrite(&value, sizeof(value), 1, file);
+	}
+
+	return fclose(file) == 0;
+}
+
+index_type mismatches(vector<f64> v, index_type first_element) {
+	index_type result = 0;
+	for(index_type i = 0; i < length(v); ++i)
+		result += (v[i] != (f64)(first_element + i) * 0.5) ? 1 : 0;
+	return result;
+}
+}
+
+int main(int argc, char** argv) {
+	using namespace libaxl;
+
+	//A few pages, and a tail that is not a whole page
+	const index_type count = 3000;
+	if(!write_test_file(count)) {
+		std::cout << "could not write " << path << std::endl;
+		return 1;
+	}
+
+	{
+		vector<f64> whole = map_vector<f64>(path);
+		mapped_vector_scope<f64> scope{ &whole };
+
+		std::cout << "whole file: " << length(whole) << " elements, mismatches " << mismatches(whole, 0)
+			<< ", reverse(whole)[0] " << reverse(whole)[0] << " (1499.5)" << std::endl;
+		std::cout << "advise sequential: " << advise(whole, map_advice_sequential)
+			<< ", willneed on a view: " << advise(drop(take(whole, 1000), 3), map_advice_willneed) << std::endl;
+	}
+
+	{
+		//Offsets need not be multiples of the page size
+		vector<f64> range = map_vector<f64>(path, 1001 * sizeof(f64), 1500);
+		std::cout << "elements 1001..2500: " << length(range) << " elements, mismatches " << mismatches(range, 1001) << std::endl;
+		unmap_vector(range);
+		std::cout << "unmapped: " << (range.array == nullptr && length(range) == 0) << std::endl;
+	}
+
+	{
+		vector<f64> beyond = map_vector<f64>(path, 2990 * sizeof(f64), 11);
+		vector<f64> missing = map_vector<f64>("mapped_vector_test_missing.bin");
+		std::cout << "range past the end fails: " << (beyond.array == nullptr && length(beyond) == 0)
+			<< ", missing file fails: " << (missing.array == nullptr && length(missing) == 0) << std::endl;
+	}
+
+	{
+		//Shared writes reach the file
+		vector<f64> writable = map_vector<f64>(path, 8 * sizeof(f64), 4, map_read_write);
+		fill(writable, -1.0);
+		unmap_vector(writable);
+
+		FILE* file = fopen(path, "rb");
+		f64 values[12] = {};
+		size_t read_count = file ? fread(values, sizeof(f64), 12, file) : 0;
+		if(file)
+			fclose(file);
+
+		std::cout << "after map_read_write fill: " << read_count << " read,";
+		for(index_type i = 6; i < 12; ++i)
+			std::cout << " " << values[i];
+		std::cout << std::endl;
+	}
+
+	{
+		//A trailing partial element fails the whole file mapping
+		FILE* file = fopen(path, "ab");
+		if(file) {
+			fputs("abc", file);
+			fclose(file);
+		}
+		vector<f64> partial = map_vector<f64>(path);
+		vector<unsigned char> bytes = map_vector<unsigned char>(path);
+		std::cout << "partial trailing element fails: " << (partial.array == nullptr && length(partial) == 0)
+			<< ", as bytes: " << length(bytes) << " (" << count * (index_type)sizeof(f64) + 3 << ")" << std::endl;
+		unmap_vector(bytes);
+	}
+
+#if !defined(_WIN32) && !defined(LIBAXL_INDEX_64)
+	{
+		//A sparse 2 GiB file holds one byte more than index_type counts
+		bool sized = truncate(path, (off_t)index_type_max + 1) == 0;
+		vector<unsigned char> huge = map_vector<unsigned char>(path);
+		std::cout << "more than index_type_max elements fails: " << (sized && huge.array == nullptr && length(huge) == 0) << std::endl;
+	}
+#endif
+
+	remove(path);
+
+	int in;
+	std::cin >> in;
+
+	return 0;
+}
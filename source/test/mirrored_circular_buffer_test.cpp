@@ -0,0 +1,78 @@
+
+#include "../vectors.h"
+#include "../mirrored_circular_buffer.h"
+#include <iostream>
+
+namespace {
+using namespace libaxl;
+
+//The window as the plain circular_buffer sees it, for comparison
+bool same_elements(vector<int32_t> window, vector_pair<int32_t> expected) {
+	if(length(window) != length(expected))
+		return false;
+
+	for(index_type i = 0; i < length(window); ++i) {
+		if(window[i] != expected[i])
+			return false;
+	}
+
+	return true;
+}
+}
+
+int main(int argc, char** argv) {
+	using namespace libaxl;
+
+	auto mcb = make_mirrored_circular_buffer<int32_t>(1);
+	if(!mcb.buf_vector.array) {
+		std::cout << "mapping failed" << std::endl;
+		return 1;
+	}
+
+	index_type size = length(mcb);
+	std::cout << "length: " << size << " (a whole page of int32_t)" << std::endl;
+
+	for(index_type i = 0; i < size; ++i)
+		mcb.buf_vector[i] = (int32_t)i;
+
+	//Element size + i is element i of the second mapping
+	int32_t* array = mcb.buf_vector.array;
+	index_type mirrored = 0;
+	for(index_type i = 0; i < size; ++i)
+		mirrored += (array[size + i] == array[i]) ? 1 : 0;
+	array[size + 3] = -3;
+	std::cout << "mirrored: " << mirrored << "/" << size << ", write through mirror: " << array[3] << " (-3)" << std::endl;
+	array[3] = 3;
+
+	//Windows across the wrap point are single vectors
+	index_type failures = 0;
+	index_type steps[] = { 1, 7, size / 3, size - 1 };
+	for(index_type step : steps) {
+		mcb = rotate_left(mcb, step);
+
+		for(index_type count : { (index_type)1, (index_type)5, size / 2, size }) {
+			circular_buffer<int32_t> cb = to_circular_buffer(mcb);
+
+			if(!same_elements(write(mcb, count), write(cb, count)))
+				++failures;
+			if(!same_elements(read(mcb, count), read(cb, count)))
+				++failures;
+			if(count < size && !same_elements(read(mcb, count, size - count), read(cb, count, size - count)))
+				++failures;
+		}
+	}
+	std::cout << "window mismatches: " << failures << " (0)" << std::endl;
+
+	mcb = rotate_right(mcb, mcb.tail + 2);
+	vector<int32_t> wrapped = write(mcb, 4);
+	std::cout << "tail " << mcb.tail << ", write(mcb, 4): ["
+		<< wrapped[0] << ", " << wrapped[1] << ", " << wrapped[2] << ", " << wrapped[3] << "]" << std::endl;
+
+	destroy_mirrored_circular_buffer(mcb);
+	std::cout << "destroyed: " << (mcb.buf_vector.array == nullptr) << ", length " << length(mcb) << std::endl;
+
+	int in;
+	std::cin >> in;
+
+	return 0;
+}
@@ -0,0 +1,133 @@
+
+#include "../vectors.h"
+#include "../mpmc_queue.h"
+#include "../stack_arena.h"
+#include <algorithm>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+namespace {
+using namespace libaxl;
+
+void enqueue_one_wait(mpmc_queue<int64_t>& q, int64_t item) {
+	vector<int64_t> items;
+	items.array = &item;
+	items.count = 1;
+	items.stride = 1;
+
+	enqueue_wait(q, items);
+}
+
+//Producers enqueue_wait 1..items_per_producer, consumers dequeue_wait
+//until they get a 0. A tiny queue makes both sides sleep often, which
+//is where a lost wakeup shows up as a hang.
+void stress(arena* arena, index_type queue_size, int producers, int consumers, int64_t items_per_producer, index_type batch) {
+	stack_arena_scope scope{ (stack_arena*)arena };
+
+	mpmc_queue<int64_t>& q = *make_mpmc_queue<int64_t>(arena, queue_size);
+	std::vector<int64_t> sums(consumers, 0);
+	std::vector<int64_t> counts(consumers, 0);
+	std::vector<std::thread> threads;
+
+	for(int c = 0; c < consumers; ++c) {
+		threads.emplace_back([&q, &sums, &counts, c, batch]() {
+			int64_t buffer[16];
+			vector<int64_t> out;
+			out.array = buffer;
+			out.count = batch;
+			out.stride = 1;
+
+			for(;;) {
+				index_type n = dequeue_wait(q, out);
+				for(index_type i = 0; i < n; ++i) {
+					//Items after a 0 in the same batch belong to the others
+					if(buffer[i] == 0) {
+						for(index_type j = i + 1; j < n; ++j) {
+							if(buffer[j] != 0) {
+								sums[c] += buffer[j];
+								++counts[c];
+							} else {
+								enqueue_one_wait(q, 0);
+							}
+						}
+						return;
+					}
+					sums[c] += buffer[i];
+					++counts[c];
+				}
+			}
+		});
+	}
+
+	std::vector<std::thread> producer_threads;
+	for(int p = 0; p < producers; ++p) {
+		producer_threads.emplace_back([&q, items_per_producer, batch]() {
+			int64_t buffer[16];
+			int64_t next = 1;
+
+			while(next <= items_per_producer) {
+				index_type n = (index_type)std::min<int64_t>(batch, items_per_producer - next + 1);
+				for(index_type i = 0; i < n; ++i)
+					buffer[i] = next + i;
+
+				vector<int64_t> items;
+				items.array = buffer;
+				items.count = n;
+				items.stride = 1;
+
+				//Items that did not fit go again with the next batch
+				next += enqueue_wait(q, items);
+			}
+		});
+	}
+
+	for(auto& t : producer_threads)
+		t.join();
+	for(int c = 0; c < consumers; ++c)
+		enqueue_one_wait(q, 0);
+	for(auto& t : threads)
+		t.join();
+
+	int64_t sum = 0, count = 0;
+	for(int c = 0; c < consumers; ++c) {
+		sum += sums[c];
+		count += counts[c];
+	}
+
+	int64_t expected_sum = producers * (items_per_producer * (items_per_producer + 1) / 2);
+	std::cout << producers << " producers, " << consumers << " consumers, queue " << queue_size
+		<< ", batch " << batch << ": " << count << " items, sum "
+		<< (sum == expected_sum ? "ok" : "wrong") << std::endl;
+}
+}
+
+int main(int argc, char** argv) {
+	using namespace libaxl;
+
+	dynamic_stack_arena arena{ new unsigned char[1 << 16], 1 << 16 };
+
+	{
+		stack_arena_scope scope{ &arena };
+		mpmc_queue<int64_t>& q = *make_mpmc_queue<int64_t>(&arena, 2);
+		int64_t item = 0;
+
+		std::cout << "enqueue 3 into 2: " << enqueue(q, (int64_t)1) << enqueue(q, (int64_t)2) << enqueue(q, (int64_t)3) << std::endl;
+		std::cout << "dequeue: " << dequeue(q, &item) << " " << item;
+		std::cout << ", " << dequeue(q, &item) << " " << item;
+		std::cout << ", empty: " << dequeue(q, &item) << std::endl;
+	}
+
+	int threads = (int)std::max(4U, std::thread::hardware_concurrency());
+
+	stress(&arena, 1, 1, 1, 200000, 1);
+	stress(&arena, 2, threads / 2, threads / 2, 100000, 1);
+	stress(&arena, 4, threads / 2, threads / 2, 100000, 3);
+	stress(&arena, 3, 1, threads - 1, 200000, 16);
+	stress(&arena, 3, threads - 1, 1, 50000, 2);
+
+	int in;
+	std::cin >> in;
+
+	return 0;
+}
@@ -0,0 +1,115 @@
+
+#include "../vectors.h"
+#include "../circular_buffer.h"
+#include "../resampler.h"
+#include "../stack_arena.h"
+#include <cmath>
+#include <iostream>
+
+namespace {
+using namespace libaxl;
+
+const char* mode_name(resample_mode mode) {
+	return mode == resample_linear ? "linear" : (mode == resample_cubic ? "cubic" : "polyphase");
+}
+
+//Streams in through r in blocks of the given sizes (cycled),
+//returns the number of outputs
+index_type stream(resampler<f64>& r, vector_f64 in, vector_f64 out, const index_type* block_sizes, index_type block_size_count) {
+	index_type produced = 0;
+	index_type position = 0;
+
+	for(index_type b = 0; position < length(in); ++b) {
+		index_type n = minimum(block_sizes[b % block_size_count], length(in) - position);
+		produced += process(r, take(drop(in, position), n), drop(out, produced));
+		position += n;
+	}
+
+	return produced;
+}
+
+//Output j is the input at time j * down / up - delay, for an input
+//that interpolation reproduces exactly (a ramp, or a constant for the
+//polyphase filter once its window is filled)
+void check(arena* arena, index_type up, index_type down, resample_mode mode) {
+	stack_arena_scope scope{ (stack_arena*)arena };
+
+	const index_type count = 10000;
+	const index_type whole[] = { count };
+	const index_type uneven[] = { 1, 4095, 3, 0, 4097, 17, 8192 };
+
+	vector_f64 in = make_uninitialized_vector<f64>(arena, count);
+	for(index_type i = 0; i < count; ++i)
+		in.array[i] = (mode == resample_polyphase) ? 1.0 : 0.5 * (f64)i;
+
+	resampler<f64> r = make_resampler<f64>(arena, up, down, mode, 16);
+	//process wants room for the rounded up bound of each block
+	vector_f64 out = make_uninitialized_vector<f64>(arena, output_length(r, count));
+	vector_f64 out_blocks = make_uninitialized_vector<f64>(arena, output_length(r, count) + count);
+
+	index_type produced = stream(r, in, out, whole, 1);
+	reset(r);
+	index_type produced_blocks = stream(r, in, out_blocks, uneven, sizeof(uneven) / sizeof(uneven[0]));
+
+	f64 delay = (mode == resample_linear) ? 1.0 : (mode == resample_cubic ? 2.0 : 0.0);
+	index_type warmup = (r.taps_per_phase * r.up) / r.down + 1;
+	f64 error = 0.0;
+	index_type block_mismatches = 0;
+
+	for(index_type j = 0; j < produced; ++j) {
+		if(out[j] != out_blocks[j])
+			++block_mismatches;
+		if(j < warmup)
+			continue;
+
+		f64 t = (f64)j * (f64)r.down / (f64)r.up - delay;
+		f64 expected = (mode == resample_polyphase) ? 1.0 : 0.5 * t;
+		error = maximum(error, std::fabs(out[j] - expected));
+	}
+
+	std::cout << "  " << up << "/" << down << " " << mode_name(mode) << ": " << produced
+		<< " outputs (bound " << output_length(r, count) << ")"
+		<< ", blocks " << (produced_blocks == produced && block_mismatches == 0 ? "same" : "differ")
+		<< ", " << (error < 1e-9 ? "ok" : "wrong") << std::endl;
+}
+}
+
+int main(int argc, char** argv) {
+	using namespace libaxl;
+
+	const size_type arena_size = 16U << 20;
+	dynamic_stack_arena arena{ new unsigned char[arena_size], arena_size };
+
+	std::cout << "up/down mode: outputs, whole vs uneven blocks, against the interpolated input" << std::endl;
+	for(resample_mode mode : { resample_linear, resample_cubic, resample_polyphase }) {
+		check(&arena, 1, 1, mode);
+		check(&arena, 3, 2, mode);
+		check(&arena, 2, 3, mode);
+		check(&arena, 160, 147, mode);
+		check(&arena, 6, 4, mode);
+	}
+
+	{
+		stack_arena_scope scope{ &arena };
+
+		//Doubling the rate of a wrapped ring window, linear: the midpoints
+		resampler<f64> r = make_resampler<f64>(&arena, 2, 1, resample_linear);
+		circular_buffer<f64> cb = make_circular_buffer<f64>(&arena, 4);
+		for(index_type i = 0; i < 4; ++i)
+			cb.buf_vector[i] = (f64)(i * 10);
+		cb = rotate_left(cb, 2);
+
+		vector_f64 out = make_uninitialized_vector<f64>(&arena, output_length(r, 4));
+		index_type produced = process(r, read(cb, 4), out);
+
+		std::cout << "2/1 linear of ring [20, 30, 0, 10]:";
+		for(index_type j = 0; j < produced; ++j)
+			std::cout << " " << out[j];
+		std::cout << std::endl;
+	}
+
+	int in_char;
+	std::cin >> in_char;
+
+	return 0;
+}
@@ -0,0 +1,114 @@
+
+#include "../vectors.h"
+#include "../sliding_window_stats.h"
+#include "../stack_arena.h"
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+
+namespace {
+using namespace libaxl;
+
+//Pushes samples one by one or in blocks of block_size and compares
+//every statistic with a brute force pass over the window
+index_type check(arena* arena, const char* name, f64* samples, index_type count, index_type window, index_type block_size) {
+	stack_arena_scope scope{ (stack_arena*)arena };
+
+	sliding_window_stats<f64> s = make_sliding_window_stats<f64>(arena, window, 0.25);
+	index_type failures = 0;
+
+	for(index_type pushed = 0; pushed < count; ) {
+		index_type n = minimum(block_size, count - pushed);
+		if(n == 1) {
+			push(s, samples[pushed]);
+		} else {
+			vector<f64> block;
+			block.array = samples + pushed;
+			block.count = n;
+			block.stride = 1;
+			push(s, block);
+		}
+		pushed += n;
+
+		index_type begin = maximum((index_type)0, pushed - window);
+		f64 lo = samples[begin], hi = samples[begin], sum = 0.0;
+		for(index_type i = begin; i < pushed; ++i) {
+			lo = minimum(lo, samples[i]);
+			hi = maximum(hi, samples[i]);
+			sum += samples[i];
+		}
+		f64 m = sum / (f64)(pushed - begin);
+		f64 var = 0.0;
+		for(index_type i = begin; i < pushed; ++i)
+			var += (samples[i] - m) * (samples[i] - m);
+		var /= (f64)(pushed - begin);
+
+		if(length(s) != pushed - begin || window_min(s) != lo || window_max(s) != hi
+			|| std::fabs(mean(s) - m) > 1e-9 || std::fabs(variance(s) - var) > 1e-6)
+		{
+			if(failures == 0) {
+				std::cout << "  " << name << " at " << pushed << ": min " << window_min(s) << " (" << lo
+					<< "), max " << window_max(s) << " (" << hi << "), mean " << mean(s) << " (" << m
+					<< "), variance " << variance(s) << " (" << var << ")" << std::endl;
+			}
+			++failures;
+		}
+	}
+
+	return failures;
+}
+}
+
+int main(int argc, char** argv) {
+	using namespace libaxl;
+
+	dynamic_stack_arena arena{ new unsigned char[1 << 16], 1 << 16 };
+
+	const index_type count = 200;
+	f64 increasing[count], decreasing[count], random[count];
+
+	srand(7);
+	for(index_type i = 0; i < count; ++i) {
+		increasing[i] = (f64)i;
+		decreasing[i] = (f64)(count - i);
+		random[i] = (f64)(rand() % 50) - 25.0;
+	}
+
+	{
+		stack_arena_scope scope{ &arena };
+		sliding_window_stats<f64> s = make_sliding_window_stats<f64>(&arena, 3, 0.5);
+
+		std::cout << "window 3, pushing 0..5: min";
+		for(index_type i = 0; i < 6; ++i) {
+			push(s, (f64)i);
+			if(i >= 3)
+				std::cout << " " << window_min(s);
+		}
+		std::cout << " (1 2 3)" << std::endl;
+
+		s = make_sliding_window_stats<f64>(&arena, 3, 0.5);
+		std::cout << "window 3, pushing 5..0: max";
+		for(index_type i = 5; i >= 0; --i) {
+			push(s, (f64)i);
+			if(i <= 2)
+				std::cout << " " << window_max(s);
+		}
+		std::cout << " (4 3 2)" << std::endl;
+		std::cout << "ema: " << ema(s) << std::endl;
+	}
+
+	index_type failures = 0;
+	for(index_type window : { 1, 2, 3, 8, 64 }) {
+		for(index_type block_size : { 1, 3, 64 }) {
+			failures += check(&arena, "increasing", increasing, count, window, block_size);
+			failures += check(&arena, "decreasing", decreasing, count, window, block_size);
+			failures += check(&arena, "random", random, count, window, block_size);
+		}
+	}
+	std::cout << "brute force mismatches: " << failures << " (0)" << std::endl;
+
+	int in;
+	std::cin >> in;
+
+	return 0;
+}
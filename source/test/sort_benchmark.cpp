@@ -0,0 +1,108 @@
+
+#include "../vectors.h"
+#include "../sort.h"
+#include "../stack_arena.h"
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <thread>
+
+namespace {
+using namespace libaxl;
+
+double seconds_since(std::chrono::steady_clock::time_point start) {
+	std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+	return elapsed.count();
+}
+
+template <typename T>
+void randomize(vector<T> v, std::mt19937_64& random) {
+	for(index_type i = 0; i < v.count; ++i)
+		v.array[i] = (T)random();
+}
+
+template <>
+void randomize<f64>(vector<f64> v, std::mt19937_64& random) {
+	std::normal_distribution<f64> normal;
+	for(index_type i = 0; i < v.count; ++i)
+		v.array[i] = normal(random);
+}
+
+template <typename T>
+void run(arena* arena, const char* name, index_type count, int thread_count) {
+	stack_arena_scope scope{ (stack_arena*)arena };
+
+	std::mt19937_64 random(1);
+	vector<T> keys = make_uninitialized_vector<T>(arena, count);
+	vector<T> work = make_uninitialized_vector<T>(arena, count);
+	randomize(keys, random);
+
+	f64 check = 0.0;
+	f64 elements = (f64)count * 1e-6;
+
+	copy_to(keys, work);
+	auto start = std::chrono::steady_clock::now();
+	std::sort(work.array, work.array + count);
+	f64 std_rate = elements / seconds_since(start);
+	check += (f64)work.array[count / 2];
+
+	copy_to(keys, work);
+	start = std::chrono::steady_clock::now();
+	{
+		stack_arena_scope scratch{ (stack_arena*)arena };
+		sort(arena, work);
+	}
+	f64 radix_rate = elements / seconds_since(start);
+	check += (f64)work.array[count / 2];
+
+	copy_to(keys, work);
+	start = std::chrono::steady_clock::now();
+	{
+		stack_arena_scope scratch{ (stack_arena*)arena };
+		sort(arena, work, thread_count);
+	}
+	f64 parallel_rate = elements / seconds_since(start);
+	check += (f64)work.array[count / 2];
+
+	copy_to(keys, work);
+	start = std::chrono::steady_clock::now();
+	std::nth_element(work.array, work.array + count / 2, work.array + count);
+	f64 std_select_rate = elements / seconds_since(start);
+	check += (f64)work.array[count / 2];
+
+	copy_to(keys, work);
+	start = std::chrono::steady_clock::now();
+	{
+		stack_arena_scope scratch{ (stack_arena*)arena };
+		check += (f64)nth_element(arena, work, count / 2);
+	}
+	f64 select_rate = elements / seconds_since(start);
+
+	std::cout << name << " x " << count
+		<< ": std::sort " << std_rate << " M/s"
+		<< ", radix " << radix_rate << " M/s"
+		<< ", radix " << thread_count << " threads " << parallel_rate << " M/s"
+		<< ", std::nth_element " << std_select_rate << " M/s"
+		<< ", nth_element " << select_rate << " M/s"
+		<< " (" << check << ")" << std::endl;
+}
+}
+
+int main(int argc, char** argv) {
+	using namespace libaxl;
+
+	const size_type arena_size = 1U << 30;
+	dynamic_stack_arena arena{ new unsigned char[arena_size], arena_size };
+
+	int thread_count = (int)maximum(1U, std::thread::hardware_concurrency());
+
+	run<uint32_t>(&arena, "u32", 1 << 24, thread_count);
+	run<int64_t>(&arena, "s64", 1 << 24, thread_count);
+	run<f64>(&arena, "f64", 1 << 24, thread_count);
+
+	int in_char;
+	std::cin >> in_char;
+
+	return 0;
+}
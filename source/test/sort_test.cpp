@@ -0,0 +1,210 @@
+
+#include "../vectors.h"
+#include "../sort.h"
+#include "../stack_arena.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+namespace {
+using namespace libaxl;
+
+uint64_t state = 0x9E3779B97F4A7C15ULL;
+
+uint64_t next_random() {
+	state ^= state << 13;
+	state ^= state >> 7;
+	state ^= state << 17;
+	return state;
+}
+
+//Values over the whole range of T, floats with signed zeros, infinities
+//and a wide spread of exponents
+template <typename T>
+T random_value();
+
+template <>
+uint32_t random_value<uint32_t>() { return (uint32_t)next_random(); }
+
+template <>
+int32_t random_value<int32_t>() { return (int32_t)next_random(); }
+
+template <>
+uint64_t random_value<uint64_t>() { return next_random() >> (next_random() % 60); }
+
+template <>
+int64_t random_value<int64_t>() { return (int64_t)next_random() >> (next_random() % 60); }
+
+template <>
+f64 random_value<f64>() {
+	switch(next_random() % 50) {
+		case 0: return -0.0;
+		case 1: return 0.0;
+		case 2: return INFINITY;
+		case 3: return -INFINITY;
+		default: return std::ldexp((f64)(int64_t)next_random(), -(int)(next_random() % 120));
+	}
+}
+
+template <>
+f32 random_value<f32>() { return (f32)random_value<f64>(); }
+
+//The order sort documents: by radix key, so -0.0 before 0.0
+template <typename T>
+bool key_less(T a, T b) {
+	return detail::radix_key<T>::get(a) < detail::radix_key<T>::get(b);
+}
+
+template <typename T>
+bool same_bits(T a, T b) {
+	return memcmp(&a, &b, sizeof(T)) == 0;
+}
+
+//Every third element of larger inputs comes from a few values, so there
+//are long runs of equal keys for the stability check
+template <typename T>
+std::vector<T> make_input(index_type count, bool no_infinities) {
+	std::vector<T> result((size_t)count);
+	for(index_type i = 0; i < count; ++i) {
+		T value = random_value<T>();
+		if(no_infinities && std::isinf((f64)value))
+			value = (T)1;
+		result[(size_t)i] = (count > 1000 && i % 3 == 0) ? (T)(i % 17) : value;
+	}
+	return result;
+}
+
+struct sort_errors {
+	index_type sorted;
+	index_type copied;
+	index_type strided;
+	index_type argsorted;
+	index_type unstable;
+};
+
+template <typename T>
+void check_sort(arena* arena, index_type count, int thread_count, sort_errors& errors) {
+	stack_arena_scope scope{ (stack_arena*)arena };
+
+	std::vector<T> input = make_input<T>(count, false);
+	std::vector<T> expected = input;
+	std::stable_sort(expected.begin(), expected.end(), key_less<T>);
+
+	//The input every other element of a strided view
+	vector<T> storage = make_uninitialized_vector<T>(arena, 2 * count);
+	vector<T> strided = drop_odd(storage);
+	for(index_type i = 0; i < count; ++i)
+		strided[i] = input[(size_t)i];
+
+	vector<index_type> order = argsort(arena, strided, thread_count);
+	for(index_type i = 0; i < count; ++i) {
+		if(!same_bits(strided[order[i]], expected[(size_t)i])) {
+			++errors.argsorted;
+			break;
+		}
+		if(i > 0 && !key_less(strided[order[i - 1]], strided[order[i]]) && order[i - 1] > order[i]) {
+			++errors.unstable;
+			break;
+		}
+	}
+
+	vector<T> out = make_uninitialized_vector<T>(arena, count + 3);
+	vector<T> written = sort(arena, strided, out, thread_count);
+	vector<T> contiguous = make_uninitialized_vector<T>(arena, count);
+	for(index_type i = 0; i < count; ++i)
+		contiguous[i] = input[(size_t)i];
+	sort(arena, contiguous, thread_count);
+	sort(arena, strided, thread_count);
+
+	errors.copied += (length(written) != count) ? 1 : 0;
+	for(index_type i = 0; i < count; ++i) {
+		errors.sorted += !same_bits(contiguous[i], expected[(size_t)i]) ? 1 : 0;
+		errors.copied += !same_bits(written[i], expected[(size_t)i]) ? 1 : 0;
+		errors.strided += !same_bits(strided[i], expected[(size_t)i]) ? 1 : 0;
+	}
+}
+
+template <typename T>
+void check_sorts(arena* arena, const char* type_name) {
+	for(int thread_count : { 1, 4 }) {
+		sort_errors errors = {};
+
+		for(index_type count : { 0, 1, 2, 3, 31, 100, 1000, 70000, 300001 })
+			check_sort<T>(arena, count, thread_count, errors);
+
+		std::cout << "sort<" << type_name << ">, " << thread_count << " thread(s): mismatches " << errors.sorted
+			<< ", into out " << errors.copied << ", strided " << errors.strided
+			<< ", argsort " << errors.argsorted << ", unstable " << errors.unstable << std::endl;
+	}
+}
+
+template <typename T>
+void check_selection(arena* arena, const char* type_name) {
+	index_type partition_errors = 0;
+	index_type nth_errors = 0;
+
+	for(index_type count : { 1, 5, 33, 100, 1000, 100001 }) {
+		stack_arena_scope scope{ (stack_arena*)arena };
+
+		//No infinities, so that the (T)(i % 7) runs are not all at one end
+		std::vector<T> input = make_input<T>(count, true);
+		vector<T> v = make_uninitialized_vector<T>(arena, count);
+
+		//partition keeps the order of both sides, like stable_partition
+		T pivot = input[(size_t)(count / 3)];
+		std::vector<T> expected = input;
+		auto middle = std::stable_partition(expected.begin(), expected.end(), [pivot](T x) { return x < pivot; });
+
+		for(index_type i = 0; i < count; ++i)
+			v[i] = input[(size_t)i];
+		index_type less = partition(arena, v, pivot);
+		partition_errors += (less != (index_type)(middle - expected.begin())) ? 1 : 0;
+		for(index_type i = 0; i < count; ++i)
+			partition_errors += !(v[i] == expected[(size_t)i]) ? 1 : 0;
+
+		std::vector<T> sorted = input;
+		std::sort(sorted.begin(), sorted.end());
+
+		for(index_type n : { (index_type)0, count / 7, count / 2, count - 1 }) {
+			for(index_type i = 0; i < count; ++i)
+				v[i] = input[(size_t)i];
+
+			T value = nth_element(arena, v, n);
+			nth_errors += (!(value == sorted[(size_t)n]) || !(v[n] == value)) ? 1 : 0;
+			for(index_type i = 0; i < count; ++i)
+				nth_errors += ((i < n && v[i] > value) || (i > n && v[i] < value)) ? 1 : 0;
+		}
+	}
+
+	std::cout << "partition<" << type_name << ">: mismatches " << partition_errors
+		<< ", nth_element<" << type_name << ">: mismatches " << nth_errors << std::endl;
+}
+}
+
+int main(int argc, char** argv) {
+	using namespace libaxl;
+
+	const size_type arena_size = 1U << 28;
+	dynamic_stack_arena arena{ new unsigned char[arena_size], arena_size };
+
+	check_sorts<uint32_t>(&arena, "u32");
+	check_sorts<int32_t>(&arena, "s32");
+	check_sorts<uint64_t>(&arena, "u64");
+	check_sorts<int64_t>(&arena, "s64");
+	check_sorts<f32>(&arena, "f32");
+	check_sorts<f64>(&arena, "f64");
+
+	check_selection<uint32_t>(&arena, "u32");
+	check_selection<int32_t>(&arena, "s32");
+	check_selection<uint64_t>(&arena, "u64");
+	check_selection<int64_t>(&arena, "s64");
+	check_selection<f32>(&arena, "f32");
+	check_selection<f64>(&arena, "f64");
+
+	int in;
+	std::cin >> in;
+
+	return 0;
+}
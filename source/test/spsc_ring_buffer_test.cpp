@@ -0,0 +1,90 @@
+
+#include "../vectors.h"
+#include "../spsc_ring_buffer.h"
+#include "../stack_arena.h"
+#include <iostream>
+#include <thread>
+
+namespace {
+using namespace libaxl;
+
+//Producer writes 0, 1, 2, ... in windows of varying size, the consumer
+//checks that it sees exactly that sequence
+void run(arena* arena, index_type ring_size, index_type total) {
+	stack_arena_scope scope{ (stack_arena*)arena };
+
+	spsc_ring_buffer<int64_t>& rb = *make_spsc_ring_buffer<int64_t>(arena, ring_size);
+	index_type errors = 0;
+	int64_t checksum = 0;
+
+	std::thread producer([&rb, ring_size, total]() {
+		int64_t next = 0;
+		index_type window = 1;
+
+		while(next < total) {
+			vector_pair<int64_t> free = reserve_write(rb, minimum(window, (index_type)(total - next)));
+
+			for(index_type i = 0; i < length(free); ++i)
+				free[i] = next + i;
+
+			commit_write(rb, length(free));
+			next += length(free);
+			window = window % ring_size + 1;
+
+			if(length(free) == 0)
+				std::this_thread::yield();
+		}
+	});
+
+	int64_t expected = 0;
+	index_type window = ring_size;
+
+	while(expected < total) {
+		vector_pair<int64_t> available = peek_read(rb, window);
+
+		for(index_type i = 0; i < length(available); ++i) {
+			errors += (available[i] != expected + i) ? 1 : 0;
+			checksum += available[i];
+		}
+
+		release_read(rb, length(available));
+		expected += length(available);
+		window = (window > 1) ? window - 1 : ring_size;
+
+		if(length(available) == 0)
+			std::this_thread::yield();
+	}
+
+	producer.join();
+
+	std::cout << "ring " << ring_size << ", " << total << " elements: errors " << errors
+		<< ", checksum " << (checksum == (int64_t)total * (total - 1) / 2 ? "ok" : "wrong")
+		<< ", empty " << (length(peek_read(rb, 1)) == 0) << std::endl;
+}
+}
+
+int main(int argc, char** argv) {
+	using namespace libaxl;
+
+	dynamic_stack_arena arena{ new unsigned char[1 << 16], 1 << 16 };
+
+	{
+		stack_arena_scope scope{ &arena };
+		spsc_ring_buffer<int64_t>& rb = *make_spsc_ring_buffer<int64_t>(&arena, 4);
+
+		std::cout << "reserve 6 of 4: " << length(reserve_write(rb, 6)) << std::endl;
+		commit_write(rb, 3);
+		std::cout << "peek 5 after 3 committed: " << length(peek_read(rb, 5)) << std::endl;
+		release_read(rb, 2);
+		std::cout << "reserve 6 after 2 released: " << length(reserve_write(rb, 6)) << std::endl;
+	}
+
+	run(&arena, 1, 10000);
+	run(&arena, 7, 100000);
+	run(&arena, 64, 1000000);
+
+	int in;
+	std::cin >> in;
+
+	return 0;
+}
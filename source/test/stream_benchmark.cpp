@@ -0,0 +1,88 @@
+
+//Build twice, with the default LIBAXL_STREAM_THRESHOLD and with
+//LIBAXL_STREAM_THRESHOLD=0, and compare the rates.
+
+#include "../vectors.h"
+#include "../stack_arena.h"
+#include <chrono>
+#include <iostream>
+
+namespace {
+using namespace libaxl;
+
+double seconds_since(std::chrono::steady_clock::time_point start) {
+	std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+	return elapsed.count();
+}
+
+f64 sum(vector_f64 v) {
+	f64 result = 0.0;
+	for(index_type i = 0; i < length(v); ++i)
+		result += v.array[i];
+	return result;
+}
+
+void run(arena* arena, index_type count, index_type working_count, index_type repetitions) {
+	stack_arena_scope scope{ (stack_arena*)arena };
+
+	vector_f64 big = make_uninitialized_vector<f64>(arena, count);
+	vector_f64 source = make_uninitialized_vector<f64>(arena, count);
+	vector_f64 working = make_uninitialized_vector<f64>(arena, working_count);
+	fill(source, 1.0);
+	fill(working, 1.0);
+
+	//Fault the pages in before timing
+	memset(big.array, 0, (size_type)count * sizeof(f64));
+
+	f64 check = 0.0;
+	f64 gigabytes = (f64)count * sizeof(f64) * (f64)repetitions * 1e-9;
+
+	auto start = std::chrono::steady_clock::now();
+	for(index_type r = 0; r < repetitions; ++r) {
+		fill(big, (f64)r);
+		check += big.array[r];
+	}
+	f64 fill_rate = gigabytes / seconds_since(start);
+
+	start = std::chrono::steady_clock::now();
+	for(index_type r = 0; r < repetitions; ++r) {
+		copy_to(source, big);
+		check += big.array[r];
+	}
+	f64 copy_rate = gigabytes / seconds_since(start);
+
+	//How much of the working set survives a big fill
+	f64 working_time = 0.0;
+	for(index_type r = 0; r < repetitions; ++r) {
+		check += sum(working);
+		fill(big, 0.0);
+
+		start = std::chrono::steady_clock::now();
+		check += sum(working);
+		working_time += seconds_since(start);
+	}
+
+	std::cout << "count " << count
+		<< ": fill " << fill_rate << " GB/s"
+		<< ", copy " << copy_rate << " GB/s"
+		<< ", working set reread " << working_time * 1e6 / (f64)repetitions << " us"
+		<< " (" << check << ")" << std::endl;
+}
+}
+
+int main(int argc, char** argv) {
+	using namespace libaxl;
+
+	const size_type arena_size = 1U << 30;
+	dynamic_stack_arena arena{ new unsigned char[arena_size], arena_size };
+
+	std::cout << "stream threshold " << LIBAXL_STREAM_THRESHOLD << " bytes" << std::endl;
+
+	//1 MB working set next to 256 MB buffers
+	run(&arena, 32 << 20, 128 << 10, 10);
+
+	int in_char;
+	std::cin >> in_char;
+
+	return 0;
+}
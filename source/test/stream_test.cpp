@@ -0,0 +1,190 @@
+
+//A low threshold, so the streaming paths run on small vectors
+#define LIBAXL_STREAM_THRESHOLD 256
+
+#include "../vectors.h"
+#include "../stack_arena.h"
+#include <cstring>
+#include <iostream>
+
+namespace {
+using namespace libaxl;
+
+//Larger than a 16 byte store, never streamed
+struct triple {
+	f64 x, y, z;
+
+	bool operator!=(const triple& other) const { return x != other.x || y != other.y || z != other.z; }
+};
+
+template <typename T>
+T value_at(index_type i) {
+	return (T)(i % 101 + 1);
+}
+
+template <>
+triple value_at<triple>(index_type i) {
+	return triple{ (f64)i, (f64)(i % 7), -1.0 };
+}
+
+const unsigned char guard = 0xA5;
+
+//A view of count elements at byte offset of a guarded buffer, the
+//bytes around it set to guard
+template <typename T>
+vector<T> make_guarded(arena* arena, index_type count, size_type offset) {
+	size_type size = (size_type)count * sizeof(T) + 48;
+	unsigned char* bytes = make_uninitialized_vector<unsigned char>(arena, (index_type)size).array;
+	memset(bytes, guard, size);
+
+	vector<T> result = { (T*)(bytes + 16 + offset), count, 1 };
+	return result;
+}
+
+template <typename T>
+bool guards_intact(vector<T> v) {
+	auto before = (const unsigned char*)v.array - 16;
+	auto after = (const unsigned char*)(v.array + v.count);
+	for(int k = 0; k < 16; ++k) {
+		if(before[k] != guard || after[k] != guard)
+			return false;
+	}
+	return true;
+}
+
+//Counts on both sides of the threshold, with tails that are not a
+//whole number of unrolled stores
+const index_type counts[] = { 0, 1, 3, 15, 31, 32, 33, 63, 64, 65, 255, 256, 257, 1000, 4099 };
+
+template <typename T>
+index_type check_fill(arena* arena, size_type offset) {
+	index_type errors = 0;
+
+	for(index_type count : counts) {
+		stack_arena_scope scope{ (stack_arena*)arena };
+
+		vector<T> v = make_guarded<T>(arena, count, offset);
+		fill(v, value_at<T>(7));
+		for(index_type i = 0; i < count; ++i)
+			errors += (v[i] != value_at<T>(7)) ? 1 : 0;
+		errors += !guards_intact(v) ? 1 : 0;
+	}
+
+	return errors;
+}
+
+template <typename T>
+index_type check_copy(arena* arena, size_type in_offset, size_type out_offset) {
+	index_type errors = 0;
+
+	for(index_type count : counts) {
+		stack_arena_scope scope{ (stack_arena*)arena };
+
+		vector<T> in = make_guarded<T>(arena, count, in_offset);
+		vector<T> out = make_guarded<T>(arena, count, out_offset);
+		for(index_type i = 0; i < count; ++i)
+			in[i] = value_at<T>(i);
+
+		vector<T> written = copy_to(in, out);
+		errors += (length(written) != count) ? 1 : 0;
+		for(index_type i = 0; i < count; ++i)
+			errors += (out[i] != value_at<T>(i) || in[i] != value_at<T>(i)) ? 1 : 0;
+		errors += (!guards_intact(in) || !guards_intact(out)) ? 1 : 0;
+	}
+
+	return errors;
+}
+
+//Above the threshold the ranges overlap, so copy_to must not stream
+template <typename T>
+index_type check_overlap(arena* arena) {
+	index_type errors = 0;
+
+	for(index_type shift : { 1, 2, 5, 64 }) {
+		for(bool forward : { true, false }) {
+			stack_arena_scope scope{ (stack_arena*)arena };
+
+			const index_type count = 1000;
+			vector<T> v = make_guarded<T>(arena, count + shift, 0);
+			for(index_type i = 0; i < count + shift; ++i)
+				v[i] = value_at<T>(i);
+
+			//Forward moves [0, count) to [shift, count + shift)
+			if(forward)
+				copy_to(take(v, count), drop(v, shift));
+			else
+				copy_to(drop(v, shift), take(v, count));
+
+			for(index_type i = 0; i < count; ++i) {
+				T expected = forward ? value_at<T>(i) : value_at<T>(i + shift);
+				errors += (v[forward ? i + shift : i] != expected) ? 1 : 0;
+			}
+			errors += !guards_intact(v) ? 1 : 0;
+		}
+	}
+
+	return errors;
+}
+
+template <typename T>
+index_type check_zeros(arena* arena) {
+	index_type errors = 0;
+
+	for(index_type count : counts) {
+		for(index_type skew = 0; skew < 16; skew += (index_type)sizeof(T)) {
+			stack_arena_scope scope{ (stack_arena*)arena };
+
+			//Leaves the next allocation off a 16 byte boundary
+			if(skew > 0)
+				make_uninitialized_vector<unsigned char>(arena, skew);
+
+			vector<T> v = zeros<T>(arena, count);
+			for(index_type i = 0; i < count; ++i) {
+				T zero = T();
+				errors += (memcmp(&v.array[i], &zero, sizeof(T)) != 0) ? 1 : 0;
+			}
+		}
+	}
+
+	return errors;
+}
+
+//Offsets that are multiples of the element size and, for types
+//wider than a byte, one that is not
+template <typename T>
+void check_type(arena* arena, const char* type_name) {
+	index_type fill_errors = 0;
+	index_type copy_errors = 0;
+
+	for(size_type offset = 0; offset < 16; offset += sizeof(T) < 16 ? sizeof(T) : 8) {
+		fill_errors += check_fill<T>(arena, offset);
+		copy_errors += check_copy<T>(arena, offset, (16 - offset) % 16);
+		copy_errors += check_copy<T>(arena, 0, offset);
+	}
+	if(sizeof(T) > 1) {
+		fill_errors += check_fill<T>(arena, 1);
+		copy_errors += check_copy<T>(arena, 0, 1);
+	}
+
+	std::cout << type_name << ": fill mismatches " << fill_errors << ", copy_to " << copy_errors
+		<< ", overlapping copy_to " << check_overlap<T>(arena) << ", zeros " << check_zeros<T>(arena) << " (0)" << std::endl;
+}
+}
+
+int main(int argc, char** argv) {
+	using namespace libaxl;
+
+	const size_type arena_size = 4U << 20;
+	dynamic_stack_arena arena{ new unsigned char[arena_size], arena_size };
+
+	check_type<uint8_t>(&arena, "u8");
+	check_type<uint16_t>(&arena, "u16");
+	check_type<f32>(&arena, "f32");
+	check_type<f64>(&arena, "f64");
+	check_type<triple>(&arena, "24 byte struct");
+
+	int in;
+	std::cin >> in;
+
+	return 0;
+}
@@ -0,0 +1,105 @@
+
+#include "../vectors.h"
+#include "../vector_f64.h"
+#include "../tile_profile.h"
+#include "../lazy_eval/lazy_eval.h"
+#include "../lazy_eval/tile_tuner.h"
+#include "../stack_arena.h"
+#include <cstdio>
+#include <iostream>
+
+namespace {
+using namespace libaxl;
+
+const char* path = "tile_profile_test.txt";
+
+bool is_candidate(index_type tile) {
+	for(int i = 0; i < detail::tile_candidate_count; ++i) {
+		if(detail::tile_candidates[i] == tile)
+			return true;
+	}
+	return false;
+}
+
+bool write_text(const char* text) {
+	FILE* file = fopen(path, "w");
+	if(!file)
+		return false;
+	fputs(text, file);
+	return fclose(file) == 0;
+}
+
+//Loads path into a profile preset to a marker, so that a failed load
+//can be told from one that changed it
+const char* load_result(tile_profile* loaded) {
+	loaded->eval_tile = -7;
+	loaded->reduce_tile = -7;
+
+	bool ok = load_tile_profile(path, loaded);
+	bool untouched = loaded->eval_tile == -7 && loaded->reduce_tile == -7;
+
+	return ok ? "loaded" : (untouched ? "refused, untouched" : "refused, but changed");
+}
+}
+
+int main(int argc, char** argv) {
+	using namespace libaxl;
+
+	const size_type arena_size = 64U << 20;
+	dynamic_stack_arena arena{ new unsigned char[arena_size], arena_size };
+
+	{
+		//A scan of a million doubles takes well over a microsecond, a
+		//time near zero means the scan was optimized away
+		stack_arena_scope scope{ &arena };
+		vector_f64 a = ones_f64(&arena, 1 << 20);
+		double seconds = detail::time_reduce_tile(a, 1024);
+		std::cout << "reduce scan of 2^20 elements measured: " << (seconds > 1e-6) << std::endl;
+	}
+
+	{
+		size_type before = arena.used();
+		tile_profile tuned = tune_tile_profile(&arena, 1 << 18);
+		std::cout << "tune_tile_profile: eval_tile a candidate " << is_candidate(tuned.eval_tile)
+			<< ", reduce_tile a candidate " << is_candidate(tuned.reduce_tile)
+			<< ", scratch released " << (arena.used() == before)
+			<< ", current profile unchanged " << (current_tile_profile().eval_tile == default_tile_profile().eval_tile) << std::endl;
+	}
+
+	tile_profile saved;
+	saved.eval_tile = 4096;
+	saved.reduce_tile = 512;
+	tile_profile loaded;
+
+	std::cout << "save: " << save_tile_profile(path, saved);
+	std::cout << ", load: " << load_result(&loaded) << " " << loaded.eval_tile << "/" << loaded.reduce_tile << " (4096/512)" << std::endl;
+
+	remove(path);
+	std::cout << "missing file: " << load_result(&loaded) << std::endl;
+	write_text("libaxl_tile_profile 2\neval_tile 4096\nreduce_tile 512\n");
+	std::cout << "other version: " << load_result(&loaded) << std::endl;
+	write_text("libaxl_tile_profile 1\neval_tile 4096\n");
+	std::cout << "truncated: " << load_result(&loaded) << std::endl;
+	write_text("libaxl_tile_profile 1\neval_tile 0\nreduce_tile 512\n");
+	std::cout << "zero tile: " << load_result(&loaded) << std::endl;
+
+	//A cached file is used as it is, without tuning
+	save_tile_profile(path, saved);
+	tile_profile cached = load_or_tune_tile_profile(path, &arena, 1 << 18);
+	std::cout << "load_or_tune with a cache: " << cached.eval_tile << "/" << cached.reduce_tile
+		<< ", current " << current_tile_profile().eval_tile << "/" << current_tile_profile().reduce_tile << std::endl;
+
+	//Without one it tunes and writes the file
+	remove(path);
+	tile_profile tuned = load_or_tune_tile_profile(path, &arena, 1 << 18);
+	std::cout << "load_or_tune without a cache: cached what it tuned " << (load_tile_profile(path, &loaded)
+		&& loaded.eval_tile == tuned.eval_tile && loaded.reduce_tile == tuned.reduce_tile) << std::endl;
+
+	set_tile_profile(default_tile_profile());
+	remove(path);
+
+	int in;
+	std::cin >> in;
+
+	return 0;
+}
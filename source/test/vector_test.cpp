@@ -67,6 +67,31 @@ int main(int argc, char** argv) {
 		auto pv = eval(expr, &arena);
 		print_vector(pv, true);
 	}
+	{
+		v64 ramp = ramp_f64(&arena, length(vres));
+		auto mask = vres > ramp;
+		auto pv = eval(where(mask, vres, ramp), &arena);
+		print_vector(pv, true);
+		std::cout << "count: " << count(mask) << ", any: " << any(mask) << ", all: " << all(mask) << std::endl;
+
+		assign_where(pv, logical_not(mask), constant(0.0));
+		print_vector(pv, true);
+	}
+	{
+		v64 ones = ones_f64(&arena, length(vres));
+		auto e = share(vres / (vres + ones), &arena);
+		auto pv = eval((e + ones) / e, &arena);
+		print_vector(pv, true);
+	}
+	{
+		stack_arena_scope s{ &arena };
+		v64 a = ones_f64(&arena, 4);
+		v64 b = ones_f64(&arena, 4);
+		auto e = share<reuse_last_value>(a / (a + b), &arena);
+		std::cout << "shared: " << eval(e, &arena)[0];
+		fill(a, 3.0);
+		std::cout << ", after fill(a, 3): " << eval(e, &arena)[0] << " (0.75)" << std::endl;
+	}
 	{
 		//auto pv = vres * vres - vres;
 		//print_vector(pv, true);
@@ -162,6 +187,21 @@ int main(int argc, char** argv) {
 	}
 	std::cout << std::endl;
 
+	{
+		auto smoothed = (shift(ring(cb), -1) + constant(2.0) * ring(cb) + shift(ring(cb), 1)) / constant(4.0);
+		std::cout << "smoothed ring(cb): ";
+		print_vector(eval(smoothed, &arena), true);
+		std::cout << "wrapped shift: ";
+		print_vector(eval(shift<boundary_wrap>(iota_vec, 2), &arena), true);
+		std::cout << "zero shift: ";
+		print_vector(eval(shift<boundary_zero>(iota_vec, -2), &arena), true);
+		std::cout << "read(cb, 4) * 2: ";
+		print_vector(eval(read(cb, 4) * constant(2.0), &arena), true);
+		auto shared_read = share(read(cb, 6) * constant(2.0), &arena);
+		std::cout << "shift(shared read(cb, 6) * 2, 1): ";
+		print_vector(eval(shift<boundary_zero>(shared_read, 1) + constant(0.0) * shared_read, &arena), true);
+	}
+
 	std::cout << "Used: " << arena.used() << std::endl;
 	
 	vec filled_vector1 = make_uninitialized_vector<f64>(&arena, 12);
@@ -0,0 +1,151 @@
+
+#ifndef LIBAXL_TILE_PROFILE_GUARD
+#define LIBAXL_TILE_PROFILE_GUARD
+
+#include <atomic>
+#include <cstdio>
+
+#include "util.h"
+
+namespace libaxl {
+
+/**
+ *  Tile sizes (in elements) used by the chunked kernels.
+ *
+ *  eval_tile:   chunk of shared subexpressions materialized by share()
+ *  reduce_tile: block of streaming reductions between early-out checks
+ *
+ *  The defaults are conservative guesses for a 32KB L1. A profile
+ *  measured on the host can be produced by tune_tile_profile
+ *  (lazy_eval/tile_tuner.h) and kept in a small text file.
+ */
+struct tile_profile {
+	index_type eval_tile;
+	index_type reduce_tile;
+};
+
+inline
+tile_profile default_tile_profile() {
+	tile_profile result;
+
+	result.eval_tile = 1024;
+	result.reduce_tile = 64;
+
+	return result;
+}
+
+inline
+bool check(tile_profile profile) {
+	return profile.eval_tile >= 1 && profile.reduce_tile >= 1;
+}
+
+namespace detail {
+	/**
+	 *  Each field is a separate atomic, so readers on other threads never
+	 *  see a torn value. A reader may combine one field of the previous
+	 *  profile with one of the new profile, which is a valid profile too.
+	 */
+	struct tile_profile_slot {
+		std::atomic<index_type> eval_tile;
+		std::atomic<index_type> reduce_tile;
+	};
+
+	inline
+	tile_profile_slot& current_tile_profile_slot() {
+		static tile_profile_slot slot{ { default_tile_profile().eval_tile }, { default_tile_profile().reduce_tile } };
+		return slot;
+	}
+}
+
+/**
+ *  The process wide profile the kernels read their tile sizes from.
+ */
+inline
+tile_profile current_tile_profile() {
+	auto& slot = detail::current_tile_profile_slot();
+	tile_profile result;
+
+	result.eval_tile = slot.eval_tile.load(std::memory_order_relaxed);
+	result.reduce_tile = slot.reduce_tile.load(std::memory_order_relaxed);
+
+	return result;
+}
+
+inline
+void set_tile_profile(tile_profile profile) {
+	assert(check(profile));
+
+	auto& slot = detail::current_tile_profile_slot();
+	slot.eval_tile.store(profile.eval_tile, std::memory_order_relaxed);
+	slot.reduce_tile.store(profile.reduce_tile, std::memory_order_relaxed);
+}
+
+//
+//  Persistence
+//
+//  The cache file is plain text:
+//
+//  libaxl_tile_profile 1
+//  eval_tile 2048
+//  reduce_tile 256
+//
+
+/**
+ *  Reads a profile written by save_tile_profile.
+ *
+ *  Returns false (and leaves *profile untouched) if the file is
+ *  missing, of another version or malformed.
+ */
+inline
+bool load_tile_profile(const char* path, tile_profile* profile) {
+	assert(path != nullptr);
+	assert(profile != nullptr);
+
+	FILE* file = fopen(path, "r");
+	if(!file)
+		return false;
+
+	int version = 0;
+	int eval_tile = 0;
+	int reduce_tile = 0;
+
+	int matched = fscanf(file, " libaxl_tile_profile %d eval_tile %d reduce_tile %d",
+		&version, &eval_tile, &reduce_tile);
+	fclose(file);
+
+	if(matched != 3 || version != 1)
+		return false;
+
+	tile_profile result;
+	result.eval_tile = (index_type)eval_tile;
+	result.reduce_tile = (index_type)reduce_tile;
+
+	if(!check(result))
+		return false;
+
+	*profile = result;
+	return true;
+}
+
+inline
+bool save_tile_profile(const char* path, tile_profile profile) {
+	assert(path != nullptr);
+	assert(check(profile));
+
+	FILE* file = fopen(path, "w");
+	if(!file)
+		return false;
+
+	int written = fprintf(file, "libaxl_tile_profile 1\neval_tile %d\nreduce_tile %d\n",
+		(int)profile.eval_tile, (int)profile.reduce_tile);
+
+	bool result = (written > 0);
+	if(fclose(file) != 0)
+		result = false;
+
+	return result;
+}
+}
+
+// LIBAXL_TILE_PROFILE_GUARD
+#endif
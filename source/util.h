@@ -13,7 +13,14 @@
 namespace libaxl {
 //Types
 using size_type = size_t;
+#ifdef LIBAXL_INDEX_64
+//Vectors of more than 2^31 - 1 elements, e.g. large mapped files
+using index_type = int64_t;
+const index_type index_type_max = INT64_MAX;
+#else
 using index_type = int32_t;
+const index_type index_type_max = INT32_MAX;
+#endif
 using scalar_type = double;
 
 namespace detail {
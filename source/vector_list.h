@@ -0,0 +1,148 @@
+
+#ifndef LIBAXL_VECTOR_LIST_GUARD
+#define LIBAXL_VECTOR_LIST_GUARD
+
+#include "util.h"
+#include "arena.h"
+#include "vectors.h"
+#include "vector_pair.h"
+
+namespace libaxl {
+
+/**
+ *  A sequence of vectors viewed as one logical vector, the
+ *  N-segment generalization of vector_pair.
+ *
+ *  The segment array is owned by the arena it was allocated from,
+ *  the segments themselves may point anywhere.
+ */
+template <typename T>
+struct vector_list {
+	vector<T>* v;
+	index_type count;
+
+	ALWAYS_INLINE T& operator[](index_type index);
+};
+
+template <typename T>
+inline
+vector_list<T> make_vector_list(arena* arena, index_type count) {
+	vector_list<T> result;
+
+	assert(arena != nullptr);
+	assert(count >= 0);
+
+	result.v = allocate<vector<T>>(arena, count);
+	result.count = count;
+
+	for(index_type i = 0; i < count; ++i) {
+		result.v[i].array = nullptr;
+		result.v[i].count = 0;
+		result.v[i].stride = 1;
+	}
+
+	return result;
+}
+
+template <typename T>
+inline
+vector_list<T> make_vector_list(arena* arena, vector_pair<T> vp) {
+	vector_list<T> result = make_vector_list<T>(arena, 2);
+
+	result.v[0] = first(vp);
+	result.v[1] = second(vp);
+
+	return result;
+}
+
+template <typename T>
+inline
+index_type segment_count(vector_list<T> vl) {
+	return vl.count;
+}
+
+template <typename T>
+inline
+vector<T> segment(vector_list<T> vl, index_type index) {
+	assert(index >= 0 && index < vl.count);
+
+	return vl.v[index];
+}
+
+template <typename T>
+inline
+index_type length(vector_list<T> vl) {
+	index_type result = 0;
+
+	for(index_type i = 0; i < vl.count; ++i) {
+		result += length(vl.v[i]);
+	}
+
+	return result;
+}
+
+/**
+ *  The first count elements of vl as a new list of the segments they
+ *  cover. The segment array is allocated from arena unless count ends
+ *  on a segment boundary, then the result shares the array of vl.
+ *
+ *  Preconditions:
+ *  (1) 0 <= count <= length(vl)
+ */
+template <typename T>
+inline
+vector_list<T> take(arena* arena, vector_list<T> vl, index_type count) {
+	assert(count >= 0);
+
+	index_type segments = 0;
+	index_type remaining = count;
+
+	while(remaining > 0) {
+		assert(segments < vl.count);
+		remaining -= minimum(remaining, length(vl.v[segments]));
+		++segments;
+	}
+
+	index_type covered = 0;
+	for(index_type i = 0; i < segments; ++i) {
+		covered += length(vl.v[i]);
+	}
+
+	if(covered == count) {
+		vl.count = segments;
+		return vl;
+	}
+
+	vector_list<T> result = make_vector_list<T>(arena, segments);
+	for(index_type i = 0; i < segments; ++i) {
+		result.v[i] = vl.v[i];
+	}
+	result.v[segments - 1] = take(result.v[segments - 1], length(result.v[segments - 1]) - (covered - count));
+
+	return result;
+}
+
+/**
+ *  Element access, walks the segment list.
+ *
+ *  O(number of segments); kernels should process one segment
+ *  at a time instead (see assign in lazy_eval.h).
+ */
+template <typename T>
+ALWAYS_INLINE
+T& vector_list<T>::operator[](index_type index) {
+	assert(index >= 0);
+
+	index_type segment_index = 0;
+	while(index >= v[segment_index].count) {
+		index -= v[segment_index].count;
+		++segment_index;
+		assert(segment_index < count);
+	}
+
+	return v[segment_index][index];
+}
+}
+
+// LIBAXL_VECTOR_LIST_GUARD
+#endif
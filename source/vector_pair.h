@@ -9,6 +9,8 @@ namespace libaxl {
 template <typename T>
 struct vector_pair {
 	vector<T> v[2];
+
+	ALWAYS_INLINE T& operator[](index_type index);
 };
 
 template <typename T>
@@ -70,6 +72,20 @@ index_type length(vector_pair<T> vp) {
 	return length(vp.v[0]) + length(vp.v[1]);
 }
 
+/**
+ *  Element access across both segments, index 0 is the first element
+ *  of v[0] and index length(v[0]) the first element of v[1].
+ */
+template <typename T>
+ALWAYS_INLINE
+T& vector_pair<T>::operator[](index_type index) {
+	index_type first_count = v[0].count;
+
+	if(index < first_count)
+		return v[0][index];
+	return v[1][index - first_count];
+}
+
 template <typename T>
 inline
 vector_pair<T> reverse(vector_pair<T> vp) {
@@ -5,6 +5,22 @@
 #include "util.h"
 #include "arena.h"
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define LIBAXL_HAS_STREAM_STORES
+#endif
+
+//Contiguous fills and copies of at least this many bytes bypass the
+//cache, 0 disables it
+#ifndef LIBAXL_STREAM_THRESHOLD
+#define LIBAXL_STREAM_THRESHOLD (8U * 1024U * 1024U)
+#endif
+
+//Elements ahead prefetched by strided copies, 0 disables it
+#ifndef LIBAXL_PREFETCH_DISTANCE
+#define LIBAXL_PREFETCH_DISTANCE 16
+#endif
+
 namespace libaxl {
 
 template <typename T>
@@ -60,6 +76,15 @@ index_type length(vector<T> v) {
 	return v.count;
 }
 
+/**
+ *  Leaves of lazy expressions cache nothing between evaluations, see
+ *  lazy_eval/shared_expr.h for the nodes that do.
+ */
+template <typename E>
+inline
+void reset_shared(E) {
+}
+
 template <typename T>
 inline
 size_type value_type_size(vector<T> v) {
@@ -139,7 +164,6 @@ vector<T> drop_at_most(vector<T> v, index_type count) {
 		count = v.count;
 
 	result.array = v.array + count * v.stride;
-	result.arena = v.arena;
 	result.count = v.count - count;
 	result.stride = v.stride;
 
@@ -255,11 +279,162 @@ vector<T> make_uninitialized_vector(arena *arena, index_type count) {
 	return result;
 }
 
+//
+//  Streaming (non-temporal) stores
+//
+//  Initializing or copying a buffer much larger than the last level
+//  cache through the cache evicts the working set of every other
+//  kernel, only for the data to be written back again. Above
+//  LIBAXL_STREAM_THRESHOLD bytes contiguous fills and copies use
+//  non-temporal stores that go to memory through the write combining
+//  buffers, followed by a store fence.
+//
+
+namespace detail {
+	template <typename T>
+	inline
+	bool use_stream_stores(index_type count) {
+		return LIBAXL_STREAM_THRESHOLD != 0
+			&& (size_type)count * sizeof(T) >= (size_type)LIBAXL_STREAM_THRESHOLD;
+	}
+
+#if defined(LIBAXL_HAS_STREAM_STORES)
+	/**
+	 *  Writes count copies of value to array with non-temporal stores.
+	 *  The unaligned head and the tail are written normally.
+	 *
+	 *  Preconditions:
+	 *  (1) array is aligned to sizeof(T)
+	 */
+	template <typename T>
+	inline
+	void stream_fill(T* array, index_type count, T value) {
+		static_assert(16 % sizeof(T) == 0, "16 byte stores must hold whole elements");
+
+		index_type i = 0;
+		for(; i < count && (size_type)(array + i) % 16 != 0; ++i)
+			array[i] = value;
+
+		alignas(16) T pattern[16 / sizeof(T)];
+		for(size_type k = 0; k < 16 / sizeof(T); ++k)
+			pattern[k] = value;
+		__m128i lanes = _mm_load_si128((const __m128i*)pattern);
+
+		const index_type per_store = (index_type)(16 / sizeof(T));
+		for(; i + 4 * per_store <= count; i += 4 * per_store) {
+			_mm_stream_si128((__m128i*)(array + i), lanes);
+			_mm_stream_si128((__m128i*)(array + i + per_store), lanes);
+			_mm_stream_si128((__m128i*)(array + i + 2 * per_store), lanes);
+			_mm_stream_si128((__m128i*)(array + i + 3 * per_store), lanes);
+		}
+		_mm_sfence();
+
+		for(; i < count; ++i)
+			array[i] = value;
+	}
+
+	/**
+	 *  Copies count elements with non-temporal stores, the source is
+	 *  read normally.
+	 *
+	 *  Preconditions:
+	 *  (1) the ranges do not overlap
+	 *  (2) out is aligned to sizeof(T)
+	 */
+	template <typename T>
+	inline
+	void stream_copy(const T* in, T* out, index_type count) {
+		static_assert(16 % sizeof(T) == 0, "16 byte stores must hold whole elements");
+
+		index_type i = 0;
+		for(; i < count && (size_type)(out + i) % 16 != 0; ++i)
+			out[i] = in[i];
+
+		const index_type per_store = (index_type)(16 / sizeof(T));
+		for(; i + 4 * per_store <= count; i += 4 * per_store) {
+			__m128i a = _mm_loadu_si128((const __m128i*)(in + i));
+			__m128i b = _mm_loadu_si128((const __m128i*)(in + i + per_store));
+			__m128i c = _mm_loadu_si128((const __m128i*)(in + i + 2 * per_store));
+			__m128i d = _mm_loadu_si128((const __m128i*)(in + i + 3 * per_store));
+			_mm_stream_si128((__m128i*)(out + i), a);
+			_mm_stream_si128((__m128i*)(out + i + per_store), b);
+			_mm_stream_si128((__m128i*)(out + i + 2 * per_store), c);
+			_mm_stream_si128((__m128i*)(out + i + 3 * per_store), d);
+		}
+		_mm_sfence();
+
+		for(; i < count; ++i)
+			out[i] = in[i];
+	}
+#endif
+
+	/**
+	 *  The streaming paths, used for types whose elements whole 16 byte
+	 *  stores hold, on arrays aligned to the element size. fill and
+	 *  copy return false, having written nothing, when they do not
+	 *  apply, so other types never instantiate stream_fill/stream_copy.
+	 */
+	template <typename T, bool whole_elements = (16 % sizeof(T) == 0)>
+	struct stream_stores {
+		static bool fill(T*, index_type, T) { return false; }
+		static bool copy(const T*, T*, index_type) { return false; }
+	};
+
+#if defined(LIBAXL_HAS_STREAM_STORES)
+	template <typename T>
+	struct stream_stores<T, true> {
+		static bool fill(T* array, index_type count, T value) {
+			if((size_type)array % sizeof(T) != 0)
+				return false;
+
+			stream_fill(array, count, value);
+			return true;
+		}
+
+		static bool copy(const T* in, T* out, index_type count) {
+			if((size_type)out % sizeof(T) != 0)
+				return false;
+
+			stream_copy(in, out, count);
+			return true;
+		}
+	};
+#endif
+
+	template <typename T>
+	ALWAYS_INLINE
+	void prefetch(const T* address) {
+#if defined(LIBAXL_HAS_STREAM_STORES)
+		_mm_prefetch((const char*)address, _MM_HINT_T0);
+#elif defined(__GNUC__)
+		__builtin_prefetch(address);
+#else
+		(void)address;
+#endif
+	}
+
+	/**
+	 *  Fills a contiguous range, bypassing the cache when it is large.
+	 */
+	template <typename T>
+	inline
+	void fill_contiguous(T* array, index_type count, T value) {
+		if(use_stream_stores<T>(count) && stream_stores<T>::fill(array, count, value))
+			return;
+
+		for(index_type i = 0; i < count; ++i)
+			array[i] = value;
+	}
+}
+
 template <typename T>
 inline
 vector<T> zeros(arena *arena, index_type count) {
 	auto result = make_uninitialized_vector<T>(arena, count);
-	
+
+	if(detail::use_stream_stores<T>(count) && detail::stream_stores<T>::fill(result.array, count, T()))
+		return result;
+
 	memset(result.array, 0, count * sizeof(T));
 
 	return result;
@@ -314,7 +489,13 @@ vector<T> make_vector(arena* arena, T* array, index_type count) {
 template <typename T, typename V>
 inline
 void fill(vector<T> v, V value) {
-	for_each(v, [value](T& elem) -> void { elem = value; });
+	if(v.stride == 1) {
+		detail::fill_contiguous(v.array, v.count, (T)value);
+		return;
+	}
+
+	for(index_type i = 0; i < v.count; ++i)
+		v.array[i * v.stride] = (T)value;
 }
 
 inline
@@ -365,12 +546,62 @@ vector<T> copy_to(vector<T> in, vector<T> out) {
 	auto len = minimum(length(in), length(out));
 	out.count = len;
 
+	if(in.stride == 1 && out.stride == 1) {
+		bool disjoint = in.array + len <= out.array || out.array + len <= in.array;
+		if(disjoint && detail::use_stream_stores<T>(len) && detail::stream_stores<T>::copy(in.array, out.array, len))
+			return out;
+
+		//memmove is rep movsb or a tuned vector loop, and allows overlap
+		memmove(out.array, in.array, (size_type)len * sizeof(T));
+		return out;
+	}
+
+	//Gather: every strided element may be on its own cache line, fetch
+	//them ahead of the loop
+	size_type step = (size_type)(in.stride < 0 ? -in.stride : in.stride) * sizeof(T);
+	if(LIBAXL_PREFETCH_DISTANCE > 0 && step >= 64) {
+		index_type ahead = len - LIBAXL_PREFETCH_DISTANCE;
+		index_type i = 0;
+		for(; i < ahead; ++i) {
+			detail::prefetch(in.array + (i + LIBAXL_PREFETCH_DISTANCE) * in.stride);
+			out.array[i * out.stride] = in.array[i * in.stride];
+		}
+		for(; i < len; ++i)
+			out.array[i * out.stride] = in.array[i * in.stride];
+		return out;
+	}
+
 	for(index_type i = 0; i < len; ++i) {
 		out.array[i * out.stride] = in.array[i * in.stride];
 	}
 
 	return out;
 }
+
+namespace detail {
+	/**
+	 *  sum a[k] * x[k] over two contiguous arrays, the inner product of
+	 *  the matrix-vector and resampling kernels. Four partial sums keep
+	 *  the adds independent, a single accumulator is a serial chain.
+	 */
+	template <typename T>
+	inline
+	T dot_contiguous(const T* a, const T* x, index_type count) {
+		T s0 = 0, s1 = 0, s2 = 0, s3 = 0;
+		index_type k = 0;
+
+		for(; k + 4 <= count; k += 4) {
+			s0 += a[k] * x[k];
+			s1 += a[k + 1] * x[k + 1];
+			s2 += a[k + 2] * x[k + 2];
+			s3 += a[k + 3] * x[k + 3];
+		}
+		for(; k < count; ++k)
+			s0 += a[k] * x[k];
+
+		return (s0 + s1) + (s2 + s3);
+	}
+}
 } // namespace libaxl
 
 // LIBAXL_VECTORS_GUARD